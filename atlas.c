@@ -0,0 +1,66 @@
+/*
+ * Split-Field Tile Atlas
+ * Each look is drawn once with the fill kernels at startup (and again if
+ * the pixel format changes). Drawing a cell is then one memcpy per row.
+ */
+
+#include "atlas.h"
+#include <string.h>
+
+/* Indexed by TileLook */
+static const TileLookDesc look_descs[LOOK_COUNT] = {
+    { COLOR_EMPTY,      COLOR_BORDER,       0, 0 },  /* LOOK_EMPTY */
+    { COLOR_WALL,       COLOR_BORDER,       1, 0 },  /* LOOK_WALL */
+    { COLOR_BOX,        COLOR_BORDER,       1, 0 },  /* LOOK_BOX */
+    { COLOR_GHOST_BOX,  COLOR_BORDER,       1, 0 },  /* LOOK_GHOST_BOX */
+    { COLOR_ENEMY_TILE, COLOR_BORDER,       1, 0 },  /* LOOK_ENEMY_TILE */
+    { COLOR_GOAL,       COLOR_BORDER,       1, 0 },  /* LOOK_GOAL */
+    { COLOR_BARRIER,    COLOR_BORDER,       1, 0 },  /* LOOK_BARRIER */
+    { COLOR_BOX_P1,     COLOR_BORDER,       1, 0 },  /* LOOK_BOX_P1 */
+    { COLOR_BOX_P2,     COLOR_BORDER,       1, 0 },  /* LOOK_BOX_P2 */
+    { COLOR_ENEMY,      COLOR_ENEMY_BORDER, 1, 2 },  /* LOOK_ENEMY */
+    { COLOR_PLAYER1,    COLOR_BORDER,       1, 2 },  /* LOOK_PLAYER1 */
+    { COLOR_PLAYER2,    COLOR_BORDER,       1, 2 },  /* LOOK_PLAYER2 */
+    { COLOR_HINT,       COLOR_BORDER,       1, 5 }   /* LOOK_HINT */
+};
+
+const TileLookDesc* atlas_look_desc(TileLook look)
+{
+    return &look_descs[look];
+}
+
+void atlas_bake(TileAtlas* atlas, int format)
+{
+    RenderPalette palette;
+    RenderTarget rt;
+
+    render_palette_init(&palette, format);
+    memset(atlas->pixels, 0, sizeof(atlas->pixels));
+    render_target_init(&rt, atlas->pixels, ATLAS_TILE_SIZE, format,
+                       ATLAS_TILE_SIZE, ATLAS_TILE_SIZE * LOOK_COUNT);
+
+    for (int i = 0; i < LOOK_COUNT; i++) {
+        const TileLookDesc* desc = &look_descs[i];
+        int size = ATLAS_TILE_SIZE - 2 * desc->inset;
+        int x = desc->inset;
+        int y = i * ATLAS_TILE_SIZE + desc->inset;
+
+        render_fill_rect(&rt, x, y, size, size, palette.pixel[desc->fill]);
+        if (desc->bordered)
+            render_rect_outline(&rt, x, y, size, palette.pixel[desc->border]);
+    }
+
+    atlas->format = format;
+    atlas->ready = 1;
+}
+
+void atlas_blit(const TileAtlas* atlas, const RenderTarget* rt, TileLook look, int x, int y)
+{
+    int inset = look_descs[look].inset;
+    int size = ATLAS_TILE_SIZE - 2 * inset;
+    int bpp = render_bytes_per_pixel(atlas->format);
+    const unsigned char* src = atlas->pixels +
+        ((look * ATLAS_TILE_SIZE + inset) * ATLAS_TILE_SIZE + inset) * bpp;
+
+    render_blit(rt, x + inset, y + inset, size, size, src, ATLAS_TILE_SIZE);
+}
@@ -0,0 +1,55 @@
+/*
+ * Split-Field Tile Atlas
+ * Tile, box, enemy and player looks baked once into native pixels
+ */
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "render.h"
+
+#define ATLAS_TILE_SIZE 16
+
+/* Everything that can be drawn into a field cell */
+typedef enum {
+    LOOK_EMPTY = 0,
+    LOOK_WALL,
+    LOOK_BOX,
+    LOOK_GHOST_BOX,
+    LOOK_ENEMY_TILE,
+    LOOK_GOAL,
+    LOOK_BARRIER,
+    LOOK_BOX_P1,
+    LOOK_BOX_P2,
+    LOOK_ENEMY,
+    LOOK_PLAYER1,
+    LOOK_PLAYER2,
+    LOOK_HINT,
+    LOOK_COUNT
+} TileLook;
+
+/* How a look is drawn: a filled square, optionally outlined, inset from
+ * the cell edge (actors are drawn inset over the tile below them) */
+typedef struct {
+    ColorIndex fill;
+    ColorIndex border;
+    int bordered;
+    int inset;
+} TileLookDesc;
+
+/* All looks stacked vertically, ATLAS_TILE_SIZE pixels per row */
+typedef struct {
+    int format;
+    int ready;
+    unsigned char pixels[LOOK_COUNT * ATLAS_TILE_SIZE * ATLAS_TILE_SIZE * 4] __attribute__((aligned(64)));
+} TileAtlas;
+
+const TileLookDesc* atlas_look_desc(TileLook look);
+
+/* Render every look in the given pixel format */
+void atlas_bake(TileAtlas* atlas, int format);
+
+/* Copy a look to (x, y), the cell's top-left corner, one row at a time */
+void atlas_blit(const TileAtlas* atlas, const RenderTarget* rt, TileLook look, int x, int y);
+
+#endif /* ATLAS_H */
@@ -0,0 +1,207 @@
+/*
+ * Split-Field Display
+ * Renders go to an off-screen back buffer which is flipped in at vblank
+ * with sceDisplaySetFrameBuf. The host build backs the buffers with plain
+ * memory and a simulated vblank counter so flip ordering can be checked.
+ */
+
+#include "display.h"
+#include <string.h>
+
+#ifdef SF_HOST
+#include <stdlib.h>
+#else
+#include <pspkernel.h>
+#include <pspdisplay.h>
+#include <pspdebug.h>
+
+/* Uncached VRAM mirror, so CPU writes reach the display without a flush */
+#define VRAM_BASE ((unsigned char*)0x44000000)
+#define VRAM_SIZE (2 * 1024 * 1024)
+#endif
+
+static struct {
+    int count;
+    int format;
+    void* buffers[DISPLAY_MAX_BUFFERS];
+    int front;               /* Buffer being scanned out */
+    int pending;             /* Submitted, latched at next vblank; -1 if none */
+    unsigned int pending_vcount;
+    int back;                /* Buffer being rendered */
+    DisplayStats stats;
+} display;
+
+#ifdef SF_HOST
+static unsigned int host_vcount = 0;
+
+static unsigned int get_vcount(void)
+{
+    return host_vcount;
+}
+
+static void wait_vblank(void)
+{
+    host_vcount++;
+}
+
+static void set_frame_buf(void* buf, int next_frame)
+{
+    (void)buf;
+    (void)next_frame;
+}
+#else
+static unsigned int get_vcount(void)
+{
+    return sceDisplayGetVcount();
+}
+
+static void wait_vblank(void)
+{
+    sceDisplayWaitVblankStart();
+}
+
+static void set_frame_buf(void* buf, int next_frame)
+{
+    sceDisplaySetFrameBuf(buf, DISPLAY_STRIDE, display.format,
+                          next_frame ? PSP_DISPLAY_SETBUF_NEXTFRAME : PSP_DISPLAY_SETBUF_IMMEDIATE);
+}
+#endif
+
+static int buffer_size(void)
+{
+    return DISPLAY_STRIDE * DISPLAY_HEIGHT * render_bytes_per_pixel(display.format);
+}
+
+/* Promote the pending buffer once a vblank has passed since it was queued */
+static void latch(void)
+{
+    if (display.pending >= 0 && get_vcount() != display.pending_vcount) {
+        display.front = display.pending;
+        display.pending = -1;
+    }
+}
+
+int display_init(const DisplayConfig* config)
+{
+    memset(&display, 0, sizeof(display));
+
+    display.count = config->buffer_count;
+    if (display.count < 1)
+        display.count = 1;
+    if (display.count > DISPLAY_MAX_BUFFERS)
+        display.count = DISPLAY_MAX_BUFFERS;
+
+    display.format = (config->pixel_format == RENDER_FORMAT_565) ? RENDER_FORMAT_565 : RENDER_FORMAT_8888;
+
+#ifdef SF_HOST
+    for (int i = 0; i < display.count; i++) {
+        display.buffers[i] = calloc(1, buffer_size());
+        if (!display.buffers[i]) {
+            display_shutdown();
+            return -1;
+        }
+    }
+#else
+    if (display.count * buffer_size() > VRAM_SIZE)
+        display.count = VRAM_SIZE / buffer_size();
+
+    for (int i = 0; i < display.count; i++) {
+        display.buffers[i] = VRAM_BASE + i * buffer_size();
+        memset(display.buffers[i], 0, buffer_size());
+    }
+
+    sceDisplaySetMode(0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    pspDebugScreenInitEx(display.buffers[0], display.format, 0);
+#endif
+
+    display.front = 0;
+    display.pending = -1;
+    display.back = (display.count > 1) ? 1 : 0;
+    set_frame_buf(display.buffers[0], 0);
+    return 0;
+}
+
+void display_shutdown(void)
+{
+#ifdef SF_HOST
+    for (int i = 0; i < DISPLAY_MAX_BUFFERS; i++)
+        free(display.buffers[i]);
+#endif
+    memset(&display, 0, sizeof(display));
+}
+
+int display_begin_frame(RenderTarget* rt)
+{
+    if (display.count == 0)
+        return -1;
+
+    /* Never draw into a buffer that is on screen or queued for it */
+    if (display.count > 1) {
+        latch();
+        while (display.back == display.front || display.back == display.pending) {
+            wait_vblank();
+            display.stats.vblank_waits++;
+            latch();
+        }
+    }
+
+#ifndef SF_HOST
+    pspDebugScreenSetBase((u32*)display.buffers[display.back]);
+#endif
+
+    return render_target_init(rt, display.buffers[display.back], DISPLAY_STRIDE,
+                              display.format, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+void display_flip(int pace)
+{
+    if (display.count > 1) {
+        latch();
+        if (display.pending >= 0)
+            display.stats.dropped++;
+
+        set_frame_buf(display.buffers[display.back], 1);
+        display.pending = display.back;
+        display.pending_vcount = get_vcount();
+        display.back = (display.back + 1) % display.count;
+        display.stats.flips++;
+    }
+
+    if (pace) {
+        wait_vblank();
+        latch();
+    }
+}
+
+int display_buffer_count(void)
+{
+    return display.count;
+}
+
+int display_back_index(void)
+{
+    return display.back;
+}
+
+int display_front_index(void)
+{
+    latch();
+    return display.front;
+}
+
+int display_pixel_format(void)
+{
+    return display.format;
+}
+
+void* display_buffer(int index)
+{
+    if (index < 0 || index >= display.count)
+        return NULL;
+    return display.buffers[index];
+}
+
+const DisplayStats* display_stats(void)
+{
+    return &display.stats;
+}
@@ -0,0 +1,44 @@
+/*
+ * Split-Field Display
+ * Double/triple-buffered presentation with vblank page flipping
+ */
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "render.h"
+
+#define DISPLAY_MAX_BUFFERS 3
+#define DISPLAY_STRIDE 512
+#define DISPLAY_WIDTH 480
+#define DISPLAY_HEIGHT 272
+
+/* Chosen once at startup */
+typedef struct {
+    int buffer_count;  /* 1 = draw to scanout, 2 = double, 3 = triple */
+    int pixel_format;  /* RENDER_FORMAT_* */
+} DisplayConfig;
+
+typedef struct {
+    unsigned int flips;         /* Buffers submitted */
+    unsigned int dropped;       /* Submitted but replaced before vblank */
+    unsigned int vblank_waits;  /* Waits for a back buffer to come free */
+} DisplayStats;
+
+int display_init(const DisplayConfig* config);
+void display_shutdown(void);
+
+/* Target the current back buffer, waiting until it is off screen */
+int display_begin_frame(RenderTarget* rt);
+
+/* Queue the back buffer for the next vblank; pace waits for it (60Hz) */
+void display_flip(int pace);
+
+int display_buffer_count(void);
+int display_back_index(void);
+int display_front_index(void);
+int display_pixel_format(void);
+void* display_buffer(int index);
+const DisplayStats* display_stats(void);
+
+#endif /* DISPLAY_H */
@@ -1,647 +1,833 @@
 /*
- * Split-Field Game Logic
- * Two-player cooperative puzzle game for PSP
+ * Split-Field Game Front End
+ * Two-player cooperative puzzle game for PSP: pad input and rendering
+ * around the simulation in sim.c
  * Player 1: D-pad controls
  * Player 2: Action buttons (ABXO) as directional controls
  */
 
 #include "game.h"
-#include <pspdebug.h>
+#include "render.h"
+#include "display.h"
+#include "render_gu.h"
+#include "atlas.h"
+#include "hud.h"
+#include "hint.h"
+#include "undo.h"
+#include "input.h"
+#include "level.h"
+#include "pack.h"
+#include "level_table.h"
+#include "preload.h"
+#include <stdio.h>
+#ifndef SF_HOST
 #include <pspdisplay.h>
 #include <pspctrl.h>
+#endif
 #include <string.h>
 #include <stdlib.h>
 
-#define printf pspDebugScreenPrintf
+/* Draws a look at a cell's top-left corner, in view pixels; one per backend */
+typedef void (*DrawLookFn)(const RenderTarget* rt, TileLook look, int x, int y);
 
-/* Helper function to draw filled rectangle */
-static void draw_rect(int x, int y, int w, int h, unsigned int color)
+/* Copies a block of the static layer back to the view; one per backend */
+typedef void (*RestoreFn)(const RenderTarget* rt, int x, int y, int w, int h);
+
+static void software_draw_look(const RenderTarget* rt, TileLook look, int x, int y);
+static void software_restore(const RenderTarget* rt, int x, int y, int w, int h);
+
+static RenderBackend render_backend = RENDER_BACKEND_SOFTWARE;
+static DrawLookFn draw_look = software_draw_look;
+static RestoreFn restore = software_restore;
+
+/* Looks pre-baked in the framebuffer's pixel format */
+static TileAtlas atlas;
+
+/* GE backend: looks drawn as quads with 8888 vertex colours */
+static RenderPalette gu_palette;
+
+/* Static field layer: floor, walls, barrier and goals of the tiles around
+ * the viewport, baked in the framebuffer's pixel format. It is one tile
+ * wider than the view on every side, so it is only re-baked when the
+ * camera crosses a tile boundary (or the level or format changes). */
+#define LAYER_TILES_X (VIEW_WIDTH / TILE_SIZE + 2)
+#define LAYER_TILES_Y (VIEW_HEIGHT / TILE_SIZE + 2)
+#define LAYER_WIDTH (LAYER_TILES_X * TILE_SIZE)
+#define LAYER_HEIGHT (LAYER_TILES_Y * TILE_SIZE)
+
+static unsigned char layer_pixels[LAYER_WIDTH * LAYER_HEIGHT * 4] __attribute__((aligned(64)));
+static RenderTarget layer;
+static int layer_ready = 0;
+static int layer_tile_x, layer_tile_y;  /* Field tile at the layer's top-left */
+
+/* Field pixel at the view's top-left; negative centres a small field */
+typedef struct {
+    int x;
+    int y;
+} Camera;
+
+static Camera camera;
+
+/* Boxes, enemies and players drawn over the static layer, back to front;
+ * one per entity slot, then the hint marker on top */
+#define SPRITE_HINT ENTITY_COUNT
+#define SPRITE_COUNT (SPRITE_HINT + 1)
+
+/* Pixels a sprite moves per frame: a tile in 4 frames, inside the move delay */
+#define SPRITE_STEP 4
+
+typedef struct {
+    TileLook look;
+    int visible;
+    int x;  /* Field pixels of the cell's top-left corner, */
+    int y;  /* between tiles while the sprite is moving */
+} Sprite;
+
+static Sprite sprites[SPRITE_COUNT];
+
+/* Player sprites, which the camera follows */
+#define SPRITE_PLAYER1 ENTITY_PLAYER1
+#define SPRITE_PLAYER2 ENTITY_PLAYER2
+
+/* The hint search, shown while the player asks for it (START) */
+static Hint hint;
+
+/* Sprites and camera as each display buffer last showed them */
+static Sprite buffer_sprites[DISPLAY_MAX_BUFFERS][SPRITE_COUNT];
+static Camera buffer_camera[DISPLAY_MAX_BUFFERS];
+static int buffer_full[DISPLAY_MAX_BUFFERS];
+
+/* Target the back buffer and re-bake the atlas if the format changed */
+static int render_begin(RenderTarget* rt)
 {
-    void* vram_base = NULL;
-    int buffer_width = 0;
-    int pixel_format = 0;
+    if (display_begin_frame(rt) < 0)
+        return -1;
     
-    if (sceDisplayGetFrameBuf(&vram_base, &buffer_width, &pixel_format, PSP_DISPLAY_SETBUF_IMMEDIATE) < 0)
-        return;
+    if (!atlas.ready || atlas.format != rt->format)
+        atlas_bake(&atlas, rt->format);
     
-    if (!vram_base || buffer_width <= 0) return;
-    
-    if (pixel_format == PSP_DISPLAY_PIXEL_FORMAT_8888) {
-        unsigned int* vram = (unsigned int*)vram_base;
-        for (int dy = 0; dy < h; dy++) {
-            int py = y + dy;
-            if (py < 0 || py >= SCREEN_HEIGHT) continue;
-            for (int dx = 0; dx < w; dx++) {
-                int px = x + dx;
-                if (px < 0 || px >= SCREEN_WIDTH) continue;
-                /* Convert ARGB to little-endian ABGR */
-                unsigned int a = (color >> 24) & 0xFF;
-                unsigned int r = (color >> 16) & 0xFF;
-                unsigned int g = (color >> 8) & 0xFF;
-                unsigned int b = color & 0xFF;
-                vram[py * buffer_width + px] = (a << 24) | (b << 16) | (g << 8) | r;
-            }
-        }
-    } else {
-        /* RGB565 format */
-        unsigned short* vram = (unsigned short*)vram_base;
-        unsigned char r = (color >> 16) & 0xFF;
-        unsigned char g = (color >> 8) & 0xFF;
-        unsigned char b = color & 0xFF;
-        unsigned short rgb565 = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-        
-        for (int dy = 0; dy < h; dy++) {
-            int py = y + dy;
-            if (py < 0 || py >= SCREEN_HEIGHT) continue;
-            for (int dx = 0; dx < w; dx++) {
-                int px = x + dx;
-                if (px < 0 || px >= SCREEN_WIDTH) continue;
-                vram[py * buffer_width + px] = rgb565;
-            }
-        }
-    }
+    return 0;
 }
 
-/* Helper function to draw a tile border */
-static void draw_tile_border(int x, int y, int size, unsigned int color)
+/* Software backend: one row copy per atlas row */
+static void software_draw_look(const RenderTarget* rt, TileLook look, int x, int y)
 {
-    draw_rect(x, y, size, 1, color);           /* Top */
-    draw_rect(x, y + size - 1, size, 1, color); /* Bottom */
-    draw_rect(x, y, 1, size, color);           /* Left */
-    draw_rect(x + size - 1, y, 1, size, color); /* Right */
+    atlas_blit(&atlas, rt, look, x, y);
 }
 
-/* Initialize game state */
-void game_init(GameContext* ctx)
+/* Layer pixel under view pixel (x, y) */
+static int layer_x(int x)
 {
-    memset(ctx, 0, sizeof(GameContext));
-    
-    /* Set initial player positions - on opposite sides of barrier */
-    ctx->player1.x = 3;
-    ctx->player1.y = 7;
-    ctx->player1.color = 0xFF4444FF; /* Red */
-    
-    ctx->player2.x = 16;
-    ctx->player2.y = 7;
-    ctx->player2.color = 0xFF4444FF; /* Blue */
-    
-    /* Initialize simple level layout */
-    for (int y = 0; y < FIELD_HEIGHT; y++) {
-        for (int x = 0; x < FIELD_WIDTH; x++) {
-            /* Create walls around the border */
-            if (x == 0 || x == FIELD_WIDTH - 1 || y == 0 || y == FIELD_HEIGHT - 1) {
-                ctx->field[y][x] = TILE_WALL;
-            } else {
-                ctx->field[y][x] = TILE_EMPTY;
-            }
-        }
-    }
-    
-    /* Add vertical barrier in the middle */
-    int middle_x = FIELD_WIDTH / 2;
-    for (int y = 1; y < FIELD_HEIGHT - 1; y++) {
-        ctx->field[y][middle_x] = TILE_BARRIER;
-    }
+    return x + camera.x - layer_tile_x * TILE_SIZE;
+}
+
+static int layer_y(int y)
+{
+    return y + camera.y - layer_tile_y * TILE_SIZE;
+}
+
+/* Software backend: one row copy per layer row */
+static void software_restore(const RenderTarget* rt, int x, int y, int w, int h)
+{
+    int bpp = render_bytes_per_pixel(layer.format);
+    const unsigned char* src = layer_pixels + (layer_y(y) * LAYER_WIDTH + layer_x(x)) * bpp;
     
-    /* Add some internal walls */
-    for (int i = 2; i < 7; i++) {
-        ctx->field[5][i] = TILE_WALL;
-        ctx->field[8][FIELD_WIDTH - 1 - i] = TILE_WALL;
+    render_blit(rt, x, y, w, h, src, LAYER_WIDTH);
+}
+
+/* GE backend: queue the look's fill and border as sprite quads */
+static void gu_draw_look(const RenderTarget* rt, TileLook look, int x, int y)
+{
+    const TileLookDesc* desc = atlas_look_desc(look);
+    int size = TILE_SIZE - 2 * desc->inset;
+    unsigned int border = gu_palette.pixel[desc->border];
+    
+    x += VIEW_X + desc->inset;
+    y += VIEW_Y + desc->inset;
+    gu_fill_rect(x, y, size, size, gu_palette.pixel[desc->fill]);
+    
+    if (desc->bordered) {
+        gu_fill_rect(x, y, size, 1, border);            /* Top */
+        gu_fill_rect(x, y + size - 1, size, 1, border); /* Bottom */
+        gu_fill_rect(x, y, 1, size, border);            /* Left */
+        gu_fill_rect(x + size - 1, y, 1, size, border); /* Right */
     }
     
-    /* Initialize mirror boxes - Player 1 controls boxes 1 & 2 */
-    ctx->mirror_boxes[0].x = 3;
-    ctx->mirror_boxes[0].y = 3;
-    ctx->mirror_boxes[0].owner = 1;
-    
-    ctx->mirror_boxes[1].x = 7;
-    ctx->mirror_boxes[1].y = 10;
-    ctx->mirror_boxes[1].owner = 1;
-    
-    /* Player 2 controls boxes 3 & 4 */
-    ctx->mirror_boxes[2].x = 16;
-    ctx->mirror_boxes[2].y = 3;
-    ctx->mirror_boxes[2].owner = 2;
-    
-    ctx->mirror_boxes[3].x = 12;
-    ctx->mirror_boxes[3].y = 10;
-    ctx->mirror_boxes[3].owner = 2;
-    
-    ctx->total_boxes = 4;
-    
-    /* Place goals */
-    ctx->field[3][2] = TILE_GOAL;
-    ctx->field[10][7] = TILE_GOAL;
-    ctx->field[3][17] = TILE_GOAL;
-    ctx->field[10][12] = TILE_GOAL;
-    
-    /* Initialize enemies - 2 for each player side */
-    ctx->enemies[0].x = 5;
-    ctx->enemies[0].y = 5;
-    ctx->enemies[0].target_player = 1;
-    ctx->enemies[0].active = 1;
-    
-    ctx->enemies[1].x = 5;
-    ctx->enemies[1].y = 9;
-    ctx->enemies[1].target_player = 1;
-    ctx->enemies[1].active = 1;
-    
-    ctx->enemies[2].x = 14;
-    ctx->enemies[2].y = 5;
-    ctx->enemies[2].target_player = 2;
-    ctx->enemies[2].active = 1;
+    if (rt->stats)
+        rt->stats->pixels_written += size * size;
+}
+
+/* GE backend: the GE copies the block in the frame's display list */
+static void gu_restore(const RenderTarget* rt, int x, int y, int w, int h)
+{
+    gu_copy_rect(&layer, layer_x(x), layer_y(y), w, h, VIEW_X + x, VIEW_Y + y);
     
-    ctx->enemies[3].x = 14;
-    ctx->enemies[3].y = 9;
-    ctx->enemies[3].target_player = 2;
-    ctx->enemies[3].active = 1;
+    if (rt->stats)
+        rt->stats->pixels_written += w * h;
+}
+
+void game_set_render_backend(RenderBackend backend)
+{
+    if (backend == RENDER_BACKEND_GU && gu_backend_init() < 0)
+        backend = RENDER_BACKEND_SOFTWARE;
+    
+    render_backend = backend;
+    if (backend == RENDER_BACKEND_GU) {
+        render_palette_init(&gu_palette, RENDER_FORMAT_8888);
+        draw_look = gu_draw_look;
+        restore = gu_restore;
+    } else {
+        draw_look = software_draw_look;
+        restore = software_restore;
+    }
     
-    ctx->state = GAME_RUNNING;
-    ctx->level = 1;
-    ctx->boxes_in_goal = 0;
-    ctx->enemy_move_counter = 0;
+    /* Buffers drawn by the other backend are repainted from scratch */
+    for (int b = 0; b < DISPLAY_MAX_BUFFERS; b++)
+        buffer_full[b] = 1;
 }
 
-/* Check if position is valid for player movement */
-static int can_move_to(GameContext* ctx, int x, int y, int is_player1)
+/* Pixel and cell counters for the last frame */
+static RenderStats frame_stats;
+
+const RenderStats* game_render_stats(void)
 {
-    if (x < 0 || x >= FIELD_WIDTH || y < 0 || y >= FIELD_HEIGHT)
+    return &frame_stats;
+}
+
+/* Initialize game state */
+void game_init(GameContext* ctx)
+{
+    sim_init(ctx);
+}
+
+int game_load_level(GameContext* ctx, int level)
+{
+    if (preload_active()) {
+        if (preload_take(ctx, level) == 0)
+            return 0;
+    } else if (pack_load_file(ctx, GAME_PACK_PATH, level) == 0) {
         return 0;
-    
-    TileType tile = ctx->field[y][x];
-    
-    /* Can't move into walls, barriers, or static enemies */
-    if (tile == TILE_WALL || tile == TILE_BARRIER || tile == TILE_ENEMY)
+    }
+    if (level_load(ctx, GAME_LEVELS_PATH, level) == 0)
         return 0;
-    
-    /* Check collision with moving enemies */
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        if (ctx->enemies[i].active && ctx->enemies[i].x == x && ctx->enemies[i].y == y)
-            return 0;
+    return level_table_start(ctx, level);
+}
+
+int game_level_count(void)
+{
+    LevelPack pack;
+    int last;
+    
+    if (preload_active()) {
+        last = preload_count();
+    } else if (pack_open(&pack, GAME_PACK_PATH) == 0) {
+        last = pack.count;
+        pack_close(&pack);
+    } else {
+        last = level_file_last(GAME_LEVELS_PATH);
     }
-    
-    /* Check collision with mirror boxes */
-    for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
-        if (ctx->mirror_boxes[i].x == x && ctx->mirror_boxes[i].y == y)
-            return 0;
+    for (int i = 0; i < level_table_count; i++) {
+        if (level_tables[i].number > last)
+            last = level_tables[i].number;
     }
-    
-    return 1;
+    return last > 1 ? last : 1;
+}
+
+/* Atlas look for a field tile */
+static TileLook tile_look(int tile)
+{
+    switch (tile) {
+        case TILE_EMPTY:
+            return LOOK_EMPTY;
+        case TILE_WALL:
+            return LOOK_WALL;
+        case TILE_BOX:
+            return LOOK_BOX;
+        case TILE_GHOST_BOX:
+            return LOOK_GHOST_BOX;
+        case TILE_ENEMY:
+            return LOOK_ENEMY_TILE;
+        case TILE_GOAL:
+            return LOOK_GOAL;
+        case TILE_BARRIER:
+            return LOOK_BARRIER;
+    }
+    return LOOK_EMPTY;
 }
 
-/* Try to push a mirror box */
-static int try_push_mirror_box(GameContext* ctx, int player_num, int from_x, int from_y, int to_x, int to_y)
+/* Bake the tiles from (tile_x, tile_y) into the static layer; cells off
+ * the field stay black, the debug screen's background */
+static void bake_layer(const GameContext* ctx, int format, int tile_x, int tile_y)
 {
-    /* Calculate push direction */
-    int dx = to_x - from_x;
-    int dy = to_y - from_y;
+    render_target_init(&layer, layer_pixels, LAYER_WIDTH, format, LAYER_WIDTH, LAYER_HEIGHT);
     
-    /* Find which mirror box is at the push location */
-    int box_idx = -1;
-    for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
-        if (ctx->mirror_boxes[i].x == to_x && ctx->mirror_boxes[i].y == to_y) {
-            /* Check if this player can move this box */
-            if (ctx->mirror_boxes[i].owner == player_num) {
-                box_idx = i;
-                break;
-            } else {
-                return 0; /* Can't move opponent's box */
-            }
+    for (int ty = 0; ty < LAYER_TILES_Y; ty++) {
+        for (int tx = 0; tx < LAYER_TILES_X; tx++) {
+            int x = tile_x + tx;
+            int y = tile_y + ty;
+            
+            if (x < 0 || x >= ctx->field_width || y < 0 || y >= ctx->field_height)
+                render_fill_rect(&layer, tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE, 0);
+            else
+                atlas_blit(&atlas, &layer, tile_look(FIELD_TILE(ctx, x, y)), tx * TILE_SIZE, ty * TILE_SIZE);
         }
     }
     
-    if (box_idx == -1)
-        return 0;
+#ifndef SF_HOST
+    /* The GE reads the layer from memory, not through the CPU cache */
+    sceKernelDcacheWritebackRange(layer_pixels, sizeof(layer_pixels));
+#endif
+    layer_tile_x = tile_x;
+    layer_tile_y = tile_y;
+    layer_ready = 1;
+}
+
+/* Tile containing field pixel p, rounding down for negative pixels */
+static int pixel_tile(int p)
+{
+    return (p >= 0) ? p / TILE_SIZE : -((TILE_SIZE - 1 - p) / TILE_SIZE);
+}
+
+/* One camera axis: centre on the players, clamped to the field, or the
+ * whole field centred when it fits in the view */
+static int camera_axis(int centre, int field_pixels, int view_pixels)
+{
+    if (field_pixels <= view_pixels)
+        return (field_pixels - view_pixels) / 2;
+    
+    int cam = centre - view_pixels / 2;
+    if (cam < 0)
+        cam = 0;
+    if (cam > field_pixels - view_pixels)
+        cam = field_pixels - view_pixels;
+    return cam;
+}
+
+/* Follow the midpoint of both players as they slide */
+static void update_camera(const GameContext* ctx)
+{
+    int centre_x = (sprites[SPRITE_PLAYER1].x + sprites[SPRITE_PLAYER2].x + TILE_SIZE) / 2;
+    int centre_y = (sprites[SPRITE_PLAYER1].y + sprites[SPRITE_PLAYER2].y + TILE_SIZE) / 2;
     
-    /* Check destination for box */
-    int box_dest_x = to_x + dx;
-    int box_dest_y = to_y + dy;
+    camera.x = camera_axis(centre_x, ctx->field_width * TILE_SIZE, VIEW_WIDTH);
+    camera.y = camera_axis(centre_y, ctx->field_height * TILE_SIZE, VIEW_HEIGHT);
+}
+
+/* Where every sprite should end up; sprites share the entity slots */
+static void sprite_targets(const GameContext* ctx, Sprite* out)
+{
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        out[slot].visible = 1;
+        out[slot].x = ctx->sim.x[slot] * TILE_SIZE;
+        out[slot].y = ctx->sim.y[slot] * TILE_SIZE;
+    }
     
-    if (box_dest_x < 0 || box_dest_x >= FIELD_WIDTH || 
-        box_dest_y < 0 || box_dest_y >= FIELD_HEIGHT)
-        return 0;
+    /* Mirror boxes, colored by owner */
+    for (int i = 0; i < MAX_MIRROR_BOXES; i++)
+        out[ENTITY_BOX0 + i].look = (ctx->box_owner[i] == 1) ? LOOK_BOX_P1 : LOOK_BOX_P2;
     
-    TileType dest_tile = ctx->field[box_dest_y][box_dest_x];
+    /* Moving enemies */
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        out[ENTITY_ENEMY0 + i].look = LOOK_ENEMY;
+        out[ENTITY_ENEMY0 + i].visible = ENEMY_ACTIVE(ctx, i);
+    }
     
-    /* Can only push box into empty space or goal */
-    if (dest_tile != TILE_EMPTY && dest_tile != TILE_GOAL)
-        return 0;
+    /* Players */
+    out[ENTITY_PLAYER1].look = LOOK_PLAYER1;
+    out[ENTITY_PLAYER2].look = LOOK_PLAYER2;
     
-    /* Check no other box at destination */
-    for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
-        if (ctx->mirror_boxes[i].x == box_dest_x && ctx->mirror_boxes[i].y == box_dest_y)
-            return 0;
+    /* The cell the hinted player should step into */
+    int hint_x = 0, hint_y = 0;
+    out[SPRITE_HINT].look = LOOK_HINT;
+    out[SPRITE_HINT].visible = hint_target(&hint, &hint_x, &hint_y);
+    out[SPRITE_HINT].x = hint_x * TILE_SIZE;
+    out[SPRITE_HINT].y = hint_y * TILE_SIZE;
+}
+
+static int approach(int from, int to)
+{
+    if (to > from + SPRITE_STEP)
+        return from + SPRITE_STEP;
+    if (to < from - SPRITE_STEP)
+        return from - SPRITE_STEP;
+    return to;
+}
+
+/* Slide every sprite one step toward its tile, or jump there on snap;
+ * the hint marker always jumps */
+static void animate_sprites(const GameContext* ctx, int snap)
+{
+    Sprite target[SPRITE_COUNT];
+    sprite_targets(ctx, target);
+    
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        int jump = snap || i == SPRITE_HINT;
+        sprites[i].look = target[i].look;
+        sprites[i].visible = target[i].visible;
+        sprites[i].x = jump ? target[i].x : approach(sprites[i].x, target[i].x);
+        sprites[i].y = jump ? target[i].y : approach(sprites[i].y, target[i].y);
     }
+}
+
+/* Pixels a sprite actually covers, in field coordinates */
+static void sprite_rect(const Sprite* s, int* x, int* y, int* size)
+{
+    int inset = atlas_look_desc(s->look)->inset;
+    *x = s->x + inset;
+    *y = s->y + inset;
+    *size = TILE_SIZE - 2 * inset;
+}
+
+/* Hide sprites that fall wholly outside the view */
+static void cull_sprites(void)
+{
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        int x, y, size;
+        sprite_rect(&sprites[i], &x, &y, &size);
+        x -= camera.x;
+        y -= camera.y;
+        if (x + size <= 0 || x >= VIEW_WIDTH || y + size <= 0 || y >= VIEW_HEIGHT)
+            sprites[i].visible = 0;
+    }
+}
+
+/* Restore the static layer under a sprite's field rectangle, clipped to the view */
+static void restore_rect(const RenderTarget* rt, int x, int y, int w, int h)
+{
+    x -= camera.x;
+    y -= camera.y;
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > VIEW_WIDTH) w = VIEW_WIDTH - x;
+    if (y + h > VIEW_HEIGHT) h = VIEW_HEIGHT - y;
+    if (w > 0 && h > 0)
+        restore(rt, x, y, w, h);
+}
+
+static int sprites_overlap(const Sprite* a, const Sprite* b)
+{
+    int ax, ay, asize, bx, by, bsize;
+    sprite_rect(a, &ax, &ay, &asize);
+    sprite_rect(b, &bx, &by, &bsize);
+    return ax < bx + bsize && bx < ax + asize && ay < by + bsize && by < ay + asize;
+}
+
+static void draw_sprite(const RenderTarget* rt, const Sprite* s)
+{
+    draw_look(rt, s->look, s->x - camera.x, s->y - camera.y);
     
-    /* Move the box and its mirror */
-    ctx->mirror_boxes[box_idx].x = box_dest_x;
-    ctx->mirror_boxes[box_idx].y = box_dest_y;
+    if (rt->stats)
+        rt->stats->cells_drawn++;
+}
+
+/* Bring one buffer's sprites up to date: restore the static layer under
+ * every sprite that moved, then redraw, back to front, each sprite that
+ * moved or touches a repainted area */
+static void update_sprites(const RenderTarget* rt, Sprite* shown)
+{
+    int redraw[SPRITE_COUNT];
+    int erased[SPRITE_COUNT];
     
-    /* Mirror movement: find the paired box and move it the same way */
-    /* Player 1's boxes 0,1 mirror to each other */
-    /* Player 2's boxes 2,3 mirror to each other */
-    int mirror_idx = -1;
-    if (player_num == 1) {
-        mirror_idx = (box_idx == 0) ? 1 : 0;
-    } else {
-        mirror_idx = (box_idx == 2) ? 3 : 2;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        int moved = memcmp(&shown[i], &sprites[i], sizeof(Sprite)) != 0;
+        
+        erased[i] = moved && shown[i].visible;
+        redraw[i] = moved && sprites[i].visible;
+        
+        if (erased[i]) {
+            int x, y, size;
+            sprite_rect(&shown[i], &x, &y, &size);
+            restore_rect(rt, x, y, size, size);
+        }
     }
     
-    /* Move mirror box in same direction */
-    int mirror_dest_x = ctx->mirror_boxes[mirror_idx].x + dx;
-    int mirror_dest_y = ctx->mirror_boxes[mirror_idx].y + dy;
-    
-    /* Check if mirror destination is valid */
-    if (mirror_dest_x >= 0 && mirror_dest_x < FIELD_WIDTH &&
-        mirror_dest_y >= 0 && mirror_dest_y < FIELD_HEIGHT) {
-        TileType mirror_tile = ctx->field[mirror_dest_y][mirror_dest_x];
-        if (mirror_tile == TILE_EMPTY || mirror_tile == TILE_GOAL) {
-            /* Check no box collision */
-            int collision = 0;
-            for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
-                if (ctx->mirror_boxes[i].x == mirror_dest_x && ctx->mirror_boxes[i].y == mirror_dest_y) {
-                    collision = 1;
+    /* A redrawn sprite covers whatever it overlaps, so pull that in too */
+    int grew = 1;
+    while (grew) {
+        grew = 0;
+        for (int j = 0; j < SPRITE_COUNT; j++) {
+            if (redraw[j] || !sprites[j].visible)
+                continue;
+            for (int i = 0; i < SPRITE_COUNT; i++) {
+                if ((erased[i] && sprites_overlap(&sprites[j], &shown[i])) ||
+                    (redraw[i] && sprites_overlap(&sprites[j], &sprites[i]))) {
+                    redraw[j] = 1;
+                    grew = 1;
                     break;
                 }
             }
-            if (!collision) {
-                ctx->mirror_boxes[mirror_idx].x = mirror_dest_x;
-                ctx->mirror_boxes[mirror_idx].y = mirror_dest_y;
-            }
         }
     }
     
-    return 1;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        if (redraw[i])
+            draw_sprite(rt, &sprites[i]);
+        shown[i] = sprites[i];
+    }
 }
 
-/* Move enemies toward their target player */
-static void update_enemies(GameContext* ctx)
+/* HUD lines, rasterised again only when their text changes */
+static HudText hud_title;
+static HudText hud_help[3];
+static HudText hud_banner;
+static HudText hud_hint;
+
+/* Hint line each display buffer last showed */
+static char buffer_hint[DISPLAY_MAX_BUFFERS][HUD_MAX_CHARS + 1];
+
+static const char* const help_lines[3] = {
+    "P1(Red) D-PAD | P2(Blue) ABXO | YELLOW=Barrier | START:Hint",
+    "Orange boxes=P1 | Blue boxes=P2 | MIRROR MOVES! | L/R:Undo/Redo",
+    "Push to GREEN goals | Avoid moving RED enemies | SELECT:Quit"
+};
+
+static void render_text(const RenderTarget* rt, const GameContext* ctx)
 {
-    ctx->enemy_move_counter++;
-    
-    /* Enemies move every 15 frames (slow movement) */
-    if (ctx->enemy_move_counter < 15)
-        return;
+    char title[HUD_MAX_CHARS + 1];
     
-    ctx->enemy_move_counter = 0;
+    /* Draw title at top */
+    snprintf(title, sizeof(title), "SPLIT-FIELD - Level %d", ctx->level);
+    hud_text_set(&hud_title, title, rt->format);
+    hud_text_draw(&hud_title, rt, 15, 0);
+    
+    /* Draw instructions at bottom, rows 31-33 (the debug screen has 34) */
+    for (int i = 0; i < 3; i++) {
+        hud_text_set(&hud_help[i], help_lines[i], rt->format);
+        hud_text_draw(&hud_help[i], rt, 2, 31 + i);
+    }
     
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        if (!ctx->enemies[i].active)
-            continue;
-        
-        Enemy* enemy = &ctx->enemies[i];
-        Player* target = (enemy->target_player == 1) ? &ctx->player1 : &ctx->player2;
-        
-        /* Simple pathfinding: move toward player */
-        int dx = 0, dy = 0;
-        
-        if (target->x < enemy->x)
-            dx = -1;
-        else if (target->x > enemy->x)
-            dx = 1;
-        
-        if (target->y < enemy->y)
-            dy = -1;
-        else if (target->y > enemy->y)
-            dy = 1;
-        
-        /* Try to move horizontally first */
-        int new_x = enemy->x + dx;
-        int new_y = enemy->y;
-        
-        if (new_x >= 0 && new_x < FIELD_WIDTH) {
-            TileType tile = ctx->field[new_y][new_x];
-            if (tile == TILE_EMPTY || tile == TILE_GOAL) {
-                /* Check no collision with other enemies or boxes */
-                int collision = 0;
-                for (int j = 0; j < MAX_ENEMIES; j++) {
-                    if (j != i && ctx->enemies[j].active && 
-                        ctx->enemies[j].x == new_x && ctx->enemies[j].y == new_y) {
-                        collision = 1;
-                        break;
-                    }
-                }
-                for (int j = 0; j < MAX_MIRROR_BOXES; j++) {
-                    if (ctx->mirror_boxes[j].x == new_x && ctx->mirror_boxes[j].y == new_y) {
-                        collision = 1;
-                        break;
-                    }
-                }
-                if (!collision) {
-                    enemy->x = new_x;
-                    return;
-                }
-            }
-        }
-        
-        /* Try vertical if horizontal failed */
-        new_x = enemy->x;
-        new_y = enemy->y + dy;
-        
-        if (new_y >= 0 && new_y < FIELD_HEIGHT) {
-            TileType tile = ctx->field[new_y][new_x];
-            if (tile == TILE_EMPTY || tile == TILE_GOAL) {
-                int collision = 0;
-                for (int j = 0; j < MAX_ENEMIES; j++) {
-                    if (j != i && ctx->enemies[j].active && 
-                        ctx->enemies[j].x == new_x && ctx->enemies[j].y == new_y) {
-                        collision = 1;
-                        break;
-                    }
-                }
-                for (int j = 0; j < MAX_MIRROR_BOXES; j++) {
-                    if (ctx->mirror_boxes[j].x == new_x && ctx->mirror_boxes[j].y == new_y) {
-                        collision = 1;
-                        break;
-                    }
-                }
-                if (!collision) {
-                    enemy->y = new_y;
-                }
-            }
-        }
+    /* Draw game state messages */
+    if (ctx->sim.state == GAME_WIN) {
+        hud_text_set(&hud_banner, "*** LEVEL COMPLETE! ***", rt->format);
+        hud_text_draw(&hud_banner, rt, 20, 15);
+    } else if (ctx->sim.state == GAME_LOSE) {
+        hud_text_set(&hud_banner, "*** GAME OVER! ***", rt->format);
+        hud_text_draw(&hud_banner, rt, 22, 15);
     }
 }
 
-/* Update game logic */
-void game_update(GameContext* ctx, SceCtrlData* pad)
+/* The hint line under the title, padded so a shorter line covers a longer
+ * one; nodes a frame are what the search budget buys */
+static void format_hint(char* line, int size)
 {
-    static SceCtrlData oldpad = {0};
-    static int move_delay = 0;
-    
-    if (ctx->state != GAME_RUNNING)
-        return;
+    static const char* const dir_names[4] = { "UP", "DOWN", "LEFT", "RIGHT" };
+    char text[HUD_MAX_CHARS + 1];
+    
+    switch (hint.state) {
+        case HINT_SEARCHING:
+            snprintf(text, sizeof(text), "HINT: thinking... %u nodes/frame", hint.stats.last_expanded);
+            break;
+        case HINT_READY:
+            snprintf(text, sizeof(text), "HINT: P%d %s  (%u frames, %u nodes/frame max)", hint.move.player,
+                     dir_names[hint.move.dir], hint.stats.frames, hint.stats.max_expanded);
+            break;
+        case HINT_NONE:
+            snprintf(text, sizeof(text), "HINT: no way to win from here");
+            break;
+        default:
+            text[0] = '\0';
+            break;
+    }
+    snprintf(line, size, "%-60s", text);
+}
+
+/* Drawn whenever it differs from what this buffer shows, which is outside
+ * the view and so never in the way of its repaints */
+static void render_hint_text(const RenderTarget* rt, int back, int full)
+{
+    char line[HUD_MAX_CHARS + 1];
     
-    /* Add delay between moves */
-    if (move_delay > 0) {
-        move_delay--;
-        oldpad = *pad;
+    format_hint(line, sizeof(line));
+    if (!full && strcmp(line, buffer_hint[back]) == 0)
         return;
+    hud_text_set(&hud_hint, line, rt->format);
+    hud_text_draw(&hud_hint, rt, 2, 1);
+    strcpy(buffer_hint[back], line);
+}
+
+/* Every visible sprite over the whole view */
+static void repaint_view(const RenderTarget* rt, Sprite* shown)
+{
+    restore(rt, 0, 0, VIEW_WIDTH, VIEW_HEIGHT);
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+        if (sprites[i].visible)
+            draw_sprite(rt, &sprites[i]);
     }
+    memcpy(shown, sprites, sizeof(sprites));
+}
+
+/* Render game graphics into the back buffer. Only the view is drawn, so
+ * the cost does not depend on the field size: the whole view when the
+ * camera moved or on load/state change, else only the sprites this
+ * buffer shows somewhere other than where they are now */
+void game_render(GameContext* ctx)
+{
+    RenderTarget rt, view;
     
-    int p1_dx = 0, p1_dy = 0;
-    int p2_dx = 0, p2_dy = 0;
+    memset(&frame_stats, 0, sizeof(frame_stats));
     
-    /* Player 1 controls: D-pad */
-    if ((pad->Buttons & PSP_CTRL_UP) && !(oldpad.Buttons & PSP_CTRL_UP))
-        p1_dy = -1;
-    if ((pad->Buttons & PSP_CTRL_DOWN) && !(oldpad.Buttons & PSP_CTRL_DOWN))
-        p1_dy = 1;
-    if ((pad->Buttons & PSP_CTRL_LEFT) && !(oldpad.Buttons & PSP_CTRL_LEFT))
-        p1_dx = -1;
-    if ((pad->Buttons & PSP_CTRL_RIGHT) && !(oldpad.Buttons & PSP_CTRL_RIGHT))
-        p1_dx = 1;
+    if (render_begin(&rt) < 0)
+        return;
     
-    /* Player 2 controls: Action buttons (ABXO mapped as directions) */
-    if ((pad->Buttons & PSP_CTRL_TRIANGLE) && !(oldpad.Buttons & PSP_CTRL_TRIANGLE))
-        p2_dy = -1;  /* Triangle = Up */
-    if ((pad->Buttons & PSP_CTRL_CROSS) && !(oldpad.Buttons & PSP_CTRL_CROSS))
-        p2_dy = 1;   /* Cross = Down */
-    if ((pad->Buttons & PSP_CTRL_SQUARE) && !(oldpad.Buttons & PSP_CTRL_SQUARE))
-        p2_dx = -1;  /* Square = Left */
-    if ((pad->Buttons & PSP_CTRL_CIRCLE) && !(oldpad.Buttons & PSP_CTRL_CIRCLE))
-        p2_dx = 1;   /* Circle = Right */
-    
-    /* Move Player 1 */
-    if (p1_dx != 0 || p1_dy != 0) {
-        int new_x = ctx->player1.x + p1_dx;
-        int new_y = ctx->player1.y + p1_dy;
-        
-        /* Check if moving into moving enemy - instant death */
-        for (int i = 0; i < MAX_ENEMIES; i++) {
-            if (ctx->enemies[i].active && ctx->enemies[i].x == new_x && ctx->enemies[i].y == new_y) {
-                ctx->state = GAME_LOSE;
-                return;
-            }
-        }
-        
-        /* Check for mirror box push */
-        int is_mirror_box = 0;
-        for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
-            if (ctx->mirror_boxes[i].x == new_x && ctx->mirror_boxes[i].y == new_y) {
-                is_mirror_box = 1;
-                if (try_push_mirror_box(ctx, 1, ctx->player1.x, ctx->player1.y, new_x, new_y)) {
-                    ctx->player1.x = new_x;
-                    ctx->player1.y = new_y;
-                    move_delay = 5;
-                }
-                break;
-            }
-        }
-        
-        if (!is_mirror_box && can_move_to(ctx, new_x, new_y, 1)) {
-            /* Check collision with player 2 */
-            if (new_x != ctx->player2.x || new_y != ctx->player2.y) {
-                ctx->player1.x = new_x;
-                ctx->player1.y = new_y;
-                move_delay = 5;
-            }
-        }
+    /* Every buffer is repainted after a state change; sprites stop
+     * mid-slide so the end screen shows where everything really is */
+    if (ctx->field_changed)
+        ctx->full_redraw = 1;
+    if (ctx->full_redraw) {
+        for (int b = 0; b < DISPLAY_MAX_BUFFERS; b++)
+            buffer_full[b] = 1;
     }
-    
-    /* Move Player 2 */
-    if (p2_dx != 0 || p2_dy != 0) {
-        int new_x = ctx->player2.x + p2_dx;
-        int new_y = ctx->player2.y + p2_dy;
-        
-        /* Check if moving into moving enemy - instant death */
-        for (int i = 0; i < MAX_ENEMIES; i++) {
-            if (ctx->enemies[i].active && ctx->enemies[i].x == new_x && ctx->enemies[i].y == new_y) {
-                ctx->state = GAME_LOSE;
-                return;
-            }
-        }
-        
-        /* Check for mirror box push */
-        int is_mirror_box = 0;
-        for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
-            if (ctx->mirror_boxes[i].x == new_x && ctx->mirror_boxes[i].y == new_y) {
-                is_mirror_box = 1;
-                if (try_push_mirror_box(ctx, 2, ctx->player2.x, ctx->player2.y, new_x, new_y)) {
-                    ctx->player2.x = new_x;
-                    ctx->player2.y = new_y;
-                    move_delay = 5;
-                }
-                break;
-            }
-        }
-        
-        if (!is_mirror_box && can_move_to(ctx, new_x, new_y, 0)) {
-            /* Check collision with player 1 */
-            if (new_x != ctx->player1.x || new_y != ctx->player1.y) {
-                ctx->player2.x = new_x;
-                ctx->player2.y = new_y;
-                move_delay = 5;
-            }
-        }
+    animate_sprites(ctx, ctx->full_redraw);
+    ctx->full_redraw = 0;
+    
+    update_camera(ctx);
+    cull_sprites();
+    
+    int tile_x = pixel_tile(camera.x);
+    int tile_y = pixel_tile(camera.y);
+    if (ctx->field_changed || !layer_ready || layer.format != rt.format ||
+        tile_x != layer_tile_x || tile_y != layer_tile_y) {
+        bake_layer(ctx, rt.format, tile_x, tile_y);
+        ctx->field_changed = 0;
     }
     
-    /* Update enemy positions */
-    update_enemies(ctx);
-    
-    /* Check if player collides with enemy after enemy movement */
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        if (ctx->enemies[i].active) {
-            if ((ctx->enemies[i].x == ctx->player1.x && ctx->enemies[i].y == ctx->player1.y) ||
-                (ctx->enemies[i].x == ctx->player2.x && ctx->enemies[i].y == ctx->player2.y)) {
-                ctx->state = GAME_LOSE;
-                return;
-            }
+    rt.stats = &frame_stats;
+    int back = display_back_index();
+    
+    /* The view as a target of its own, so sprites clip at its edges */
+    int bpp = render_bytes_per_pixel(rt.format);
+    render_target_init(&view, (unsigned char*)rt.base + (VIEW_Y * rt.stride + VIEW_X) * bpp,
+                       rt.stride, rt.format, VIEW_WIDTH, VIEW_HEIGHT);
+    view.stats = &frame_stats;
+    
+    int full = buffer_full[back];
+    int scrolled = buffer_camera[back].x != camera.x || buffer_camera[back].y != camera.y;
+    
+    /* Full redraws cover the view with the static layer, so only old
+     * text needs erasing on the CPU path; the GE clears the whole buffer */
+    if (render_backend == RENDER_BACKEND_GU) {
+        gu_begin_frame(&rt, full);
+        gu_set_scissor(VIEW_X, VIEW_Y, VIEW_WIDTH, VIEW_HEIGHT);
+        if (full) {
+            frame_stats.pixels_written += SCREEN_WIDTH * SCREEN_HEIGHT;
+            hud_forget(&rt);
         }
+    } else if (full) {
+        hud_erase(&rt);
     }
     
-    /* Count boxes in goals */
-    ctx->boxes_in_goal = 0;
-    for (int y = 0; y < FIELD_HEIGHT; y++) {
-        for (int x = 0; x < FIELD_WIDTH; x++) {
-            if (ctx->field[y][x] == TILE_GOAL) {
-                /* Check if a box is on this goal */
-                /* (In this simple version, we'll just check if all boxes are placed) */
-            }
-        }
+    if (full || scrolled) {
+        repaint_view(&view, buffer_sprites[back]);
+        buffer_camera[back] = camera;
+        buffer_full[back] = 0;
+    } else {
+        update_sprites(&view, buffer_sprites[back]);
     }
     
-    /* Check for SELECT button to quit (press, not hold) */
-    if ((pad->Buttons & PSP_CTRL_SELECT) && !(oldpad.Buttons & PSP_CTRL_SELECT)) {
-        ctx->state = GAME_QUIT;
-    }
+    /* One display list per frame; the GE must finish before CPU text */
+    if (render_backend == RENDER_BACKEND_GU)
+        gu_end_frame();
     
-    oldpad = *pad;
+    /* Text goes last so the field never covers the state message */
+    if (full)
+        render_text(&rt, ctx);
+    render_hint_text(&rt, back, full);
 }
 
-/* Render game graphics */
-void game_render(GameContext* ctx)
+#ifndef SF_HOST
+/* One frame at 59.94 Hz, and how much of it the hint search may take:
+ * at most HINT_BUDGET_US, and never the last HINT_MARGIN_US before vblank,
+ * which the flip and any overrun of the search's estimates use */
+#define GAME_FRAME_US 16683
+#define HINT_BUDGET_US 4000
+#define HINT_MARGIN_US 2000
+
+/* Moves of the game being played, for L and R */
+static UndoHistory history;
+
+/* Presses of the game being played, from every controller sample */
+static InputQueue input_queue;
+
+/* The controller's sample buffer holds this many */
+#define CTRL_BUFFER_SAMPLES 64
+
+const InputStats* game_input_stats(int player_num)
 {
-    pspDebugScreenClear();
+    return &input_queue.player[player_num - 1].stats;
+}
+
+/* Pad buttons and the input bits they hold */
+static const struct {
+    unsigned int button;
+    SimInput input;
+} pad_map[] = {
+    /* Player 1 controls: D-pad */
+    { PSP_CTRL_UP, INPUT_P1_UP },
+    { PSP_CTRL_DOWN, INPUT_P1_DOWN },
+    { PSP_CTRL_LEFT, INPUT_P1_LEFT },
+    { PSP_CTRL_RIGHT, INPUT_P1_RIGHT },
+    /* Player 2 controls: Action buttons (ABXO mapped as directions) */
+    { PSP_CTRL_TRIANGLE, INPUT_P2_UP },
+    { PSP_CTRL_CROSS, INPUT_P2_DOWN },
+    { PSP_CTRL_SQUARE, INPUT_P2_LEFT },
+    { PSP_CTRL_CIRCLE, INPUT_P2_RIGHT },
+    { PSP_CTRL_SELECT, INPUT_QUIT }
+};
+
+/* Input bits for the pad buttons down */
+static SimInput pad_input(unsigned int buttons)
+{
+    SimInput input = 0;
     
-    /* Draw title at top */
-    pspDebugScreenSetXY(15, 0);
-    printf("SPLIT-FIELD - Level %d", ctx->level);
-    
-    /* Draw field */
-    for (int y = 0; y < FIELD_HEIGHT; y++) {
-        for (int x = 0; x < FIELD_WIDTH; x++) {
-            int screen_x = FIELD_OFFSET_X + (x * TILE_SIZE);
-            int screen_y = FIELD_OFFSET_Y + (y * TILE_SIZE);
-            
-            unsigned int color = 0xFF202020; /* Dark gray background */
-            
-            switch (ctx->field[y][x]) {
-                case TILE_EMPTY:
-                    color = 0xFF101010;
-                    break;
-                case TILE_WALL:
-                    color = 0xFF666666;
-                    break;
-                case TILE_BOX:
-                    color = 0xFF996633; /* Brown */
-                    break;
-                case TILE_GHOST_BOX:
-                    color = 0xFF9966FF; /* Purple */
-                    break;
-                case TILE_ENEMY:
-                    color = 0xFFFF0000; /* Red */
-                    break;
-                case TILE_GOAL:
-                    color = 0xFF00FF00; /* Green */
-                    break;
-                case TILE_BARRIER:
-                    color = 0xFFFFFF00; /* Yellow barrier */
-                    break;
-            }
-            
-            draw_rect(screen_x, screen_y, TILE_SIZE, TILE_SIZE, color);
-            
-            /* Draw tile border for better visibility */
-            if (ctx->field[y][x] != TILE_EMPTY) {
-                draw_tile_border(screen_x, screen_y, TILE_SIZE, 0xFF000000);
-            }
+    for (int i = 0; i < (int)(sizeof(pad_map) / sizeof(pad_map[0])); i++) {
+        if (buttons & pad_map[i].button)
+            input |= pad_map[i].input;
+    }
+    return input;
+}
+
+/* Feed the queue the samples taken since the newest it has, then the
+ * latch; returns the buttons the latch saw made */
+static unsigned int sample_pad(unsigned int* last_stamp)
+{
+    SceCtrlData samples[CTRL_BUFFER_SAMPLES];
+    SceCtrlLatch latch;
+    
+    int count = sceCtrlPeekBufferPositive(samples, CTRL_BUFFER_SAMPLES);
+    for (int i = 0; i < count; i++) {
+        if ((int)(samples[i].TimeStamp - *last_stamp) > 0) {
+            input_sample(&input_queue, pad_input(samples[i].Buttons));
+            *last_stamp = samples[i].TimeStamp;
         }
     }
     
-    /* Draw mirror boxes */
-    for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
-        int screen_x = FIELD_OFFSET_X + (ctx->mirror_boxes[i].x * TILE_SIZE);
-        int screen_y = FIELD_OFFSET_Y + (ctx->mirror_boxes[i].y * TILE_SIZE);
-        
-        /* Color based on owner */
-        unsigned int box_color = (ctx->mirror_boxes[i].owner == 1) ? 0xFFFF8844 : 0xFF4488FF;
-        draw_rect(screen_x, screen_y, TILE_SIZE, TILE_SIZE, box_color);
-        draw_tile_border(screen_x, screen_y, TILE_SIZE, 0xFF000000);
-    }
+    sceCtrlReadLatch(&latch);
+    input_latch(&input_queue, pad_input(latch.uiMake));
+    return latch.uiMake;
+}
+
+/* Show the end screen until any button is pressed */
+static void wait_end_screen(GameContext* ctx)
+{
+    SceCtrlData pad;
     
-    /* Draw moving enemies */
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        if (ctx->enemies[i].active) {
-            int screen_x = FIELD_OFFSET_X + (ctx->enemies[i].x * TILE_SIZE);
-            int screen_y = FIELD_OFFSET_Y + (ctx->enemies[i].y * TILE_SIZE);
-            
-            /* Pulsing red for moving enemies */
-            draw_rect(screen_x + 2, screen_y + 2, TILE_SIZE - 4, TILE_SIZE - 4, 0xFFFF0000);
-            draw_tile_border(screen_x + 2, screen_y + 2, TILE_SIZE - 4, 0xFF880000);
-        }
-    }
+    if (ctx->sim.state != GAME_WIN && ctx->sim.state != GAME_LOSE)
+        return;
     
-    /* Draw players */
-    int p1_screen_x = FIELD_OFFSET_X + (ctx->player1.x * TILE_SIZE);
-    int p1_screen_y = FIELD_OFFSET_Y + (ctx->player1.y * TILE_SIZE);
-    draw_rect(p1_screen_x + 2, p1_screen_y + 2, TILE_SIZE - 4, TILE_SIZE - 4, 0xFFFF4444);
-    draw_tile_border(p1_screen_x + 2, p1_screen_y + 2, TILE_SIZE - 4, 0xFF000000);
-    
-    int p2_screen_x = FIELD_OFFSET_X + (ctx->player2.x * TILE_SIZE);
-    int p2_screen_y = FIELD_OFFSET_Y + (ctx->player2.y * TILE_SIZE);
-    draw_rect(p2_screen_x + 2, p2_screen_y + 2, TILE_SIZE - 4, TILE_SIZE - 4, 0xFF4444FF);
-    draw_tile_border(p2_screen_x + 2, p2_screen_y + 2, TILE_SIZE - 4, 0xFF000000);
-    
-    /* Draw instructions at bottom */
-    pspDebugScreenSetXY(2, 32);
-    printf("P1(Red) D-PAD | P2(Blue) ABXO | YELLOW=Barrier");
-    pspDebugScreenSetXY(2, 33);
-    printf("Orange boxes=P1 | Blue boxes=P2 | MIRROR MOVES!");
-    pspDebugScreenSetXY(2, 34);
-    printf("Push to GREEN goals | Avoid moving RED enemies | SELECT:Quit");
+    game_render(ctx);
+    display_flip(1);
     
-    /* Draw game state messages */
-    if (ctx->state == GAME_WIN) {
-        pspDebugScreenSetXY(20, 15);
-        printf("*** LEVEL COMPLETE! ***");
-    } else if (ctx->state == GAME_LOSE) {
-        pspDebugScreenSetXY(22, 15);
-        printf("*** GAME OVER! ***");
+    /* Wait for any button to go on */
+    while (1) {
+        sceCtrlReadBufferPositive(&pad, 1);
+        if (pad.Buttons) {
+            break;
+        }
+        sceDisplayWaitVblankStart();
     }
 }
 
-/* Main game loop */
+/* Main game loop; every update's input is recorded and the game saved to
+ * GAME_REPLAY_PATH when it ends, and the next level is preloaded. START
+ * turns the hint on and off; while on, the search runs in what each frame
+ * has left after rendering. L undoes a move and R redoes it; a game with
+ * moves undone is no longer what its inputs replay, so it is not saved.
+ * The players' presses come through the input queue, from every sample
+ * the controller took. */
 void game_run(GameContext* ctx)
 {
     SceCtrlData pad;
-    
-    while (ctx->state == GAME_RUNNING) {
-        sceCtrlReadBufferPositive(&pad, 1);
-        game_update(ctx, &pad);
+    SceCtrlLatch latch;
+    Replay replay;
+    int recording = 1;
+    
+    /* Sample faster than the frame rate; buttons down now, and the latch
+     * so far, belong to the menu */
+    int old_cycle = sceCtrlSetSamplingCycle(GAME_SAMPLING_CYCLE);
+    sceCtrlPeekBufferPositive(&pad, 1);
+    sceCtrlReadLatch(&latch);
+    unsigned int last_stamp = pad.TimeStamp;
+    input_init(&input_queue, pad_input(pad.Buttons), INPUT_REPEAT_DELAY, INPUT_REPEAT_PERIOD);
+    
+    replay_init(&replay, ctx->level);
+    hint_init(&hint);
+    undo_init(&history, ctx);
+    
+    /* The next level loads in the background while this one is played */
+    preload_request(ctx->level + 1);
+    unsigned int frame_start = hint_clock_us();
+    
+    while (ctx->sim.state == GAME_RUNNING) {
+        unsigned int pressed = sample_pad(&last_stamp);
+        if (pressed & PSP_CTRL_START) {
+            if (hint.state == HINT_OFF)
+                hint_request(&hint, ctx);
+            else
+                hint_cancel(&hint);
+        }
+        if (((pressed & PSP_CTRL_LTRIGGER) && undo_step_back(&history, ctx)) ||
+            ((pressed & PSP_CTRL_RTRIGGER) && undo_step_forward(&history, ctx)))
+            recording = 0;
+        
+        SimInput input = input_next(&input_queue, ctx);
+        sim_step(ctx, input);
+        undo_record(&history, ctx);
+        
+        /* Out of memory: keep playing, unrecorded */
+        if (recording && replay_record(&replay, input, ctx) < 0)
+            recording = 0;
+        
         game_render(ctx);
-        sceDisplayWaitVblankStart();
+        
+        unsigned int deadline = frame_start + GAME_FRAME_US - HINT_MARGIN_US;
+        unsigned int budget_end = hint_clock_us() + HINT_BUDGET_US;
+        if ((int)(budget_end - deadline) < 0)
+            deadline = budget_end;
+        hint_step(&hint, ctx, deadline);
+        
+        display_flip(1);
+        frame_start = hint_clock_us();
     }
     
-    /* Show end screen briefly */
-    if (ctx->state == GAME_WIN || ctx->state == GAME_LOSE) {
+    if (recording)
+        replay_save(&replay, GAME_REPLAY_PATH);
+    replay_free(&replay);
+    
+    hint_free(&hint);
+    sceCtrlSetSamplingCycle(old_cycle);
+    wait_end_screen(ctx);
+}
+
+/* Play a recording back at game speed; SELECT stops it */
+void game_replay(GameContext* ctx, const Replay* replay, ReplayPlayer* player)
+{
+    SceCtrlData pad;
+    
+    replay_player_init(player, replay);
+    if (replay->level != ctx->level)
+        return;
+    
+    while (replay_player_step(player, ctx)) {
         game_render(ctx);
-        sceDisplayWaitVblankStart();
+        display_flip(1);
         
-        /* Wait for any button to return to menu */
-        while (1) {
-            sceCtrlReadBufferPositive(&pad, 1);
-            if (pad.Buttons) {
-                break;
+        sceCtrlPeekBufferPositive(&pad, 1);
+        if (pad.Buttons & PSP_CTRL_SELECT) {
+            /* Let go first, or the menu would take it as exit */
+            while (pad.Buttons & PSP_CTRL_SELECT) {
+                sceDisplayWaitVblankStart();
+                sceCtrlPeekBufferPositive(&pad, 1);
             }
-            sceDisplayWaitVblankStart();
+            return;
         }
     }
+    
+    wait_end_screen(ctx);
 }
+#endif
 
 /* Cleanup game resources */
 void game_cleanup(GameContext* ctx)
 {
-    /* Nothing to cleanup in this simple version */
-    (void)ctx;
+    sim_cleanup(ctx);
 }
@@ -1,86 +1,74 @@
 /*
  * Split-Field Game Header
- * Two-player cooperative puzzle game for PSP
+ * Two-player cooperative puzzle game for PSP: the front end that reads
+ * the pad and draws a running simulation (sim.h)
  */
 
 #ifndef GAME_H
 #define GAME_H
 
-#include <pspkernel.h>
-#include <pspctrl.h>
+#include "sim.h"
+#include "replay.h"
+#include "input.h"
+#include "render.h"
 
 /* Game constants */
 #define SCREEN_WIDTH 480
 #define SCREEN_HEIGHT 272
-#define FIELD_WIDTH 20
-#define FIELD_HEIGHT 14
 #define TILE_SIZE 16
-#define FIELD_OFFSET_X ((SCREEN_WIDTH - (FIELD_WIDTH * TILE_SIZE)) / 2)
-#define FIELD_OFFSET_Y ((SCREEN_HEIGHT - (FIELD_HEIGHT * TILE_SIZE)) / 2)
 
-/* Game states */
-typedef enum {
-    GAME_RUNNING,
-    GAME_WIN,
-    GAME_LOSE,
-    GAME_QUIT
-} GameState;
+/* Screen area the field scrolls in, between the HUD's top and bottom rows */
+#define VIEW_X 0
+#define VIEW_Y 24
+#define VIEW_WIDTH SCREEN_WIDTH
+#define VIEW_HEIGHT 224
+
+/* Where game_run saves each game's recording: next to the EBOOT */
+#define GAME_REPLAY_PATH "replay.sfr"
+
+/* Levels the game plays when the file is there, next to the EBOOT: a
+ * binary pack (pack.h), read a level at a time, or else text (level.h) */
+#define GAME_PACK_PATH "levels.sfl"
+#define GAME_LEVELS_PATH "levels.txt"
 
-/* Entity types */
+/* Controller sampling cycle while playing, in microseconds: 5555 (about
+ * three samples a frame) to 20000, or 0 for once per vblank */
+#ifndef GAME_SAMPLING_CYCLE
+#define GAME_SAMPLING_CYCLE 5555
+#endif
+
+/* Render backends behind game_render */
 typedef enum {
-    TILE_EMPTY = 0,
-    TILE_WALL,
-    TILE_BOX,
-    TILE_GHOST_BOX,  /* Box that only one player can move */
-    TILE_ENEMY,
-    TILE_GOAL,
-    TILE_BARRIER     /* Vertical barrier in middle */
-} TileType;
-
-/* Player structure */
-typedef struct {
-    int x;
-    int y;
-    int color;  /* For visual distinction */
-} Player;
-
-/* Enemy structure */
-typedef struct {
-    int x;
-    int y;
-    int target_player;  /* 1 or 2 */
-    int active;
-} Enemy;
-
-/* Mirror Box structure */
-typedef struct {
-    int x;
-    int y;
-    int owner;  /* 1 or 2 - which player controls it */
-} MirrorBox;
-
-#define MAX_ENEMIES 4
-#define MAX_MIRROR_BOXES 4
-
-/* Game context */
-typedef struct {
-    Player player1;  /* Controlled by D-pad */
-    Player player2;  /* Controlled by ABXO buttons */
-    TileType field[FIELD_HEIGHT][FIELD_WIDTH];
-    Enemy enemies[MAX_ENEMIES];
-    MirrorBox mirror_boxes[MAX_MIRROR_BOXES];
-    GameState state;
-    int level;
-    int boxes_in_goal;
-    int total_boxes;
-    int enemy_move_counter;  /* For slow enemy movement */
-} GameContext;
+    RENDER_BACKEND_SOFTWARE = 0,  /* CPU span fills */
+    RENDER_BACKEND_GU             /* Batched GE sprite quads */
+} RenderBackend;
 
 /* Function prototypes */
 void game_init(GameContext* ctx);
+
+/* Set up a level by number from GAME_PACK_PATH, through the preloader
+ * when it is running, or GAME_LEVELS_PATH, or the levels compiled in
+ * when neither holds it; returns -1 if there is no such level */
+int game_load_level(GameContext* ctx, int level);
+
+/* Levels to choose from: the highest number in the pack or the text
+ * file, or compiled in, at least 1 */
+int game_level_count(void);
 void game_run(GameContext* ctx);
-void game_update(GameContext* ctx, SceCtrlData* pad);
+
+/* Presses, moves, drops and latency of player 1 or 2 in the last game_run */
+const InputStats* game_input_stats(int player_num);
+
+/* Feed a recording to a game set up on its level, rendering as it goes.
+ * player is left where playback stopped: replay_player_matched tells if
+ * the game followed the recording to the end. */
+void game_replay(GameContext* ctx, const Replay* replay, ReplayPlayer* player);
+
 void game_render(GameContext* ctx);
 void game_cleanup(GameContext* ctx);
 
+/* Pixels and cells written by the last game_render call */
+const RenderStats* game_render_stats(void);
+void game_set_render_backend(RenderBackend backend);
+
 #endif /* GAME_H */
@@ -0,0 +1,185 @@
+/*
+ * Split-Field Hints
+ * Time-sliced solver runs within a pool allocated on first use
+ */
+
+#include "hint.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SF_HOST
+#include <time.h>
+#else
+#include <pspthreadman.h>
+#endif
+
+unsigned int hint_clock_us(void)
+{
+#ifdef SF_HOST
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned int)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+#else
+    return sceKernelGetSystemTimeLow();
+#endif
+}
+
+/* Microseconds from now until deadline, negative once it has passed */
+static int time_left(unsigned int deadline)
+{
+    return (int)(deadline - hint_clock_us());
+}
+
+void hint_init(Hint* hint)
+{
+    memset(hint, 0, sizeof(Hint));
+    hint->state = HINT_OFF;
+    hint->init_us = HINT_INIT_US;
+    hint->clear_us = HINT_CLEAR_US;
+    hint->chunk_us = HINT_CHUNK_US;
+}
+
+/* Players and boxes: everything the search starts from */
+static int searched_slot(int slot)
+{
+    return slot < ENTITY_ENEMY0 || slot >= ENTITY_PLAYER1;
+}
+
+static int moved_on(const Hint* hint, const GameContext* ctx)
+{
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        if (searched_slot(slot) && (hint->x[slot] != ctx->sim.x[slot] || hint->y[slot] != ctx->sim.y[slot]))
+            return 1;
+    }
+    return 0;
+}
+
+void hint_request(Hint* hint, const GameContext* ctx)
+{
+    memcpy(hint->x, ctx->sim.x, sizeof(hint->x));
+    memcpy(hint->y, ctx->sim.y, sizeof(hint->y));
+    hint->state = HINT_SEARCHING;
+    hint->started = 0;
+    hint->cleared = 0;
+    memset(&hint->stats, 0, sizeof(hint->stats));
+}
+
+void hint_cancel(Hint* hint)
+{
+    hint->state = HINT_OFF;
+}
+
+void hint_free(Hint* hint)
+{
+    free(hint->pool);
+    hint->pool = NULL;
+    hint->pool_size = 0;
+    hint->state = HINT_OFF;
+}
+
+/* A pool big enough for this level's search, kept from the last one if
+ * it is; returns -1 if memory runs out */
+static int reserve_pool(Hint* hint, const GameContext* ctx)
+{
+    int size = solver_block_size(ctx->field_width, ctx->field_height, HINT_MAX_STATES);
+
+    if (hint->pool_size >= size)
+        return 0;
+    free(hint->pool);
+    hint->pool = (unsigned char*)malloc(size);
+    hint->pool_size = hint->pool ? size : 0;
+    return hint->pool ? 0 : -1;
+}
+
+/* The search is over: point the way it found, or toward the state
+ * nearest the goal if the pool filled first */
+static void finish(Hint* hint)
+{
+    SolverStatus status = hint->solver.status;
+
+    if (status != SOLVER_UNSOLVABLE && solver_first_move(&hint->solver, &hint->move))
+        hint->state = HINT_READY;
+    else
+        hint->state = HINT_NONE;
+}
+
+void hint_step(Hint* hint, const GameContext* ctx, unsigned int deadline)
+{
+    if (hint->state == HINT_OFF)
+        return;
+    if (moved_on(hint, ctx))
+        hint_request(hint, ctx);
+    if (hint->state != HINT_SEARCHING)
+        return;
+
+    unsigned int start = hint_clock_us();
+    long before = hint->solver.expanded;
+
+    /* Set-up, then the table emptied a slice at a time, then the search:
+     * each step only with time left for the slowest of its kind yet */
+    if (!hint->started) {
+        if (time_left(deadline) <= (int)hint->init_us)
+            return;
+        if (reserve_pool(hint, ctx) < 0 ||
+            solver_prepare(&hint->solver, ctx, hint->pool, hint->pool_size) < 0) {
+            hint->state = HINT_NONE;
+            return;
+        }
+        solver_set_weight(&hint->solver, HINT_WEIGHT);
+        hint->started = 1;
+        before = 0;
+
+        unsigned int took = hint_clock_us() - start;
+        if (took > hint->init_us)
+            hint->init_us = took;
+    }
+
+    int slots = solver_table_slots(&hint->solver);
+    while (hint->cleared < slots && time_left(deadline) > (int)hint->clear_us) {
+        int count = slots - hint->cleared < HINT_CLEAR_SLOTS ? slots - hint->cleared : HINT_CLEAR_SLOTS;
+        unsigned int t0 = hint_clock_us();
+        solver_clear_table(&hint->solver, hint->cleared, count);
+        hint->cleared += count;
+        if (hint->cleared == slots)
+            solver_start(&hint->solver);
+        unsigned int took = hint_clock_us() - t0;
+        if (took > hint->clear_us)
+            hint->clear_us = took;
+    }
+
+    if (hint->cleared == slots) {
+        while (hint->solver.status == SOLVER_SEARCHING && time_left(deadline) > (int)hint->chunk_us) {
+            unsigned int t0 = hint_clock_us();
+            solver_run(&hint->solver, HINT_CHUNK);
+            unsigned int took = hint_clock_us() - t0;
+            if (took > hint->chunk_us)
+                hint->chunk_us = took;
+        }
+    }
+
+    HintStats* stats = &hint->stats;
+    stats->frames++;
+    stats->last_expanded = (unsigned int)(hint->solver.expanded - before);
+    if (stats->last_expanded > stats->max_expanded)
+        stats->max_expanded = stats->last_expanded;
+    stats->last_us = hint_clock_us() - start;
+    if (stats->last_us > stats->max_us)
+        stats->max_us = stats->last_us;
+    stats->expanded = hint->solver.expanded;
+
+    if (hint->cleared == slots && hint->solver.status != SOLVER_SEARCHING)
+        finish(hint);
+}
+
+int hint_target(const Hint* hint, int* x, int* y)
+{
+    static const int step_x[4] = { 0, 0, -1, 1 };
+    static const int step_y[4] = { -1, 1, 0, 0 };
+
+    if (hint->state != HINT_READY)
+        return 0;
+    int slot = ENTITY_PLAYER(hint->move.player);
+    *x = hint->x[slot] + step_x[hint->move.dir];
+    *y = hint->y[slot] + step_y[hint->move.dir];
+    return 1;
+}
@@ -0,0 +1,100 @@
+/*
+ * Split-Field Hints
+ * The solver run on the device a slice at a time: a weighted best-first
+ * search from the game's current state spread over as many frames as it
+ * needs, each frame's share ending at a deadline the caller sets before
+ * vblank. Its memory is one pool, sized for the level and a bounded
+ * number of states, allocated as the first search starts and kept until
+ * hint_free, so nothing else is allocated while it runs. The hint is the
+ * first move toward the solution or, if the pool fills first, toward the
+ * state nearest the goal the search reached. Moving enemies are ignored,
+ * as the solver does.
+ */
+
+#ifndef HINT_H
+#define HINT_H
+
+#include "sim.h"
+#include "solver.h"
+
+/* States the pool holds: 2.6 MB with the level's share on top (8 KB for
+ * 20x14, 1.9 MB for 256x256). A search that fills it hints toward the
+ * best state it reached; from the stock level's start that takes about
+ * 83k states at HINT_WEIGHT, so the hint there is toward a state nearer
+ * the goal, and the search is begun again once the player moves. */
+#define HINT_MAX_STATES 49152
+
+/* f = g + HINT_WEIGHT * h: longer solutions, found with far fewer states */
+#define HINT_WEIGHT 8
+
+/* Node expansions between looks at the clock */
+#define HINT_CHUNK 16
+
+/* Table slots emptied between looks at the clock: 64 KB */
+#define HINT_CLEAR_SLOTS 8192
+
+/* What set-up, a slice of the table and a chunk are taken to cost until
+ * one has been timed: slow enough for the device's first frame. A share
+ * shorter than these never starts. */
+#define HINT_INIT_US 1500
+#define HINT_CLEAR_US 500
+#define HINT_CHUNK_US 1000
+
+typedef enum {
+    HINT_OFF,
+    HINT_SEARCHING,
+    HINT_READY,      /* move holds the hint */
+    HINT_NONE        /* No way to win from here */
+} HintState;
+
+/* Search cost, for tuning the per-frame budget */
+typedef struct {
+    unsigned int frames;          /* Frames the current search ran in */
+    unsigned int last_expanded;   /* Nodes expanded in the last of them */
+    unsigned int max_expanded;    /* Most in any one */
+    unsigned int last_us;         /* Time the last frame's share took */
+    unsigned int max_us;
+    long expanded;                /* Over the whole search */
+} HintStats;
+
+typedef struct {
+    HintState state;
+    int started;                  /* solver_prepare done for the snapshot */
+    int cleared;                  /* Table slots emptied since */
+    unsigned char x[ENTITY_COUNT];    /* Players and boxes searched from */
+    unsigned char y[ENTITY_COUNT];
+    Solver solver;
+    SolverMove move;
+    unsigned char* pool;          /* Search memory, NULL until first needed */
+    int pool_size;
+    /* Slowest step of each kind so far, from the guesses up: none starts
+     * without that much time left */
+    unsigned int init_us;         /* solver_prepare */
+    unsigned int clear_us;        /* HINT_CLEAR_SLOTS of the table */
+    unsigned int chunk_us;        /* HINT_CHUNK expansions */
+    HintStats stats;
+} Hint;
+
+/* Microsecond clock the deadlines are on; wraps every 71 minutes */
+unsigned int hint_clock_us(void);
+
+void hint_init(Hint* hint);
+
+/* Start a search from the game as it stands. There is one pool, so one
+ * search at a time. */
+void hint_request(Hint* hint, const GameContext* ctx);
+void hint_cancel(Hint* hint);
+
+/* Cancel any search and free the pool; call on leaving the level */
+void hint_free(Hint* hint);
+
+/* One frame's share of the search, ending before the clock reaches
+ * deadline. A search whose players or boxes have moved on since it
+ * started is begun again from where they are now. */
+void hint_step(Hint* hint, const GameContext* ctx, unsigned int deadline);
+
+/* The cell the hinted player should step into; returns 0 if no hint is
+ * ready */
+int hint_target(const Hint* hint, int* x, int* y);
+
+#endif /* HINT_H */
@@ -0,0 +1,195 @@
+/*
+ * Split-Field HUD Text
+ * The 1-bit font is expanded once per pixel format into a glyph cache;
+ * a line is then built from glyph rows and kept until its text changes,
+ * so drawing it is a plain row blit. Placement matches the debug screen
+ * (8x8 glyphs every 7 pixels, later glyphs overwriting the 8th column).
+ * Builds for the PSP and as a host-native target.
+ */
+
+#include "hud.h"
+#include "kernels.h"
+#include <string.h>
+
+#define HUD_GLYPHS 256
+#define HUD_GLYPH_PIXELS (8 * HUD_CHAR_HEIGHT)
+#define HUD_MAX_TARGETS 4
+#define HUD_MAX_DRAWN 32
+
+/* Debug-screen defaults: white on transparent black */
+#define HUD_FOREGROUND 0xFFFFFFFF
+#define HUD_BACKGROUND 0x00000000
+
+typedef struct {
+    short x, y, w, h;
+} HudRect;
+
+/* Rectangles drawn into one framebuffer since it was last erased */
+typedef struct {
+    const void* base;
+    int count;
+    HudRect rect[HUD_MAX_DRAWN];
+} HudTarget;
+
+static const unsigned char* hud_font;
+static int glyph_format = -1;
+static unsigned char glyphs[HUD_GLYPHS * HUD_GLYPH_PIXELS * 4] __attribute__((aligned(16)));
+static HudTarget targets[HUD_MAX_TARGETS];
+static HudStats stats;
+
+void hud_init(const unsigned char* font)
+{
+    hud_font = font;
+    glyph_format = -1;
+    memset(targets, 0, sizeof(targets));
+    memset(&stats, 0, sizeof(stats));
+}
+
+const HudStats* hud_stats(void)
+{
+    return &stats;
+}
+
+static void bake_glyphs(int format)
+{
+    unsigned int fg = render_convert_color(HUD_FOREGROUND, format);
+    unsigned int bg = render_convert_color(HUD_BACKGROUND, format);
+
+    for (int c = 0; c < HUD_GLYPHS; c++) {
+        const unsigned char* bits = hud_font + c * 8;
+
+        for (int i = 0; i < HUD_GLYPH_PIXELS; i++) {
+            unsigned int pixel = (bits[i / 8] & (0x80 >> (i % 8))) ? fg : bg;
+
+            if (format == RENDER_FORMAT_8888)
+                ((unsigned int*)glyphs)[c * HUD_GLYPH_PIXELS + i] = pixel;
+            else
+                ((unsigned short*)glyphs)[c * HUD_GLYPH_PIXELS + i] = (unsigned short)pixel;
+        }
+    }
+
+    glyph_format = format;
+    stats.glyph_bakes++;
+}
+
+static void rasterise(HudText* t, int format)
+{
+    int bpp = render_bytes_per_pixel(format);
+    int len = strlen(t->text);
+
+    if (glyph_format != format)
+        bake_glyphs(format);
+
+    /* Left to right, so each glyph overwrites the previous one's last column */
+    for (int i = 0; i < len; i++) {
+        const unsigned char* glyph = glyphs + (unsigned char)t->text[i] * HUD_GLYPH_PIXELS * bpp;
+        unsigned char* dst = t->pixels + i * HUD_CHAR_ADVANCE * bpp;
+
+        for (int row = 0; row < HUD_CHAR_HEIGHT; row++) {
+            if (bpp == 4)
+                kernel_copy32((unsigned int*)dst, (const unsigned int*)glyph, 8);
+            else
+                memcpy(dst, glyph, 8 * 2);
+            glyph += 8 * bpp;
+            dst += HUD_TEXT_WIDTH * bpp;
+        }
+    }
+
+    t->format = format;
+    t->width = len ? len * HUD_CHAR_ADVANCE + 1 : 0;
+    stats.text_renders++;
+}
+
+int hud_text_set(HudText* t, const char* text, int format)
+{
+    if (t->width && t->format == format &&
+        strncmp(t->text, text, HUD_MAX_CHARS) == 0)
+        return 0;
+
+    strncpy(t->text, text, HUD_MAX_CHARS);
+    t->text[HUD_MAX_CHARS] = '\0';
+    rasterise(t, format);
+    return 1;
+}
+
+static HudTarget* find_target(const void* base)
+{
+    HudTarget* free_slot = NULL;
+
+    for (int i = 0; i < HUD_MAX_TARGETS; i++) {
+        if (targets[i].base == base)
+            return &targets[i];
+        if (!targets[i].base && !free_slot)
+            free_slot = &targets[i];
+    }
+
+    if (free_slot) {
+        free_slot->base = base;
+        free_slot->count = 0;
+    }
+    return free_slot;
+}
+
+static void remember(const RenderTarget* rt, int x, int y, int w, int h)
+{
+    HudTarget* target = find_target(rt->base);
+    if (!target)
+        return;
+
+    for (int i = 0; i < target->count; i++) {
+        HudRect* r = &target->rect[i];
+        if (r->x == x && r->y == y && r->w >= w && r->h >= h)
+            return;
+    }
+
+    if (target->count < HUD_MAX_DRAWN) {
+        HudRect* r = &target->rect[target->count++];
+        r->x = x; r->y = y; r->w = w; r->h = h;
+        return;
+    }
+
+    /* Out of slots: grow the last rectangle to cover the new one */
+    HudRect* r = &target->rect[HUD_MAX_DRAWN - 1];
+    int x1 = (r->x + r->w > x + w) ? r->x + r->w : x + w;
+    int y1 = (r->y + r->h > y + h) ? r->y + r->h : y + h;
+    if (x < r->x) r->x = x;
+    if (y < r->y) r->y = y;
+    r->w = x1 - r->x;
+    r->h = y1 - r->y;
+}
+
+void hud_text_draw(HudText* t, const RenderTarget* rt, int col, int row)
+{
+    if (t->format != rt->format)
+        rasterise(t, rt->format);
+    if (!t->width)
+        return;
+
+    int x = col * HUD_CHAR_ADVANCE;
+    int y = row * HUD_CHAR_HEIGHT;
+
+    render_blit(rt, x, y, t->width, HUD_CHAR_HEIGHT, t->pixels, HUD_TEXT_WIDTH);
+    remember(rt, x, y, t->width, HUD_CHAR_HEIGHT);
+    stats.text_blits++;
+}
+
+void hud_erase(const RenderTarget* rt)
+{
+    HudTarget* target = find_target(rt->base);
+    if (!target)
+        return;
+
+    unsigned int bg = render_convert_color(HUD_BACKGROUND, rt->format);
+    for (int i = 0; i < target->count; i++) {
+        HudRect* r = &target->rect[i];
+        render_fill_rect(rt, r->x, r->y, r->w, r->h, bg);
+    }
+    target->count = 0;
+}
+
+void hud_forget(const RenderTarget* rt)
+{
+    HudTarget* target = find_target(rt->base);
+    if (target)
+        target->count = 0;
+}
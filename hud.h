@@ -0,0 +1,48 @@
+/*
+ * Split-Field HUD Text
+ * Strings rasterised once into native-format bitmaps and blitted by rows
+ */
+
+#ifndef HUD_H
+#define HUD_H
+
+#include "render.h"
+
+/* Debug-screen character grid: 8x8 glyphs on a 7-pixel advance */
+#define HUD_CHAR_ADVANCE 7
+#define HUD_CHAR_HEIGHT 8
+#define HUD_MAX_CHARS 64
+#define HUD_TEXT_WIDTH (HUD_MAX_CHARS * HUD_CHAR_ADVANCE + 1)
+
+/* One cached line of text; re-rasterised only when text or format changes */
+typedef struct {
+    char text[HUD_MAX_CHARS + 1];
+    int format;
+    int width;   /* Pixels, 0 until rasterised */
+    unsigned char pixels[HUD_TEXT_WIDTH * HUD_CHAR_HEIGHT * 4] __attribute__((aligned(16)));
+} HudText;
+
+typedef struct {
+    unsigned int glyph_bakes;   /* Glyph cache rebuilds (format changes) */
+    unsigned int text_renders;  /* Lines rasterised from the glyph cache */
+    unsigned int text_blits;    /* Lines copied to a framebuffer */
+} HudStats;
+
+/* font: 8 bytes per glyph, 256 glyphs, MSB is the leftmost pixel (pspdebug msx layout) */
+void hud_init(const unsigned char* font);
+
+/* Returns 1 if the line had to be rasterised again */
+int hud_text_set(HudText* t, const char* text, int format);
+
+/* Blit at debug-screen cell (col, row) and remember the rectangle for hud_erase */
+void hud_text_draw(HudText* t, const RenderTarget* rt, int col, int row);
+
+/* Fill everything drawn into rt's buffer with the background, then forget it */
+void hud_erase(const RenderTarget* rt);
+
+/* Forget what was drawn into rt's buffer, e.g. after the buffer was cleared */
+void hud_forget(const RenderTarget* rt);
+
+const HudStats* hud_stats(void);
+
+#endif /* HUD_H */
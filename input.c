@@ -0,0 +1,117 @@
+/*
+ * Split-Field Input
+ * Per-player press queues between the controller's samples and sim_step
+ */
+
+#include "input.h"
+#include <string.h>
+
+static const SimInput player_moves[2] = { INPUT_P1_MOVES, INPUT_P2_MOVES };
+
+static void push(InputQueue* queue, PlayerInput* player, SimInput press)
+{
+    player->stats.presses++;
+    if (player->count == INPUT_QUEUE_SIZE) {
+        player->stats.dropped++;
+        return;
+    }
+    int slot = (player->head + player->count++) % INPUT_QUEUE_SIZE;
+    player->press[slot] = press;
+    player->when[slot] = queue->update;
+}
+
+void input_init(InputQueue* queue, SimInput down, int repeat_delay, int repeat_period)
+{
+    memset(queue, 0, sizeof(InputQueue));
+    queue->sample = down;
+    queue->repeat_delay = repeat_delay;
+    queue->repeat_period = repeat_period > 0 ? repeat_period : 1;
+}
+
+void input_sample(InputQueue* queue, SimInput down)
+{
+    SimInput made = down & ~queue->sample;
+
+    for (int p = 0; p < 2; p++) {
+        PlayerInput* player = &queue->player[p];
+        SimInput pressed = made & player_moves[p];
+
+        /* The press the latch already gave shows up in the first sample
+         * after it */
+        if (queue->fresh) {
+            pressed &= ~player->owed;
+            player->owed = 0;
+        }
+        for (SimInput bit = 1; bit <= pressed; bit <<= 1) {
+            if (pressed & bit) {
+                push(queue, player, bit);
+                player->held = bit;
+                player->held_since = queue->update;
+            }
+        }
+        player->seen |= made & player_moves[p];
+        if (!(down & player->held))
+            player->held = 0;
+    }
+    queue->sample = down;
+    queue->fresh = 0;
+}
+
+void input_latch(InputQueue* queue, SimInput made)
+{
+    for (int p = 0; p < 2; p++) {
+        PlayerInput* player = &queue->player[p];
+        SimInput missed = made & player_moves[p] & ~player->seen;
+
+        for (SimInput bit = 1; bit <= missed; bit <<= 1) {
+            if (missed & bit) {
+                push(queue, player, bit);
+                player->stats.latched++;
+            }
+        }
+        player->owed = missed;
+        player->seen = 0;
+    }
+    queue->fresh = 1;
+}
+
+SimInput input_next(InputQueue* queue, const GameContext* ctx)
+{
+    SimInput input = queue->sample & INPUT_QUIT;
+
+    for (int p = 0; p < 2; p++) {
+        PlayerInput* player = &queue->player[p];
+
+        if (queue->repeat_delay && player->held && player->count == 0) {
+            unsigned int held_for = queue->update - player->held_since;
+            if (held_for >= (unsigned int)queue->repeat_delay &&
+                (held_for - queue->repeat_delay) % queue->repeat_period == 0) {
+                push(queue, player, player->held);
+                player->stats.repeats++;
+            }
+        }
+
+        /* A press the same as the last update's would read as held: it
+         * waits an update */
+        if (player->count == 0 || ctx->sim.move_delay[p] > 0 || (queue->given & player->press[player->head]))
+            continue;
+
+        unsigned int latency = queue->update - player->when[player->head];
+        input |= player->press[player->head];
+        player->head = (player->head + 1) % INPUT_QUEUE_SIZE;
+        player->count--;
+        player->stats.moves++;
+        player->stats.latency += latency;
+        if (latency > player->stats.max_latency)
+            player->stats.max_latency = latency;
+    }
+
+    queue->given = input;
+    queue->update++;
+    return input;
+}
+
+int input_pending(const InputQueue* queue, int player_num)
+{
+    return queue->player[player_num - 1].count;
+}
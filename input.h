@@ -0,0 +1,78 @@
+/*
+ * Split-Field Input
+ * Pad samples to simulation input, with a queue of presses per player.
+ * The front end feeds every sample the controller took since the last
+ * frame, at its sampling cycle, so a tap that starts and ends between two
+ * frames still counts; then the latch, whose made bits catch a press
+ * whose samples were lost. Each update takes the next press of each
+ * player whose move delay is over and gives it to the simulation for
+ * that one update, so neither player waits on the other and no press is
+ * lost to a delay. A direction held repeats after a delay, per player.
+ * Platform-free: samples and latch come in as SimInput bits.
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "sim.h"
+
+/* Presses waiting per player; more are dropped and counted */
+#define INPUT_QUEUE_SIZE 8
+
+/* Updates a direction is held before it repeats, 0 for never, and then
+ * between repeats: a move and its delay take PLAYER_MOVE_DELAY + 1 */
+#define INPUT_REPEAT_DELAY 15
+#define INPUT_REPEAT_PERIOD (PLAYER_MOVE_DELAY + 1)
+
+/* One player's presses so far */
+typedef struct {
+    unsigned int presses;       /* Queued, from samples, latch and repeats */
+    unsigned int latched;       /* Of them, seen by the latch alone */
+    unsigned int repeats;       /* Of them, made by holding */
+    unsigned int moves;         /* Given to the simulation */
+    unsigned int dropped;       /* Lost to a full queue */
+    unsigned int latency;       /* Updates from press to move, summed */
+    unsigned int max_latency;   /* 0: the first update after its sample */
+} InputStats;
+
+typedef struct {
+    SimInput press[INPUT_QUEUE_SIZE];   /* A direction bit each */
+    unsigned int when[INPUT_QUEUE_SIZE];  /* Update it was queued on */
+    int head;
+    int count;
+    SimInput seen;              /* Directions pressed in samples since the latch */
+    SimInput owed;              /* Latched directions the next samples may show */
+    SimInput held;              /* Direction held longest, for repeats */
+    unsigned int held_since;
+    InputStats stats;
+} PlayerInput;
+
+typedef struct {
+    PlayerInput player[2];
+    SimInput sample;            /* Buttons down in the newest sample */
+    SimInput given;             /* Input of the last update */
+    int fresh;                  /* No sample since the latch */
+    unsigned int update;        /* Updates so far */
+    int repeat_delay;
+    int repeat_period;
+} InputQueue;
+
+/* Start with the buttons down now taken as held, not pressed, and these
+ * repeat timings in updates (repeat_delay 0 for none) */
+void input_init(InputQueue* queue, SimInput down, int repeat_delay, int repeat_period);
+
+/* One controller sample, oldest first: each direction newly down is a press */
+void input_sample(InputQueue* queue, SimInput down);
+
+/* The latch read after the frame's samples: a direction it saw made that
+ * the samples did not is a press too */
+void input_latch(InputQueue* queue, SimInput made);
+
+/* This update's input for sim_step: the next press of each player who may
+ * move, and quitting as held */
+SimInput input_next(InputQueue* queue, const GameContext* ctx);
+
+/* Presses of player 1 or 2 still waiting */
+int input_pending(const InputQueue* queue, int player_num);
+
+#endif /* INPUT_H */
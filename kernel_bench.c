@@ -0,0 +1,230 @@
+/*
+ * Split-Field Kernel Bench
+ * Runs every kernel over a spread of alignments and lengths, compares the
+ * bytes written (including guard words either side) with the scalar
+ * reference, then times clear, fill and tile blit against it.
+ */
+
+#include "kernel_bench.h"
+#include "kernels.h"
+#include "render.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef SF_HOST
+#include <time.h>
+#else
+#include <pspkernel.h>
+#include <pspthreadman.h>
+#endif
+
+#define BENCH_STRIDE 512
+#define BENCH_HEIGHT 272
+#define BENCH_WORDS (BENCH_STRIDE * BENCH_HEIGHT)
+#define BENCH_REPS 60
+
+static unsigned int buf_a[BENCH_WORDS] __attribute__((aligned(64)));
+static unsigned int buf_b[BENCH_WORDS] __attribute__((aligned(64)));
+static unsigned int buf_src[BENCH_WORDS] __attribute__((aligned(64)));
+
+static const int lengths[] = {
+    0, 1, 2, 3, 4, 5, 7, 8, 9, 12, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 480, 511
+};
+#define LENGTH_COUNT ((int)(sizeof(lengths) / sizeof(lengths[0])))
+
+static unsigned long long now_us(void)
+{
+#ifdef SF_HOST
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+#else
+    return (unsigned long long)sceKernelGetSystemTimeWide();
+#endif
+}
+
+static void reset_buffers(void)
+{
+    for (int i = 0; i < BENCH_WORDS; i++) {
+        buf_a[i] = 0xDEADBEEF ^ (i * 2654435761u);
+        buf_src[i] = i * 0x9E3779B9u;
+    }
+    memcpy(buf_b, buf_a, sizeof(buf_a));
+}
+
+/* Compare a window with guard words either side of the written range */
+static int same(int offset, int n)
+{
+    int start = offset > 8 ? offset - 8 : 0;
+    int end = offset + n + 8;
+    return memcmp(buf_a + start, buf_b + start, (end - start) * sizeof(unsigned int)) == 0;
+}
+
+static int check_fill32(void)
+{
+    int bad = 0;
+    for (int offset = 16; offset < 24; offset++) {
+        for (int i = 0; i < LENGTH_COUNT; i++) {
+            reset_buffers();
+            kernel_fill32(buf_a + offset, lengths[i], 0x12345678);
+            kernel_fill32_scalar(buf_b + offset, lengths[i], 0x12345678);
+            bad += !same(offset, lengths[i]);
+        }
+    }
+    return bad;
+}
+
+static int check_copy32(void)
+{
+    int bad = 0;
+    for (int offset = 16; offset < 24; offset++) {
+        for (int src_offset = 0; src_offset < 8; src_offset++) {
+            for (int i = 0; i < LENGTH_COUNT; i++) {
+                reset_buffers();
+                kernel_copy32(buf_a + offset, buf_src + src_offset, lengths[i]);
+                kernel_copy32_scalar(buf_b + offset, buf_src + src_offset, lengths[i]);
+                bad += !same(offset, lengths[i]);
+            }
+        }
+    }
+    return bad;
+}
+
+/* 16-bit spans split into halfword head, word body and halfword tail */
+static int check_span16(void)
+{
+    int bad = 0;
+    for (int offset = 0; offset < 4; offset++) {
+        for (int i = 0; i < LENGTH_COUNT; i++) {
+            reset_buffers();
+            unsigned short* a = (unsigned short*)(buf_a + 16) + offset;
+            unsigned short* b = (unsigned short*)(buf_b + 16) + offset;
+            render_fill_span16(a, lengths[i], 0xA5C3);
+            for (int p = 0; p < lengths[i]; p++)
+                b[p] = 0xA5C3;
+            bad += !same(16, lengths[i] / 2 + 2);
+        }
+    }
+    return bad;
+}
+
+static int check_clear(void)
+{
+    int bad = 0;
+    int formats[2] = { RENDER_FORMAT_8888, RENDER_FORMAT_565 };
+
+    for (int f = 0; f < 2; f++) {
+        RenderTarget rt;
+        int words = BENCH_STRIDE * BENCH_HEIGHT * render_bytes_per_pixel(formats[f]) / 4;
+        unsigned int value = (formats[f] == RENDER_FORMAT_8888) ? 0xFF102030 : 0x7BEF7BEF;
+
+        reset_buffers();
+        render_target_init(&rt, buf_a, BENCH_STRIDE, formats[f], 480, BENCH_HEIGHT);
+        kernel_clear(&rt, (formats[f] == RENDER_FORMAT_8888) ? value : (value & 0xFFFF));
+        kernel_fill32_scalar(buf_b, words, value);
+        bad += memcmp(buf_a, buf_b, sizeof(buf_a)) != 0;
+    }
+    return bad;
+}
+
+static void report_rate(KernelReportFn report, const char* name,
+                        unsigned long long bytes, unsigned long long us_kernel,
+                        unsigned long long us_scalar)
+{
+    char line[128];
+    if (us_kernel == 0)
+        us_kernel = 1;
+    if (us_scalar == 0)
+        us_scalar = 1;
+    snprintf(line, sizeof(line), "%-6s %s: %6llu MB/s  scalar: %6llu MB/s",
+             name, KERNELS_VFPU ? "vfpu" : "host",
+             bytes / us_kernel, bytes / us_scalar);
+    report(line);
+}
+
+static void time_clear(KernelReportFn report)
+{
+    unsigned long long t0, t_kernel, t_scalar;
+    unsigned long long bytes = (unsigned long long)BENCH_WORDS * 4 * BENCH_REPS;
+
+    t0 = now_us();
+    for (int r = 0; r < BENCH_REPS; r++)
+        kernel_fill32(buf_a, BENCH_WORDS, r);
+    t_kernel = now_us() - t0;
+
+    t0 = now_us();
+    for (int r = 0; r < BENCH_REPS; r++)
+        kernel_fill32_scalar(buf_b, BENCH_WORDS, r);
+    t_scalar = now_us() - t0;
+
+    report_rate(report, "clear", bytes, t_kernel, t_scalar);
+}
+
+/* Field-tile sized fills: 16-pixel rows at a 512-pixel stride */
+static void time_fill(KernelReportFn report)
+{
+    unsigned long long t0, t_kernel, t_scalar;
+    unsigned long long bytes = 16ULL * 4 * BENCH_HEIGHT * 30 * BENCH_REPS;
+
+    t0 = now_us();
+    for (int r = 0; r < BENCH_REPS; r++)
+        for (int row = 0; row < BENCH_HEIGHT; row++)
+            for (int tile = 0; tile < 30; tile++)
+                kernel_fill32(buf_a + row * BENCH_STRIDE + tile * 16, 16, r);
+    t_kernel = now_us() - t0;
+
+    t0 = now_us();
+    for (int r = 0; r < BENCH_REPS; r++)
+        for (int row = 0; row < BENCH_HEIGHT; row++)
+            for (int tile = 0; tile < 30; tile++)
+                kernel_fill32_scalar(buf_b + row * BENCH_STRIDE + tile * 16, 16, r);
+    t_scalar = now_us() - t0;
+
+    report_rate(report, "fill", bytes, t_kernel, t_scalar);
+}
+
+/* Tile blits: 16 rows of 16 pixels from a packed atlas-like source */
+static void time_blit(KernelReportFn report)
+{
+    unsigned long long t0, t_kernel, t_scalar;
+    unsigned long long bytes = 16ULL * 4 * BENCH_HEIGHT * 30 * BENCH_REPS;
+
+    t0 = now_us();
+    for (int r = 0; r < BENCH_REPS; r++)
+        for (int row = 0; row < BENCH_HEIGHT; row++)
+            for (int tile = 0; tile < 30; tile++)
+                kernel_copy32(buf_a + row * BENCH_STRIDE + tile * 16, buf_src + (row & 15) * 16, 16);
+    t_kernel = now_us() - t0;
+
+    t0 = now_us();
+    for (int r = 0; r < BENCH_REPS; r++)
+        for (int row = 0; row < BENCH_HEIGHT; row++)
+            for (int tile = 0; tile < 30; tile++)
+                kernel_copy32_scalar(buf_b + row * BENCH_STRIDE + tile * 16, buf_src + (row & 15) * 16, 16);
+    t_scalar = now_us() - t0;
+
+    report_rate(report, "blit", bytes, t_kernel, t_scalar);
+}
+
+int kernel_bench_run(KernelReportFn report)
+{
+    char line[128];
+    int fill = check_fill32();
+    int copy = check_copy32();
+    int span = check_span16();
+    int clear = check_clear();
+
+    snprintf(line, sizeof(line), "kernels (%s): mismatches fill32 %d  copy32 %d  span16 %d  clear %d",
+             KERNELS_VFPU ? "vfpu" : "scalar", fill, copy, span, clear);
+    report(line);
+
+    /* Warm caches and clocks so the first timing is not penalised */
+    kernel_fill32_scalar(buf_a, BENCH_WORDS, 0);
+    kernel_fill32_scalar(buf_b, BENCH_WORDS, 0);
+
+    time_clear(report);
+    time_fill(report);
+    time_blit(report);
+
+    return fill + copy + span + clear;
+}
@@ -0,0 +1,16 @@
+/*
+ * Split-Field Kernel Bench
+ * Equivalence checks and throughput for the pixel kernels, shared by the
+ * host benchmark and the KERNEL_BENCH device build
+ */
+
+#ifndef KERNEL_BENCH_H
+#define KERNEL_BENCH_H
+
+/* Receives one line of results at a time, without a trailing newline */
+typedef void (*KernelReportFn)(const char* line);
+
+/* Returns the number of kernel results that differ from the scalar reference */
+int kernel_bench_run(KernelReportFn report);
+
+#endif /* KERNEL_BENCH_H */
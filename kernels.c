@@ -0,0 +1,176 @@
+/*
+ * Split-Field Pixel Kernels
+ * On the PSP the aligned middle of every span goes through the VFPU:
+ * one sv.q (or lv.q/sv.q pair) moves 16 bytes per instruction. The ragged
+ * head and tail, and every host build, use the scalar code, which stores
+ * whole 64-bit words where alignment allows. Both write identical bytes.
+ */
+
+#include "kernels.h"
+
+void kernel_fill32_scalar(unsigned int* dst, int n, unsigned int value)
+{
+    if (n <= 0)
+        return;
+
+    /* Align to 8 bytes, then store word pairs as 64-bit words */
+    if ((unsigned long)dst & 4) {
+        *dst++ = value;
+        n--;
+    }
+
+    unsigned long long pair = ((unsigned long long)value << 32) | value;
+    unsigned long long* dst64 = (unsigned long long*)dst;
+
+    while (n >= 8) {
+        dst64[0] = pair;
+        dst64[1] = pair;
+        dst64[2] = pair;
+        dst64[3] = pair;
+        dst64 += 4;
+        n -= 8;
+    }
+    while (n >= 2) {
+        *dst64++ = pair;
+        n -= 2;
+    }
+
+    if (n)
+        *(unsigned int*)dst64 = value;
+}
+
+void kernel_copy32_scalar(unsigned int* dst, const unsigned int* src, int n)
+{
+    if (n <= 0)
+        return;
+
+    /* 64-bit moves when both sides can reach 8-byte alignment together */
+    if ((((unsigned long)dst ^ (unsigned long)src) & 4) == 0) {
+        if ((unsigned long)dst & 4) {
+            *dst++ = *src++;
+            n--;
+        }
+
+        unsigned long long* dst64 = (unsigned long long*)dst;
+        const unsigned long long* src64 = (const unsigned long long*)src;
+
+        while (n >= 8) {
+            dst64[0] = src64[0];
+            dst64[1] = src64[1];
+            dst64[2] = src64[2];
+            dst64[3] = src64[3];
+            dst64 += 4;
+            src64 += 4;
+            n -= 8;
+        }
+        while (n >= 2) {
+            *dst64++ = *src64++;
+            n -= 2;
+        }
+
+        dst = (unsigned int*)dst64;
+        src = (const unsigned int*)src64;
+    }
+
+    while (n-- > 0)
+        *dst++ = *src++;
+}
+
+#if KERNELS_VFPU
+/* quads 16-byte stores of value from dst (16-byte aligned, quads > 0) */
+static void vfpu_fill_quads(unsigned int* dst, int quads, unsigned int value)
+{
+    __asm__ volatile(
+        ".set push\n"
+        ".set noreorder\n"
+        "mtv     %2, S000\n"
+        "mtv     %2, S001\n"
+        "mtv     %2, S002\n"
+        "mtv     %2, S003\n"
+        "1:\n"
+        "addiu   %1, %1, -1\n"
+        "sv.q    C000, 0(%0)\n"
+        "bnez    %1, 1b\n"
+        "addiu   %0, %0, 16\n"
+        ".set pop\n"
+        : "+r"(dst), "+r"(quads)
+        : "r"(value)
+        : "memory");
+}
+
+/* quads 16-byte moves from src to dst (both 16-byte aligned, quads > 0) */
+static void vfpu_copy_quads(unsigned int* dst, const unsigned int* src, int quads)
+{
+    __asm__ volatile(
+        ".set push\n"
+        ".set noreorder\n"
+        "1:\n"
+        "lv.q    C000, 0(%1)\n"
+        "addiu   %2, %2, -1\n"
+        "addiu   %1, %1, 16\n"
+        "sv.q    C000, 0(%0)\n"
+        "bnez    %2, 1b\n"
+        "addiu   %0, %0, 16\n"
+        ".set pop\n"
+        : "+r"(dst), "+r"(src), "+r"(quads)
+        :
+        : "memory");
+}
+#endif
+
+void kernel_fill32(unsigned int* dst, int n, unsigned int value)
+{
+#if KERNELS_VFPU
+    /* Scalar up to the first 16-byte boundary */
+    while (n > 0 && ((unsigned long)dst & 15)) {
+        *dst++ = value;
+        n--;
+    }
+
+    int quads = n >> 2;
+    if (quads > 0) {
+        vfpu_fill_quads(dst, quads, value);
+        dst += quads * 4;
+        n &= 3;
+    }
+#endif
+
+    kernel_fill32_scalar(dst, n, value);
+}
+
+void kernel_copy32(unsigned int* dst, const unsigned int* src, int n)
+{
+#if KERNELS_VFPU
+    /* lv.q/sv.q need both sides on the same 16-byte phase */
+    if ((((unsigned long)dst ^ (unsigned long)src) & 15) == 0) {
+        while (n > 0 && ((unsigned long)dst & 15)) {
+            *dst++ = *src++;
+            n--;
+        }
+
+        int quads = n >> 2;
+        if (quads > 0) {
+            vfpu_copy_quads(dst, src, quads);
+            dst += quads * 4;
+            src += quads * 4;
+            n &= 3;
+        }
+    }
+#endif
+
+    kernel_copy32_scalar(dst, src, n);
+}
+
+void kernel_clear(const RenderTarget* rt, unsigned int pixel)
+{
+    unsigned int value = pixel;
+
+    if (rt->format != RENDER_FORMAT_8888)
+        value = (pixel & 0xFFFF) | (pixel << 16);
+
+    int words = rt->stride * rt->height * render_bytes_per_pixel(rt->format) / 4;
+    kernel_fill32((unsigned int*)rt->base, words, value);
+
+    if (rt->stats)
+        rt->stats->pixels_written += rt->stride * rt->height;
+}
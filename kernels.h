@@ -0,0 +1,31 @@
+/*
+ * Split-Field Pixel Kernels
+ * Clear, fill and copy over 32-bit words: VFPU quad-word stores on the
+ * PSP, portable scalar code elsewhere (and with -DNO_VFPU)
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "render.h"
+
+#if defined(SF_HOST) || defined(NO_VFPU)
+#define KERNELS_VFPU 0
+#else
+#define KERNELS_VFPU 1
+#endif
+
+/* Fill n 32-bit words with value */
+void kernel_fill32(unsigned int* dst, int n, unsigned int value);
+
+/* Copy n 32-bit words; dst and src must not overlap */
+void kernel_copy32(unsigned int* dst, const unsigned int* src, int n);
+
+/* Fill the whole buffer, stride included, with a native pixel */
+void kernel_clear(const RenderTarget* rt, unsigned int pixel);
+
+/* Portable versions, the bit-exact reference for the ones above */
+void kernel_fill32_scalar(unsigned int* dst, int n, unsigned int value);
+void kernel_copy32_scalar(unsigned int* dst, const unsigned int* src, int n);
+
+#endif /* KERNELS_H */
@@ -0,0 +1,371 @@
+/*
+ * Split-Field Levels
+ * Text levels: parsing, writing and loading from files
+ */
+
+#include "level.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char default_owners[MAX_MIRROR_BOXES] = { 1, 1, 2, 2 };
+
+/* Boxes A-D, players P and Q, enemies chasing player 1 (X) or 2 (Y) */
+static const char actor_chars[] = "ABCDPQXY";
+
+/* Length of the line at text, without its end; next receives the start of
+ * the line after it */
+static int line_length(const char* text, int size, int* next)
+{
+    int n = 0;
+
+    while (n < size && text[n] != '\n')
+        n++;
+    *next = n < size ? n + 1 : n;
+    if (n > 0 && text[n - 1] == '\r')
+        n--;
+    return n;
+}
+
+static int is_header(const char* line, int length)
+{
+    return length >= 5 && strncmp(line, "level", 5) == 0 && (length == 5 || line[5] == ' ');
+}
+
+/* Number and owners from a header line; returns -1 if malformed */
+static int parse_header(const char* line, int length, int* number, unsigned char* owners)
+{
+    char buf[64];
+    char word[16], digits[16];
+
+    if (length >= (int)sizeof(buf))
+        return -1;
+    memcpy(buf, line, length);
+    buf[length] = '\0';
+    memcpy(owners, default_owners, MAX_MIRROR_BOXES);
+
+    int fields = sscanf(buf, "level %d %15s %15s", number, word, digits);
+    if (fields < 1 || *number < 1)
+        return -1;
+    if (fields == 1)
+        return 0;
+    if (fields != 3 || strcmp(word, "owners") != 0 || strlen(digits) != MAX_MIRROR_BOXES)
+        return -1;
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        if (digits[b] != '1' && digits[b] != '2')
+            return -1;
+        owners[b] = digits[b] - '0';
+    }
+    return 0;
+}
+
+/* Put the entity an upper-case letter names on (x, y); returns -1 if it
+ * names none or one already placed */
+static int place_actor(GameContext* ctx, int x, int y, char c, int* seen, int* enemies)
+{
+    const char* actor = c ? strchr(actor_chars, c) : NULL;
+    if (!actor)
+        return -1;
+
+    int kind = (int)(actor - actor_chars);
+    int slot;
+    if (kind < MAX_MIRROR_BOXES) {
+        slot = ENTITY_BOX0 + kind;
+    } else if (kind < MAX_MIRROR_BOXES + 2) {
+        slot = ENTITY_PLAYER(kind - MAX_MIRROR_BOXES + 1);
+    } else {
+        if (*enemies == MAX_ENEMIES)
+            return -1;
+        int i = (*enemies)++;
+        slot = ENTITY_ENEMY0 + i;
+        ctx->enemy_target[i] = kind - MAX_MIRROR_BOXES - 1;
+        ctx->sim.enemy_active |= 1 << i;
+    }
+    if (seen[slot]++)
+        return -1;
+    ctx->sim.x[slot] = x;
+    ctx->sim.y[slot] = y;
+    return 0;
+}
+
+/* Put a cell's character on the field; returns -1 if it is not one */
+static int parse_cell(GameContext* ctx, int x, int y, char c, int* seen, int* enemies)
+{
+    static const char tiles[] = " #$%!.|";
+    static const unsigned char tile_types[] = {
+        TILE_EMPTY, TILE_WALL, TILE_BOX, TILE_GHOST_BOX, TILE_ENEMY, TILE_GOAL, TILE_BARRIER
+    };
+
+    if (c == '-')
+        c = ' ';
+    const char* tile = c ? strchr(tiles, c) : NULL;
+    if (tile) {
+        FIELD_TILE(ctx, x, y) = tile_types[tile - tiles];
+        return 0;
+    }
+
+    int on_goal = c >= 'a' && c <= 'z';
+    if (place_actor(ctx, x, y, on_goal ? c - 'a' + 'A' : c, seen, enemies) < 0)
+        return -1;
+    FIELD_TILE(ctx, x, y) = on_goal ? TILE_GOAL : TILE_EMPTY;
+    return 0;
+}
+
+/* A placement line, "@<letter> <x> <y>": the entity on that cell, over
+ * its tile */
+static int parse_placement(GameContext* ctx, const char* line, int length, int* seen, int* enemies)
+{
+    char buf[64];
+    char letter;
+    int x, y;
+
+    if (length >= (int)sizeof(buf))
+        return -1;
+    memcpy(buf, line, length);
+    buf[length] = '\0';
+    if (sscanf(buf, "@%c %d %d", &letter, &x, &y) != 3 ||
+        x < 0 || x >= ctx->field_width || y < 0 || y >= ctx->field_height)
+        return -1;
+    return place_actor(ctx, x, y, letter, seen, enemies);
+}
+
+int level_parse(GameContext* ctx, const char* text, int size, int* used)
+{
+    int pos = 0, next;
+    int length = 0;
+
+    /* Skip to the header */
+    memset(ctx, 0, sizeof(GameContext));
+    for (;;) {
+        if (pos >= size) {
+            if (used)
+                *used = pos;
+            return 1;
+        }
+        length = line_length(text + pos, size - pos, &next);
+        if (is_header(text + pos, length))
+            break;
+        pos += next;
+    }
+
+    int number;
+    unsigned char owners[MAX_MIRROR_BOXES];
+    pos += next;
+    if (parse_header(text + pos - next, length, &number, owners) < 0) {
+        if (used)
+            *used = pos;
+        return -1;
+    }
+
+    /* Rows: measure, then fill, then the placement lines among them */
+    int start = pos, rows = pos, width = 0, height = 0;
+    while (pos < size) {
+        length = line_length(text + pos, size - pos, &next);
+        if (length == 0 || is_header(text + pos, length))
+            break;
+        if (text[pos] != ';' && text[pos] != '@') {
+            if (length > width)
+                width = length;
+            height++;
+        }
+        pos += next;
+    }
+    if (used)
+        *used = pos;
+
+    if (sim_alloc_field(ctx, width, height) < 0)
+        return -1;
+
+    int seen[ENTITY_COUNT] = { 0 };
+    int enemies = 0;
+    for (int y = 0; y < height; rows += next) {
+        length = line_length(text + rows, size - rows, &next);
+        if (text[rows] == ';' || text[rows] == '@')
+            continue;
+        for (int x = 0; x < width; x++) {
+            if (parse_cell(ctx, x, y, x < length ? text[rows + x] : ' ', seen, &enemies) < 0) {
+                sim_cleanup(ctx);
+                return -1;
+            }
+        }
+        y++;
+    }
+    for (rows = start; rows < pos; rows += next) {
+        length = line_length(text + rows, size - rows, &next);
+        if (text[rows] == '@' && parse_placement(ctx, text + rows, length, seen, &enemies) < 0) {
+            sim_cleanup(ctx);
+            return -1;
+        }
+    }
+
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        int enemy = slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1;
+        if (!enemy && !seen[slot]) {
+            sim_cleanup(ctx);
+            return -1;
+        }
+    }
+
+    memcpy(ctx->box_owner, owners, MAX_MIRROR_BOXES);
+    ctx->total_boxes = MAX_MIRROR_BOXES;
+    ctx->level = number;
+    sim_rebuild_occupancy(ctx);
+    sim_start_flow(ctx);
+    return 0;
+}
+
+int level_format_size(const GameContext* ctx)
+{
+    return 64 + (ctx->field_width + 1) * ctx->field_height + ENTITY_COUNT * 16;
+}
+
+static int entity_present(const GameContext* ctx, int slot)
+{
+    if (slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1)
+        return ENEMY_ACTIVE(ctx, slot - ENTITY_ENEMY0);
+    return 1;
+}
+
+static char actor_char(const GameContext* ctx, int slot)
+{
+    if (slot < ENTITY_ENEMY0)
+        return actor_chars[slot - ENTITY_BOX0];
+    if (slot >= ENTITY_PLAYER1)
+        return actor_chars[MAX_MIRROR_BOXES + slot - ENTITY_PLAYER1];
+    return actor_chars[MAX_MIRROR_BOXES + 1 + ctx->enemy_target[slot - ENTITY_ENEMY0]];
+}
+
+/* Which entities can be written in the rows and read back the same: on
+ * floor or a goal, alone on the cell, and for enemies, all of them so and
+ * in slots that follow reading order. The rest get placement lines. */
+static void find_inline(const GameContext* ctx, int* in_rows)
+{
+    int enemies_inline = 1, last_cell = -1;
+
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        int tile = FIELD_TILE(ctx, ctx->sim.x[slot], ctx->sim.y[slot]);
+        in_rows[slot] = entity_present(ctx, slot) && (tile == TILE_EMPTY || tile == TILE_GOAL);
+        for (int other = 0; other < slot && in_rows[slot]; other++) {
+            if (in_rows[other] && ctx->sim.x[other] == ctx->sim.x[slot] && ctx->sim.y[other] == ctx->sim.y[slot])
+                in_rows[slot] = 0;
+        }
+    }
+
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        int slot = ENTITY_ENEMY0 + i;
+        if (!ENEMY_ACTIVE(ctx, i))
+            continue;
+        int cell = ctx->sim.y[slot] * ctx->field_width + ctx->sim.x[slot];
+        if (!in_rows[slot] || cell <= last_cell)
+            enemies_inline = 0;
+        last_cell = cell;
+    }
+    for (int i = 0; i < MAX_ENEMIES && !enemies_inline; i++)
+        in_rows[ENTITY_ENEMY0 + i] = 0;
+}
+
+/* Character for (x, y): the entity written there, over the tile below it */
+static char cell_char(const GameContext* ctx, const int* in_rows, int x, int y)
+{
+    static const char tile_chars[] = " #$%!.|";
+    int tile = FIELD_TILE(ctx, x, y);
+
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        if (in_rows[slot] && ctx->sim.x[slot] == x && ctx->sim.y[slot] == y) {
+            char c = actor_char(ctx, slot);
+            return tile == TILE_GOAL ? c - 'A' + 'a' : c;
+        }
+    }
+    return tile < (int)sizeof(tile_chars) - 1 ? tile_chars[tile] : ' ';
+}
+
+int level_format(const GameContext* ctx, char* out, int size)
+{
+    int in_rows[ENTITY_COUNT];
+
+    if (size < level_format_size(ctx))
+        return -1;
+    find_inline(ctx, in_rows);
+
+    int n = sprintf(out, "level %d owners %d%d%d%d\n", ctx->level, ctx->box_owner[0],
+                    ctx->box_owner[1], ctx->box_owner[2], ctx->box_owner[3]);
+    for (int y = 0; y < ctx->field_height; y++) {
+        for (int x = 0; x < ctx->field_width; x++)
+            out[n++] = cell_char(ctx, in_rows, x, y);
+        out[n++] = '\n';
+    }
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        if (entity_present(ctx, slot) && !in_rows[slot])
+            n += sprintf(out + n, "@%c %d %d\n", actor_char(ctx, slot), ctx->sim.x[slot], ctx->sim.y[slot]);
+    }
+    return n;
+}
+
+/* A whole file, NUL-terminated; NULL if it cannot be read */
+static char* read_file(const char* path, int* size)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    long length = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        length = ftell(f);
+    char* text = (length >= 0 && fseek(f, 0, SEEK_SET) == 0) ? (char*)malloc(length + 1) : NULL;
+    if (text && fread(text, 1, length, f) != (size_t)length) {
+        free(text);
+        text = NULL;
+    }
+    fclose(f);
+
+    if (text) {
+        text[length] = '\0';
+        *size = (int)length;
+    }
+    return text;
+}
+
+int level_load(GameContext* ctx, const char* path, int number)
+{
+    int size, used;
+    char* text = read_file(path, &size);
+    if (!text)
+        return -1;
+
+    int pos = 0, result = -1;
+    for (;;) {
+        int status = level_parse(ctx, text + pos, size - pos, &used);
+        if (status == 1)
+            break;
+        if (status == 0 && ctx->level == number) {
+            result = 0;
+            break;
+        }
+        /* Another level, or a malformed one: read on past it */
+        if (status == 0)
+            sim_cleanup(ctx);
+        pos += used;
+    }
+    free(text);
+    return result;
+}
+
+int level_file_last(const char* path)
+{
+    int size;
+    char* text = read_file(path, &size);
+    if (!text)
+        return 0;
+
+    int last = 0;
+    for (int pos = 0, next; pos < size; pos += next) {
+        int length = line_length(text + pos, size - pos, &next);
+        int number;
+        unsigned char owners[MAX_MIRROR_BOXES];
+        if (is_header(text + pos, length) && parse_header(text + pos, length, &number, owners) == 0 &&
+            number > last)
+            last = number;
+    }
+    free(text);
+    return last;
+}
@@ -0,0 +1,56 @@
+/*
+ * Split-Field Levels
+ * Levels as plain text, one character per cell, so they can be written by
+ * hand, made by tools/level_gen and loaded by the game in place of the
+ * stock level. Platform-free; files go through stdio.
+ *
+ * A file holds any number of levels. Lines starting with ';' are comments.
+ * Each level is a header line, then its rows:
+ *
+ *   level <number> [owners <4 digits>]
+ *
+ * owners gives the player (1 or 2) that may push box A, B, C and D; it
+ * defaults to 1122. Rows run until a blank line or the next header, and
+ * a row shorter than the longest is padded with floor. In the rows:
+ *
+ *   '#' wall      ' ' or '-' floor   '|' barrier   '.' goal
+ *   '!' static enemy tile   '$' static box tile   '%' ghost box tile
+ *   'P' player 1  'Q' player 2
+ *   'A' 'B' boxes 0 and 1 (player 1's mirror pair), 'C' 'D' boxes 2 and 3
+ *   'X' enemy chasing player 1, 'Y' enemy chasing player 2 (at most four)
+ *
+ * Players, boxes and enemies written in lower case stand on a goal. Every
+ * level has both players and all four boxes. Enemies take slots in the
+ * order they are read.
+ *
+ * Among the rows, a line "@<letter> <x> <y>" puts a player, box or enemy
+ * on that cell over whatever tile the rows give it, wall included; they
+ * are read after the rows. level_format writes the enemies this way when
+ * they would not otherwise come back in the same slots or on the same
+ * tiles.
+ */
+
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "sim.h"
+
+/* Read the first level in text (size bytes) into ctx, which is set up
+ * afresh; used, if not NULL, receives the bytes read up to the end of
+ * it. Returns 0, 1 if text holds no level, or -1 if the level is
+ * malformed, leaving ctx cleaned up. */
+int level_parse(GameContext* ctx, const char* text, int size, int* used);
+
+/* Bytes level_format needs for ctx's level, and the level as text with
+ * its header; returns the bytes written, -1 if out is too small */
+int level_format_size(const GameContext* ctx);
+int level_format(const GameContext* ctx, char* out, int size);
+
+/* Load the level with this number from a file; returns -1 if the file
+ * cannot be read or has no such level */
+int level_load(GameContext* ctx, const char* path, int number);
+
+/* Highest level number in a file, 0 if it cannot be read or has none */
+int level_file_last(const char* path);
+
+#endif /* LEVEL_H */
@@ -0,0 +1,45 @@
+/*
+ * Split-Field Compiled Levels
+ * Starting a level from the tables level_compile writes
+ */
+
+#include "level_table.h"
+#include <string.h>
+
+const LevelTable* level_table_find(int number)
+{
+    for (int i = 0; i < level_table_count; i++) {
+        if (level_tables[i].number == number)
+            return &level_tables[i];
+    }
+    return NULL;
+}
+
+int level_table_start(GameContext* ctx, int number)
+{
+    const LevelTable* table = level_table_find(number);
+    if (!table) {
+        memset(ctx, 0, sizeof(GameContext));
+        return -1;
+    }
+    if (sim_alloc_field(ctx, table->width, table->height) < 0)
+        return -1;
+
+    /* The grid follows the tiles in both */
+    int cells = table->width * table->height;
+    memcpy(ctx->field, table->cells, cells + cells * sizeof(Occupant));
+    ctx->sim = table->start;
+    memcpy(ctx->box_owner, table->box_owner, MAX_MIRROR_BOXES);
+    memcpy(ctx->enemy_target, table->enemy_target, MAX_ENEMIES);
+    ctx->total_boxes = table->box_count;
+    ctx->level = number;
+    ctx->box_dist = table->box_dist;
+    sim_start_flow(ctx);
+    return 0;
+}
+
+void sim_init(GameContext* ctx)
+{
+    if (level_table_start(ctx, 1) < 0)
+        ctx->sim.state = GAME_QUIT;
+}
@@ -0,0 +1,52 @@
+/*
+ * Split-Field Compiled Levels
+ * Levels built into the program: tools/level_compile turns the text
+ * levels in levels/builtin.txt (level.h format) into const tables at
+ * build time, with each one's box distances already searched. Starting
+ * one takes a single allocation (sim_alloc_field), copies its tiles and
+ * occupancy grid from rodata in one go, as they lie together there and
+ * in the context, sets the state block and points the context at its
+ * box distances. Then it builds the enemies' first flow fields.
+ */
+
+#ifndef LEVEL_TABLE_H
+#define LEVEL_TABLE_H
+
+#include "sim.h"
+
+/* Box steps in box_dist where no goal can be reached: a box there is lost */
+#define LEVEL_FAR 0xFFFF
+
+typedef struct {
+    int number;
+    int width;
+    int height;
+
+    /* The level as it starts */
+    const unsigned char* cells;        /* TileType per cell, row-major, then
+                                        * the Occupant of each in the same order */
+    SimState start;                    /* boxes_in_goal counted */
+    unsigned char box_owner[MAX_MIRROR_BOXES];
+    unsigned char enemy_target[MAX_ENEMIES];
+    int box_count;                     /* Boxes that must be on goals to win */
+
+    const unsigned short* box_dist;    /* Box steps from each cell to the
+                                        * nearest goal, for the solver */
+} LevelTable;
+
+/* Written by level_compile */
+extern const LevelTable level_tables[];
+extern const int level_table_count;
+
+/* The compiled level with this number, or NULL */
+const LevelTable* level_table_find(int number);
+
+/* Set up ctx afresh on a compiled level; returns -1 if there is none with
+ * that number or memory runs out */
+int level_table_start(GameContext* ctx, int number);
+
+/* The stock level, level 1 of the tables; on failure the state is
+ * GAME_QUIT */
+void sim_init(GameContext* ctx);
+
+#endif /* LEVEL_TABLE_H */
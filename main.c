@@ -4,6 +4,7 @@
  */
 
 #include <pspkernel.h>
+#include <pspthreadman.h>
 #include <pspdebug.h>
 #include <pspdisplay.h>
 #include <pspctrl.h>
@@ -11,14 +12,28 @@
 #include <stdlib.h>
 #include <psppower.h>
 #include <pspiofilemgr.h>
+#include <stdio.h>
 #include "game.h"
+#include "display.h"
+#include "hud.h"
+#include "preload.h"
+#ifdef KERNEL_BENCH
+#include "kernel_bench.h"
+#endif
 
 PSP_MODULE_INFO("Split-Field", 0, 1, 0);
 PSP_MAIN_THREAD_ATTR(THREAD_ATTR_USER | THREAD_ATTR_VFPU);
 
+#ifndef DEFAULT_RENDER_BACKEND
+#define DEFAULT_RENDER_BACKEND RENDER_BACKEND_SOFTWARE
+#endif
+
 /* Define printf to use pspDebugScreenPrintf */
 #define printf pspDebugScreenPrintf
 
+/* The debug screen's 8x8 font, reused for the cached HUD text */
+extern unsigned char msx[];
+
 /* Exit callback */
 int exit_callback(int arg1, int arg2, void *common)
 {
@@ -53,24 +68,239 @@ int SetupCallbacks(void)
     return thid;
 }
 
-/* Draw fancy ASCII title */
-static void draw_title(void)
+/* Menu screen: fancy ASCII title, options and game description, on the
+ * debug-screen rows the old printf layout put them */
+typedef struct {
+    int row;
+    const char* text;
+} MenuLine;
+
+static const MenuLine menu_lines[] = {
+    {  4, "  ========================================================" },
+    {  5, "  #     ###  ####  #     ### #####                      #" },
+    {  6, "  #    #    #   #  #      #    #                        #" },
+    {  7, "  #     ##  ####   #      #    #                        #" },
+    {  8, "  #       # #      #      #    #                        #" },
+    {  9, "  #    ###  #      ##### ###   #                        #" },
+    { 10, "  #    #### ###  #### #     ####                        #" },
+    { 11, "  #    #     #   #    #     #   #                       #" },
+    { 12, "  #    ###   #   ###  #     #   #                       #" },
+    { 13, "  #    #     #   #    #     #   #                       #" },
+    { 14, "  #    #    ### #### ##### ####                         #" },
+    { 15, "  ========================================================" },
+    { 18, "                    Press START to begin" },
+    { 19, "               Press TRIANGLE to replay last game" },
+    { 20, "                    Press SELECT to exit" },
+    { 23, "        # 2 players share one PSP                  #" },
+    { 24, "        # Player 1: D-PAD controls                 #" },
+    { 25, "        # Player 2: ABXO buttons (as directions)   #" },
+    { 26, "        # Work together to push boxes to goals     #" },
+    { 27, "        # Avoid enemies (red tiles)                #" },
+    { 28, "        # Some boxes only one player can move!     #" },
+};
+#define MENU_LINE_COUNT ((int)(sizeof(menu_lines) / sizeof(menu_lines[0])))
+
+static HudText menu_text[MENU_LINE_COUNT];
+
+/* Outcome of the last replay, shown under the options */
+#define MENU_STATUS_ROW 21
+static char menu_status[64];
+static HudText menu_status_text;
+
+/* Level START plays, picked with LEFT/RIGHT when the level files hold
+ * more than the one */
+#define MENU_LEVEL_ROW 17
+static int menu_level = 1;
+static int level_count = 1;
+static HudText menu_level_text;
+
+/* Erase only what the game left behind, then blit the cached menu lines */
+static void draw_menu(void)
+{
+    RenderTarget rt;
+    if (display_begin_frame(&rt) < 0)
+        return;
+    
+    hud_erase(&rt);
+    render_fill_rect(&rt, VIEW_X, VIEW_Y, VIEW_WIDTH, VIEW_HEIGHT,
+                     render_convert_color(0x00000000, rt.format));
+    
+    for (int i = 0; i < MENU_LINE_COUNT; i++) {
+        hud_text_set(&menu_text[i], menu_lines[i].text, rt.format);
+        hud_text_draw(&menu_text[i], &rt, 0, menu_lines[i].row);
+    }
+    if (level_count > 1) {
+        char line[64];
+        snprintf(line, sizeof(line), "              LEFT/RIGHT: < Level %d of %d >", menu_level, level_count);
+        hud_text_set(&menu_level_text, line, rt.format);
+        hud_text_draw(&menu_level_text, &rt, 0, MENU_LEVEL_ROW);
+    }
+    if (menu_status[0]) {
+        hud_text_set(&menu_status_text, menu_status, rt.format);
+        hud_text_draw(&menu_status_text, &rt, 0, MENU_STATUS_ROW);
+    }
+    
+    display_flip(0);
+}
+
+/* Pick display settings from buttons held at boot:
+ * L = 16-bit 565 framebuffers, R = triple buffering */
+static void choose_display_config(DisplayConfig* config, const SceCtrlData* boot_pad)
+{
+    config->buffer_count = 2;
+    config->pixel_format = RENDER_FORMAT_8888;
+    
+    if (boot_pad->Buttons & PSP_CTRL_LTRIGGER)
+        config->pixel_format = RENDER_FORMAT_565;
+    if (boot_pad->Buttons & PSP_CTRL_RTRIGGER)
+        config->buffer_count = 3;
+}
+
+/* Play back the last recorded game and note on the menu whether it
+ * followed the recording */
+static void replay_last_game(void)
+{
+    Replay replay;
+    if (replay_load(&replay, GAME_REPLAY_PATH) < 0) {
+        snprintf(menu_status, sizeof(menu_status), "                    No replay to play");
+        return;
+    }
+    
+    GameContext game_ctx;
+    ReplayPlayer player;
+    if (game_load_level(&game_ctx, replay.level) < 0) {
+        snprintf(menu_status, sizeof(menu_status), "               Level %d of the replay is gone", replay.level);
+        replay_free(&replay);
+        return;
+    }
+    game_replay(&game_ctx, &replay, &player);
+    game_cleanup(&game_ctx);
+    
+    if (replay_player_matched(&player))
+        snprintf(menu_status, sizeof(menu_status), "              Replay matched: %u updates", player.tick);
+    else if (player.diverged >= 0)
+        snprintf(menu_status, sizeof(menu_status), "          Replay DIVERGED by update %d", player.diverged);
+    else
+        snprintf(menu_status, sizeof(menu_status), "         Replay stopped at update %u of %u", player.tick, replay.ticks);
+    replay_free(&replay);
+}
+
+/* Latency from press to move in tenths of a frame, worst in frames, and
+ * presses dropped, for each player of the last game */
+static void input_status(void)
+{
+    const InputStats* p1 = game_input_stats(1);
+    const InputStats* p2 = game_input_stats(2);
+    unsigned int tenths1 = p1->moves ? p1->latency * 10 / p1->moves : 0;
+    unsigned int tenths2 = p2->moves ? p2->latency * 10 / p2->moves : 0;
+    
+    snprintf(menu_status, sizeof(menu_status), "  Input lag P1 %u.%u/%u P2 %u.%u/%u frames, %u dropped", tenths1 / 10,
+             tenths1 % 10, p1->max_latency, tenths2 / 10, tenths2 % 10, p2->max_latency, p1->dropped + p2->dropped);
+}
+
+/* Play from a level just loaded, going straight on to the next after
+ * each win, and note on the menu how long the last change of level took */
+static void play_levels(GameContext* game_ctx)
+{
+    unsigned int change_us = 0;
+    int changes = 0;
+    
+    for (;;) {
+        game_run(game_ctx);
+        int won = game_ctx->sim.state == GAME_WIN;
+        
+        if (!won || menu_level >= level_count) {
+            game_cleanup(game_ctx);
+            break;
+        }
+        
+        /* Let go of the button that ended the level before the next starts */
+        SceCtrlData pad;
+        do {
+            sceDisplayWaitVblankStart();
+            sceCtrlPeekBufferPositive(&pad, 1);
+        } while (pad.Buttons);
+        
+        /* The change of level: normally the preloaded spare taken over */
+        unsigned int start = sceKernelGetSystemTimeLow();
+        game_cleanup(game_ctx);
+        menu_level++;
+        if (game_load_level(game_ctx, menu_level) < 0) {
+            snprintf(menu_status, sizeof(menu_status), "                  Level %d cannot be loaded", menu_level);
+            return;
+        }
+        change_us = sceKernelGetSystemTimeLow() - start;
+        changes++;
+    }
+    
+    if (changes) {
+        const PreloadStats* stats = preload_stats();
+        snprintf(menu_status, sizeof(menu_status), "     Last level change %u us, %u of %u preloaded", change_us,
+                 stats->ready, stats->takes);
+    } else {
+        input_status();
+    }
+}
+
+#ifdef FRAME_DUMP
+/* Headless verification: play FRAME_DUMP frames with no input, then write
+ * the visible screen to host0:/frame_<backend>.raw for comparison */
+static void dump_frames(RenderBackend backend)
+{
+    GameContext game_ctx;
+    
+    game_init(&game_ctx);
+    for (int i = 0; i < FRAME_DUMP; i++) {
+        sim_step(&game_ctx, 0);
+        game_render(&game_ctx);
+        display_flip(1);
+    }
+    game_cleanup(&game_ctx);
+    
+    const char* path = (backend == RENDER_BACKEND_GU) ? "host0:/frame_gu.raw" : "host0:/frame_software.raw";
+    SceUID fd = sceIoOpen(path, PSP_O_WRONLY | PSP_O_CREAT | PSP_O_TRUNC, 0777);
+    if (fd < 0)
+        return;
+    
+    int bpp = (display_pixel_format() == RENDER_FORMAT_8888) ? 4 : 2;
+    unsigned char* row = display_buffer(display_front_index());
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        sceIoWrite(fd, row, SCREEN_WIDTH * bpp);
+        row += DISPLAY_STRIDE * bpp;
+    }
+    sceIoClose(fd);
+}
+#endif
+
+#ifdef KERNEL_BENCH
+static SceUID bench_fd = -1;
+
+/* Show each result line and append it to host0:/kernels.txt */
+static void bench_report(const char* line)
+{
+    printf("%s\n", line);
+    if (bench_fd >= 0) {
+        sceIoWrite(bench_fd, line, strlen(line));
+        sceIoWrite(bench_fd, "\n", 1);
+    }
+}
+
+/* Device half of the kernel checks, run headless or on hardware */
+static void run_kernel_bench(void)
 {
-    pspDebugScreenSetXY(0, 3);
-    printf("\n");
-    printf("  ========================================================\n");
-    printf("  #     ###  ####  #     ### #####                      #\n");
-    printf("  #    #    #   #  #      #    #                        #\n");
-    printf("  #     ##  ####   #      #    #                        #\n");
-    printf("  #       # #      #      #    #                        #\n");
-    printf("  #    ###  #      ##### ###   #                        #\n");
-    printf("  #    #### ###  #### #     ####                        #\n");
-    printf("  #    #     #   #    #     #   #                       #\n");
-    printf("  #    ###   #   ###  #     #   #                       #\n");
-    printf("  #    #     #   #    #     #   #                       #\n");
-    printf("  #    #    ### #### ##### ####                         #\n");
-    printf("  ========================================================\n");
+    bench_fd = sceIoOpen("host0:/kernels.txt", PSP_O_WRONLY | PSP_O_CREAT | PSP_O_TRUNC, 0777);
+    
+    RenderTarget rt;
+    display_begin_frame(&rt);
+    pspDebugScreenClear();
+    pspDebugScreenSetXY(0, 0);
+    kernel_bench_run(bench_report);
+    display_flip(1);
+    
+    if (bench_fd >= 0)
+        sceIoClose(bench_fd);
 }
+#endif
 
 int main(void)
 {
@@ -81,8 +311,41 @@ int main(void)
     /* Set up callbacks */
     SetupCallbacks();
 
-    /* Initialize the debug screen */
-    pspDebugScreenInit();
+    /* Buttons held at boot select display settings and renderer */
+    SceCtrlData boot_pad;
+    memset(&boot_pad, 0, sizeof(boot_pad));
+    sceCtrlPeekBufferPositive(&boot_pad, 1);
+    
+    /* Buttons still held from boot are not menu presses */
+    oldpad = boot_pad;
+    
+    /* Initialize the framebuffers and the debug screen on top of them */
+    DisplayConfig display_config;
+    choose_display_config(&display_config, &boot_pad);
+    display_init(&display_config);
+    hud_init(msx);
+    
+    /* Triangle at boot swaps to the other renderer */
+    RenderBackend backend = DEFAULT_RENDER_BACKEND;
+    if (boot_pad.Buttons & PSP_CTRL_TRIANGLE)
+        backend = (backend == RENDER_BACKEND_GU) ? RENDER_BACKEND_SOFTWARE : RENDER_BACKEND_GU;
+    game_set_render_backend(backend);
+    
+#ifdef FRAME_DUMP
+    dump_frames(backend);
+    sceKernelExitGame();
+    return 0;
+#endif
+
+#ifdef KERNEL_BENCH
+    run_kernel_bench();
+    sceKernelExitGame();
+    return 0;
+#endif
+    
+    /* Levels from the pack come in on the loader thread */
+    preload_init(GAME_PACK_PATH);
+    level_count = game_level_count();
     
     /* Draw menu once */
     int menu_needs_redraw = 1;
@@ -92,27 +355,7 @@ int main(void)
     {
         /* Only redraw menu when needed */
         if (menu_needs_redraw) {
-            /* Clear screen and set cursor to top-left */
-            pspDebugScreenClear();
-            pspDebugScreenSetXY(0, 0);
-
-        /* Display fancy title */
-        draw_title();
-
-        /* Display menu options */
-        printf("\n\n");
-        printf("                    Press START to begin\n");
-        printf("\n");
-        printf("                    Press SELECT to exit\n");
-        printf("\n\n");
-        
-        /* Game description */
-        printf("        # 2 players share one PSP                  #\n");
-        printf("        # Player 1: D-PAD controls                 #\n");
-        printf("        # Player 2: ABXO buttons (as directions)   #\n");
-        printf("        # Work together to push boxes to goals     #\n");
-        printf("        # Avoid enemies (red tiles)                #\n");
-        printf("        # Some boxes only one player can move!     #\n");
+            draw_menu();
             menu_needs_redraw = 0;
         }
 
@@ -124,11 +367,37 @@ int main(void)
         {
             /* Launch the game */
             GameContext game_ctx;
-            game_init(&game_ctx);
-            game_run(&game_ctx);
-            game_cleanup(&game_ctx);
+            if (game_load_level(&game_ctx, menu_level) < 0) {
+                snprintf(menu_status, sizeof(menu_status), "                  Level %d cannot be loaded", menu_level);
+            } else {
+                play_levels(&game_ctx);
+            }
             
-            /* Redraw menu after game ends */
+            /* Redraw menu after game ends; the press is used up even when
+             * the level would not load */
+            oldpad = pad;
+            menu_needs_redraw = 1;
+            continue;
+        }
+
+        /* LEFT/RIGHT pick the level */
+        unsigned int pressed = pad.Buttons & ~oldpad.Buttons;
+        if (level_count > 1 && (pressed & (PSP_CTRL_LEFT | PSP_CTRL_RIGHT)))
+        {
+            if (pressed & PSP_CTRL_LEFT)
+                menu_level = menu_level > 1 ? menu_level - 1 : level_count;
+            else
+                menu_level = menu_level < level_count ? menu_level + 1 : 1;
+            oldpad = pad;
+            menu_needs_redraw = 1;
+            continue;
+        }
+
+        /* TRIANGLE plays back the last game */
+        if((pad.Buttons & PSP_CTRL_TRIANGLE) && !(oldpad.Buttons & PSP_CTRL_TRIANGLE))
+        {
+            replay_last_game();
+            oldpad = pad;
             menu_needs_redraw = 1;
             continue;
         }
@@ -146,6 +415,7 @@ int main(void)
     }
 
     /* Exit */
+    preload_shutdown();
     sceKernelExitGame();
     return 0;
 }
@@ -0,0 +1,449 @@
+/*
+ * Split-Field Level Packs
+ * Reading and writing binary level packs, and their tile compression
+ */
+
+#include "pack.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned char pack_magic[4] = { 'S', 'F', 'P', 'K' };
+
+/* Shortest match worth a sequence, and the farthest back one can reach */
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_DISTANCE 0xFFFF
+#define LZ_HASH_BITS 12
+
+static void put_u16(unsigned char* p, unsigned int v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put_u32(unsigned char* p, unsigned int v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static unsigned int get_u16(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get_u32(const unsigned char* p)
+{
+    return get_u16(p) | ((unsigned int)get_u16(p + 2) << 16);
+}
+
+int pack_compress_bound(int size)
+{
+    return size + size / 255 + 16;
+}
+
+/* A count that filled its token nibble: what is left over, in bytes of
+ * 255 and then one under */
+static unsigned char* put_length(unsigned char* out, int length)
+{
+    for (length -= 15; length >= 255; length -= 255)
+        *out++ = 255;
+    *out++ = (unsigned char)length;
+    return out;
+}
+
+static unsigned char* put_sequence(unsigned char* out, const unsigned char* literals, int literal_count,
+                                   int distance, int match)
+{
+    unsigned char* token = out++;
+    int match_code = match ? match - LZ_MIN_MATCH : 0;
+
+    *token = (unsigned char)(((literal_count < 15 ? literal_count : 15) << 4) |
+                             (match_code < 15 ? match_code : 15));
+    if (literal_count >= 15)
+        out = put_length(out, literal_count);
+    memcpy(out, literals, literal_count);
+    out += literal_count;
+
+    if (match) {
+        put_u16(out, distance);
+        out += 2;
+        if (match_code >= 15)
+            out = put_length(out, match_code);
+    }
+    return out;
+}
+
+static unsigned int hash4(const unsigned char* p)
+{
+    unsigned int v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+int pack_compress(const unsigned char* in, int size, unsigned char* out)
+{
+    int last_seen[1 << LZ_HASH_BITS];
+    unsigned char* start = out;
+    int anchor = 0, i = 0;
+
+    memset(last_seen, 0xFF, sizeof(last_seen));
+
+    /* Greedy: take the match at the last place these four bytes were seen */
+    while (i + LZ_MIN_MATCH <= size) {
+        unsigned int h = hash4(in + i);
+        int from = last_seen[h];
+        last_seen[h] = i;
+
+        if (from < 0 || i - from > LZ_MAX_DISTANCE || memcmp(in + from, in + i, LZ_MIN_MATCH) != 0) {
+            i++;
+            continue;
+        }
+
+        int match = LZ_MIN_MATCH;
+        while (i + match < size && in[from + match] == in[i + match])
+            match++;
+        out = put_sequence(out, in + anchor, i - anchor, i - from, match);
+        i += match;
+        anchor = i;
+    }
+
+    if (anchor < size)
+        out = put_sequence(out, in + anchor, size - anchor, 0, 0);
+    return (int)(out - start);
+}
+
+/* A length continued past its token nibble; -1 if data runs out */
+static int get_length(const unsigned char** p, const unsigned char* end, int length)
+{
+    unsigned char b;
+
+    do {
+        if (*p >= end)
+            return -1;
+        b = *(*p)++;
+        length += b;
+    } while (b == 255);
+    return length;
+}
+
+int pack_decompress(const unsigned char* data, int data_size, unsigned char* out, int size)
+{
+    const unsigned char* p = data;
+    const unsigned char* end = data + data_size;
+    int n = 0;
+
+    while (p < end) {
+        int token = *p++;
+
+        int literal_count = token >> 4;
+        if (literal_count == 15 && (literal_count = get_length(&p, end, 15)) < 0)
+            return -1;
+        if (literal_count > end - p || literal_count > size - n)
+            return -1;
+        memcpy(out + n, p, literal_count);
+        p += literal_count;
+        n += literal_count;
+        if (p == end)
+            break;
+
+        if (end - p < 2)
+            return -1;
+        int distance = get_u16(p);
+        p += 2;
+        int match = token & 15;
+        if (match == 15 && (match = get_length(&p, end, 15)) < 0)
+            return -1;
+        match += LZ_MIN_MATCH;
+        if (distance == 0 || distance > n || match > size - n)
+            return -1;
+
+        /* Byte by byte: a match may run on into the bytes it makes */
+        const unsigned char* from = out + n - distance;
+        for (int i = 0; i < match; i++)
+            out[n + i] = from[i];
+        n += match;
+    }
+    return n == size ? 0 : -1;
+}
+
+int pack_header_count(const unsigned char* header)
+{
+    if (memcmp(header, pack_magic, 4) != 0 || get_u16(header + 4) != PACK_VERSION ||
+        get_u32(header + 8) > 0x7FFFFFF)
+        return -1;
+    return (int)get_u32(header + 8);
+}
+
+long pack_index_offset(int number)
+{
+    return PACK_HEADER_SIZE + (long)(number - 1) * PACK_INDEX_ENTRY_SIZE;
+}
+
+int pack_index_entry(const unsigned char* entry, unsigned int* offset, unsigned int* size)
+{
+    *offset = get_u32(entry);
+    *size = get_u32(entry + 4);
+    return *size < PACK_RECORD_HEADER_SIZE || *offset > 0x7FFFFFFF ? -1 : 0;
+}
+
+int pack_open(LevelPack* pack, const char* path)
+{
+    unsigned char header[PACK_HEADER_SIZE];
+
+    memset(pack, 0, sizeof(LevelPack));
+    pack->file = fopen(path, "rb");
+    if (!pack->file)
+        return -1;
+
+    if (fread(header, 1, PACK_HEADER_SIZE, pack->file) != PACK_HEADER_SIZE ||
+        (pack->count = pack_header_count(header)) < 0) {
+        pack_close(pack);
+        return -1;
+    }
+    return 0;
+}
+
+void pack_close(LevelPack* pack)
+{
+    if (pack->file)
+        fclose(pack->file);
+    free(pack->buffer);
+    memset(pack, 0, sizeof(LevelPack));
+}
+
+/* The tiles, straight into the field */
+static int read_tiles(LevelPack* pack, GameContext* ctx, int encoding, int bytes)
+{
+    int cells = ctx->field_width * ctx->field_height;
+
+    if (encoding == PACK_TILES_RAW)
+        return bytes == cells && fread(ctx->field, 1, cells, pack->file) == (size_t)cells ? 0 : -1;
+    if (encoding != PACK_TILES_LZ || bytes > pack_compress_bound(cells))
+        return -1;
+
+    if (bytes > pack->capacity) {
+        unsigned char* buffer = (unsigned char*)realloc(pack->buffer, bytes);
+        if (!buffer)
+            return -1;
+        pack->buffer = buffer;
+        pack->capacity = bytes;
+    }
+    if (fread(pack->buffer, 1, bytes, pack->file) != (size_t)bytes)
+        return -1;
+    return pack_decompress(pack->buffer, bytes, ctx->field, cells);
+}
+
+/* Every tile a known type and every entity on the field */
+static int level_fits(const GameContext* ctx)
+{
+    int cells = ctx->field_width * ctx->field_height;
+
+    for (int i = 0; i < cells; i++) {
+        if (ctx->field[i] > TILE_BARRIER)
+            return 0;
+    }
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        int enemy = slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1;
+        if (enemy && !ENEMY_ACTIVE(ctx, slot - ENTITY_ENEMY0))
+            continue;
+        if (ctx->sim.x[slot] >= ctx->field_width || ctx->sim.y[slot] >= ctx->field_height)
+            return 0;
+    }
+    for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
+        if (ctx->box_owner[i] < 1 || ctx->box_owner[i] > 2)
+            return 0;
+    }
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        if (ENEMY_ACTIVE(ctx, i) && (ctx->enemy_target[i] < 1 || ctx->enemy_target[i] > 2))
+            return 0;
+    }
+    return 1;
+}
+
+/* The field and entities from a record's header, ahead of its tiles;
+ * returns the tile bytes that follow, or -1 */
+static int begin_record(GameContext* ctx, const unsigned char* record, unsigned int size)
+{
+    int bytes = (int)get_u32(record + 34);
+
+    if (bytes < 0 || size != PACK_RECORD_HEADER_SIZE + (unsigned int)bytes)
+        return -1;
+    if (sim_alloc_field(ctx, get_u16(record), get_u16(record + 2)) < 0)
+        return -1;
+
+    ctx->sim.enemy_active = record[5];
+    memcpy(ctx->box_owner, record + 6, MAX_MIRROR_BOXES);
+    memcpy(ctx->enemy_target, record + 10, MAX_ENEMIES);
+    memcpy(ctx->sim.x, record + 14, ENTITY_COUNT);
+    memcpy(ctx->sim.y, record + 24, ENTITY_COUNT);
+    return bytes;
+}
+
+/* With the tiles in: check the whole level and index its entities */
+static int finish_record(GameContext* ctx, int tiles_ok, int number)
+{
+    if (!tiles_ok || !level_fits(ctx)) {
+        sim_cleanup(ctx);
+        return -1;
+    }
+
+    ctx->total_boxes = MAX_MIRROR_BOXES;
+    ctx->level = number;
+    sim_rebuild_occupancy(ctx);
+    sim_start_flow(ctx);
+    return 0;
+}
+
+int pack_load(LevelPack* pack, GameContext* ctx, int number)
+{
+    unsigned char entry[PACK_INDEX_ENTRY_SIZE];
+    unsigned char record[PACK_RECORD_HEADER_SIZE];
+    unsigned int offset, size;
+
+    memset(ctx, 0, sizeof(GameContext));
+    if (number < 1 || number > pack->count)
+        return -1;
+
+    if (fseek(pack->file, pack_index_offset(number), SEEK_SET) != 0 ||
+        fread(entry, 1, PACK_INDEX_ENTRY_SIZE, pack->file) != PACK_INDEX_ENTRY_SIZE ||
+        pack_index_entry(entry, &offset, &size) < 0)
+        return -1;
+
+    if (fseek(pack->file, (long)offset, SEEK_SET) != 0 ||
+        fread(record, 1, PACK_RECORD_HEADER_SIZE, pack->file) != PACK_RECORD_HEADER_SIZE)
+        return -1;
+    int bytes = begin_record(ctx, record, size);
+    if (bytes < 0)
+        return -1;
+
+    return finish_record(ctx, read_tiles(pack, ctx, record[4], bytes) == 0, number);
+}
+
+int pack_decode(GameContext* ctx, const unsigned char* record, int size, int number)
+{
+    memset(ctx, 0, sizeof(GameContext));
+    if (size < PACK_RECORD_HEADER_SIZE)
+        return -1;
+    int bytes = begin_record(ctx, record, (unsigned int)size);
+    if (bytes < 0)
+        return -1;
+
+    const unsigned char* tiles = record + PACK_RECORD_HEADER_SIZE;
+    int cells = ctx->field_width * ctx->field_height;
+    int ok = 0;
+    if (record[4] == PACK_TILES_RAW && bytes == cells) {
+        memcpy(ctx->field, tiles, cells);
+        ok = 1;
+    } else if (record[4] == PACK_TILES_LZ) {
+        ok = pack_decompress(tiles, bytes, ctx->field, cells) == 0;
+    }
+    return finish_record(ctx, ok, number);
+}
+
+int pack_load_file(GameContext* ctx, const char* path, int number)
+{
+    LevelPack pack;
+
+    if (pack_open(&pack, path) < 0)
+        return -1;
+    int result = pack_load(&pack, ctx, number);
+    pack_close(&pack);
+    return result;
+}
+
+static int write_header(PackWriter* writer)
+{
+    unsigned char header[PACK_HEADER_SIZE];
+    long index_size = (long)writer->count * PACK_INDEX_ENTRY_SIZE;
+
+    memcpy(header, pack_magic, 4);
+    put_u16(header + 4, PACK_VERSION);
+    put_u16(header + 6, 0);
+    put_u32(header + 8, writer->count);
+    return fseek(writer->file, 0, SEEK_SET) == 0 &&
+           fwrite(header, 1, PACK_HEADER_SIZE, writer->file) == PACK_HEADER_SIZE &&
+           fwrite(writer->index, 1, index_size, writer->file) == (size_t)index_size ? 0 : -1;
+}
+
+int pack_writer_open(PackWriter* writer, const char* path, int count)
+{
+    memset(writer, 0, sizeof(PackWriter));
+    if (count < 1 || count > 0x7FFFFFF / PACK_INDEX_ENTRY_SIZE)
+        return -1;
+
+    writer->count = count;
+    writer->index = (unsigned char*)calloc(count, PACK_INDEX_ENTRY_SIZE);
+    writer->file = writer->index ? fopen(path, "wb") : NULL;
+    writer->offset = PACK_HEADER_SIZE + (long)count * PACK_INDEX_ENTRY_SIZE;
+
+    /* An empty index for now, so records land after it */
+    if (!writer->file || write_header(writer) < 0) {
+        if (writer->file)
+            fclose(writer->file);
+        free(writer->index);
+        memset(writer, 0, sizeof(PackWriter));
+        return -1;
+    }
+    return 0;
+}
+
+int pack_writer_add(PackWriter* writer, const GameContext* ctx, int compress)
+{
+    unsigned char record[PACK_RECORD_HEADER_SIZE];
+    int cells = ctx->field_width * ctx->field_height;
+
+    if (ctx->level < 1 || ctx->level > writer->count)
+        return -1;
+    unsigned char* entry = writer->index + (long)(ctx->level - 1) * PACK_INDEX_ENTRY_SIZE;
+    if (get_u32(entry + 4) != 0)
+        return -1;
+
+    const unsigned char* tiles = ctx->field;
+    unsigned char* packed = NULL;
+    int encoding = PACK_TILES_RAW, bytes = cells;
+    if (compress) {
+        packed = (unsigned char*)malloc(pack_compress_bound(cells));
+        if (!packed)
+            return -1;
+        int n = pack_compress(ctx->field, cells, packed);
+        if (n < cells) {
+            tiles = packed;
+            encoding = PACK_TILES_LZ;
+            bytes = n;
+        }
+    }
+
+    put_u16(record, ctx->field_width);
+    put_u16(record + 2, ctx->field_height);
+    record[4] = (unsigned char)encoding;
+    record[5] = ctx->sim.enemy_active;
+    memcpy(record + 6, ctx->box_owner, MAX_MIRROR_BOXES);
+    memcpy(record + 10, ctx->enemy_target, MAX_ENEMIES);
+    memcpy(record + 14, ctx->sim.x, ENTITY_COUNT);
+    memcpy(record + 24, ctx->sim.y, ENTITY_COUNT);
+    put_u32(record + 34, bytes);
+
+    int ok = fseek(writer->file, writer->offset, SEEK_SET) == 0 &&
+             fwrite(record, 1, PACK_RECORD_HEADER_SIZE, writer->file) == PACK_RECORD_HEADER_SIZE &&
+             fwrite(tiles, 1, bytes, writer->file) == (size_t)bytes;
+    free(packed);
+    if (!ok)
+        return -1;
+
+    put_u32(entry, (unsigned int)writer->offset);
+    put_u32(entry + 4, PACK_RECORD_HEADER_SIZE + bytes);
+    writer->offset += PACK_RECORD_HEADER_SIZE + bytes;
+    writer->raw_bytes += cells;
+    writer->stored_bytes += bytes;
+    return 0;
+}
+
+int pack_writer_close(PackWriter* writer)
+{
+    int ok = write_header(writer) == 0;
+
+    if (fclose(writer->file) != 0)
+        ok = 0;
+    free(writer->index);
+    memset(writer, 0, sizeof(PackWriter));
+    return ok ? 0 : -1;
+}
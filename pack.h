@@ -0,0 +1,102 @@
+/*
+ * Split-Field Level Packs
+ * Many levels in one binary file, for the memory stick: an index up
+ * front, then one record per level holding its tiles a byte each and its
+ * entities laid out as GameContext keeps them. Loading a level seeks to
+ * its index entry and then its record and reads only those, straight
+ * into the context: the tiles into ctx->field, the entity table into
+ * ctx->sim. Tiles may be LZ-compressed, which makes mostly-floor fields
+ * several times smaller. Platform-free; files go through stdio, which
+ * reaches the memory stick on the PSP.
+ *
+ * File layout, all fields little-endian:
+ *   "SFPK", u16 version, u16 reserved, u32 level count,
+ *   index: per level number from 1, u32 record offset and u32 record
+ *   size (0 for a number with no level),
+ *   records: u16 width, u16 height, u8 tile encoding, u8 enemy_active,
+ *     u8 box_owner[4], u8 enemy_target[4], u8 x[10], u8 y[10],
+ *     u32 tile bytes, then the tiles, row-major
+ *
+ * Compressed tiles are sequences of a token byte (literal count in its
+ * high nibble, match length less 4 in its low nibble, 15 meaning more
+ * follows in bytes added on until one is under 255), the literals, then a
+ * u16 distance back to copy the match from. The last sequence stops after
+ * its literals.
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include "sim.h"
+#include <stdio.h>
+
+#define PACK_VERSION 1
+#define PACK_HEADER_SIZE 12
+#define PACK_INDEX_ENTRY_SIZE 8
+#define PACK_RECORD_HEADER_SIZE 38
+
+/* How a record's tiles are stored */
+typedef enum {
+    PACK_TILES_RAW = 0,
+    PACK_TILES_LZ
+} PackTiles;
+
+/* An open pack: the file and its index, read a level at a time */
+typedef struct {
+    FILE* file;
+    int count;                /* Highest level number */
+    unsigned char* buffer;    /* Compressed tiles on their way in */
+    int capacity;
+} LevelPack;
+
+/* Open a pack and check its header; returns -1 if it cannot be read or
+ * is not a pack of this version */
+int pack_open(LevelPack* pack, const char* path);
+void pack_close(LevelPack* pack);
+
+/* Load level number into ctx, set up afresh. Returns -1 if the pack has
+ * no such level or its record is damaged, leaving ctx cleaned up. */
+int pack_load(LevelPack* pack, GameContext* ctx, int number);
+
+/* pack_open, pack_load and pack_close for a single level */
+int pack_load_file(GameContext* ctx, const char* path, int number);
+
+/* The same a step at a time, for readers doing their own I/O: the level
+ * count from the file's first PACK_HEADER_SIZE bytes (-1 if they are not
+ * a pack of this version), where a level's index entry is, the record's
+ * place from that entry (-1 if the number has no level), and the level
+ * from the whole record once read */
+int pack_header_count(const unsigned char* header);
+long pack_index_offset(int number);
+int pack_index_entry(const unsigned char* entry, unsigned int* offset, unsigned int* size);
+int pack_decode(GameContext* ctx, const unsigned char* record, int size, int number);
+
+/* Builds a pack a level at a time; levels may come in any order */
+typedef struct {
+    FILE* file;
+    int count;
+    unsigned char* index;     /* Written out by pack_writer_close */
+    long offset;              /* Where the next record goes */
+    long raw_bytes;           /* Tile bytes in, and as stored */
+    long stored_bytes;
+} PackWriter;
+
+/* Start a pack for levels numbered 1 to count */
+int pack_writer_open(PackWriter* writer, const char* path, int count);
+
+/* Add ctx's level under ctx->level, its tiles compressed if compress is
+ * set and that makes them smaller; returns -1 if the number is out of
+ * range, already added, or the write fails */
+int pack_writer_add(PackWriter* writer, const GameContext* ctx, int compress);
+
+/* Write the index and close; returns -1 if anything failed to write */
+int pack_writer_close(PackWriter* writer);
+
+/* LZ compression of the tiles on their own: the most bytes pack_compress
+ * writes for size bytes in, and the bytes written. pack_decompress
+ * returns -1 unless data decodes to exactly size bytes. */
+int pack_compress_bound(int size);
+int pack_compress(const unsigned char* in, int size, unsigned char* out);
+int pack_decompress(const unsigned char* data, int data_size, unsigned char* out, int size);
+
+#endif /* PACK_H */
@@ -0,0 +1,402 @@
+/*
+ * Split-Field Preloading
+ * The loader thread, its hand-over of the spare level, and the reads
+ * behind it on each platform
+ */
+
+#include "preload.h"
+#include "pack.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SF_HOST
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#else
+#include <pspkernel.h>
+#include <pspthreadman.h>
+#include <pspiofilemgr.h>
+#endif
+
+/* Numerically above the main thread's 0x20: it runs only when play and
+ * rendering are waiting */
+#define LOADER_PRIORITY 0x30
+#define LOADER_STACK_SIZE 0x4000
+
+/* What the loader thread waits on, and the game waits on */
+enum { SIGNAL_WAKE, SIGNAL_DONE };
+
+static struct {
+    int active;
+    int count;               /* Levels the pack numbers */
+
+    /* Shared with the loader, under the lock */
+    int want;                /* Level asked for, 0 for none */
+    int have;                /* Level in the spare, 0 for none */
+    int failed;              /* Level asked for that could not be read */
+    int quit;
+    GameContext spare;       /* The loader's, unless have is set */
+    PreloadStats stats;
+
+    /* The loader's own: the record being read */
+    unsigned char* record;
+    int capacity;
+} loader;
+
+#ifdef SF_HOST
+static FILE* pack_file;
+static pthread_t loader_thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t signals[2] = { PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+static unsigned int storage_seek_us;
+static unsigned int storage_kb_per_sec;
+
+static unsigned int clock_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned int)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+static void sync_lock(void)
+{
+    pthread_mutex_lock(&lock);
+}
+
+static void sync_unlock(void)
+{
+    pthread_mutex_unlock(&lock);
+}
+
+/* Both with the lock held; waiting gives it up meanwhile */
+static void sync_wait(int signal)
+{
+    pthread_cond_wait(&signals[signal], &lock);
+}
+
+static void sync_post(int signal)
+{
+    pthread_cond_signal(&signals[signal]);
+}
+
+void preload_set_storage(unsigned int seek_us, unsigned int kb_per_sec)
+{
+    storage_seek_us = seek_us;
+    storage_kb_per_sec = kb_per_sec;
+}
+
+/* Read size bytes at offset, taking as long as the storage would */
+static int read_at(long offset, void* buffer, int size)
+{
+    if (fseek(pack_file, offset, SEEK_SET) != 0 || fread(buffer, 1, size, pack_file) != (size_t)size)
+        return -1;
+
+    unsigned long long us = storage_seek_us;
+    if (storage_kb_per_sec)
+        us += (unsigned long long)size * 1000000 / (storage_kb_per_sec * 1024ULL);
+    struct timespec delay = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+    if (us)
+        nanosleep(&delay, NULL);
+    return 0;
+}
+
+static int open_pack(const char* path)
+{
+    pack_file = fopen(path, "rb");
+    return pack_file ? 0 : -1;
+}
+
+static void close_pack(void)
+{
+    fclose(pack_file);
+    pack_file = NULL;
+}
+
+static void* loader_main(void* arg);
+
+static int start_loader(void)
+{
+    return pthread_create(&loader_thread, NULL, loader_main, NULL) == 0 ? 0 : -1;
+}
+
+static void join_loader(void)
+{
+    pthread_join(loader_thread, NULL);
+}
+#else
+static SceUID pack_fd = -1;
+static SceUID loader_thread = -1;
+static SceUID lock = -1;
+static SceUID signals[2] = { -1, -1 };
+
+static unsigned int clock_us(void)
+{
+    return sceKernelGetSystemTimeLow();
+}
+
+static void sync_lock(void)
+{
+    sceKernelWaitSema(lock, 1, NULL);
+}
+
+static void sync_unlock(void)
+{
+    sceKernelSignalSema(lock, 1);
+}
+
+/* Both with the lock held; waiting gives it up meanwhile. A semaphore
+ * keeps count, so a post made before the wait is not lost. */
+static void sync_wait(int signal)
+{
+    sync_unlock();
+    sceKernelWaitSema(signals[signal], 1, NULL);
+    sync_lock();
+}
+
+static void sync_post(int signal)
+{
+    sceKernelSignalSema(signals[signal], 1);
+}
+
+/* Read size bytes at offset; the thread sleeps until the memory stick
+ * has them */
+static int read_at(long offset, void* buffer, int size)
+{
+    SceInt64 result;
+
+    if (sceIoLseekAsync(pack_fd, offset, PSP_SEEK_SET) < 0 || sceIoWaitAsync(pack_fd, &result) < 0 ||
+        result != offset)
+        return -1;
+    if (sceIoReadAsync(pack_fd, buffer, size) < 0 || sceIoWaitAsync(pack_fd, &result) < 0 || result != size)
+        return -1;
+    return 0;
+}
+
+static int open_pack(const char* path)
+{
+    pack_fd = sceIoOpen(path, PSP_O_RDONLY, 0);
+    if (pack_fd < 0)
+        return -1;
+
+    lock = sceKernelCreateSema("preload_lock", 0, 1, 1, NULL);
+    signals[SIGNAL_WAKE] = sceKernelCreateSema("preload_wake", 0, 0, 0x10000, NULL);
+    signals[SIGNAL_DONE] = sceKernelCreateSema("preload_done", 0, 0, 0x10000, NULL);
+    return lock >= 0 && signals[SIGNAL_WAKE] >= 0 && signals[SIGNAL_DONE] >= 0 ? 0 : -1;
+}
+
+static void close_pack(void)
+{
+    if (pack_fd >= 0)
+        sceIoClose(pack_fd);
+    for (int i = 0; i < 2; i++) {
+        if (signals[i] >= 0)
+            sceKernelDeleteSema(signals[i]);
+        signals[i] = -1;
+    }
+    if (lock >= 0)
+        sceKernelDeleteSema(lock);
+    lock = pack_fd = -1;
+}
+
+static int loader_main(SceSize args, void* argp);
+
+static int start_loader(void)
+{
+    loader_thread = sceKernelCreateThread("preload", loader_main, LOADER_PRIORITY, LOADER_STACK_SIZE,
+                                          THREAD_ATTR_USER, NULL);
+    if (loader_thread < 0)
+        return -1;
+    if (sceKernelStartThread(loader_thread, 0, NULL) < 0) {
+        sceKernelDeleteThread(loader_thread);
+        return -1;
+    }
+    return 0;
+}
+
+static void join_loader(void)
+{
+    sceKernelWaitThreadEnd(loader_thread, NULL);
+    sceKernelDeleteThread(loader_thread);
+    loader_thread = -1;
+}
+#endif
+
+/* One level, its index entry and then its record, into ctx */
+static int load(int number, GameContext* ctx)
+{
+    unsigned char entry[PACK_INDEX_ENTRY_SIZE];
+    unsigned int offset, size;
+
+    memset(ctx, 0, sizeof(GameContext));
+    if (read_at(pack_index_offset(number), entry, PACK_INDEX_ENTRY_SIZE) < 0 ||
+        pack_index_entry(entry, &offset, &size) < 0 || size > 0x1000000)
+        return -1;
+
+    if ((int)size > loader.capacity) {
+        unsigned char* record = (unsigned char*)realloc(loader.record, size);
+        if (!record)
+            return -1;
+        loader.record = record;
+        loader.capacity = (int)size;
+    }
+    if (read_at((long)offset, loader.record, (int)size) < 0)
+        return -1;
+    return pack_decode(ctx, loader.record, (int)size, number);
+}
+
+/* Wait for a level to be asked for that the spare does not hold, read
+ * it, hand it over; until told to quit */
+static void loader_loop(void)
+{
+    sync_lock();
+    for (;;) {
+        while (!loader.quit && (loader.want == 0 || loader.want == loader.have || loader.want == loader.failed))
+            sync_wait(SIGNAL_WAKE);
+        if (loader.quit)
+            break;
+
+        int number = loader.want;
+        int drop = loader.have != 0;
+        loader.have = 0;
+        sync_unlock();
+
+        if (drop)
+            sim_cleanup(&loader.spare);
+        unsigned int start = clock_us();
+        int ok = load(number, &loader.spare) == 0;
+        unsigned int took = clock_us() - start;
+
+        sync_lock();
+        if (ok) {
+            loader.have = number;
+            loader.stats.loads++;
+            loader.stats.load_us = took;
+            if (took > loader.stats.max_load_us)
+                loader.stats.max_load_us = took;
+        } else {
+            loader.failed = number;
+        }
+        sync_post(SIGNAL_DONE);
+    }
+    sync_unlock();
+}
+
+#ifdef SF_HOST
+static void* loader_main(void* arg)
+{
+    (void)arg;
+    loader_loop();
+    return NULL;
+}
+#else
+static int loader_main(SceSize args, void* argp)
+{
+    loader_loop();
+    return 0;
+}
+#endif
+
+int preload_init(const char* path)
+{
+    unsigned char header[PACK_HEADER_SIZE];
+
+    memset(&loader, 0, sizeof(loader));
+    if (open_pack(path) < 0)
+        return -1;
+    if (read_at(0, header, PACK_HEADER_SIZE) < 0 || (loader.count = pack_header_count(header)) < 0 ||
+        start_loader() < 0) {
+        close_pack();
+        return -1;
+    }
+    loader.active = 1;
+    return 0;
+}
+
+void preload_shutdown(void)
+{
+    if (!loader.active)
+        return;
+
+    sync_lock();
+    loader.quit = 1;
+    sync_post(SIGNAL_WAKE);
+    sync_unlock();
+    join_loader();
+
+    if (loader.have)
+        sim_cleanup(&loader.spare);
+    free(loader.record);
+    close_pack();
+    memset(&loader, 0, sizeof(loader));
+}
+
+int preload_active(void)
+{
+    return loader.active;
+}
+
+int preload_count(void)
+{
+    return loader.count;
+}
+
+/* Ask the loader for number; with the lock held */
+static void ask(int number)
+{
+    if (loader.want == number)
+        return;
+    loader.want = number;
+    loader.failed = 0;
+    sync_post(SIGNAL_WAKE);
+}
+
+void preload_request(int number)
+{
+    if (!loader.active || number < 1 || number > loader.count)
+        return;
+
+    sync_lock();
+    ask(number);
+    sync_unlock();
+}
+
+int preload_take(GameContext* ctx, int number)
+{
+    memset(ctx, 0, sizeof(GameContext));
+    if (!loader.active || number < 1 || number > loader.count)
+        return -1;
+
+    unsigned int start = clock_us();
+    sync_lock();
+    int ready = loader.have == number;
+    ask(number);
+    while (loader.have != number && loader.failed != number)
+        sync_wait(SIGNAL_DONE);
+
+    int ok = loader.have == number;
+    if (ok) {
+        *ctx = loader.spare;
+        memset(&loader.spare, 0, sizeof(GameContext));
+        loader.have = 0;
+    }
+    loader.want = 0;
+
+    PreloadStats* stats = &loader.stats;
+    unsigned int took = clock_us() - start;
+    stats->takes++;
+    if (ready)
+        stats->ready++;
+    else
+        stats->waited++;
+    stats->take_us = took;
+    if (took > stats->max_take_us)
+        stats->max_take_us = took;
+    sync_unlock();
+    return ok ? 0 : -1;
+}
+
+const PreloadStats* preload_stats(void)
+{
+    return &loader.stats;
+}
@@ -0,0 +1,56 @@
+/*
+ * Split-Field Preloading
+ * Levels read from the pack ahead of time on a background thread of low
+ * priority, into a spare GameContext, so the game can ask for the next
+ * level while this one is played and change over by taking the spare:
+ * a struct copy that moves the field's pointers, with no file access.
+ * One level is held at a time. On the PSP the thread reads with
+ * sceIoReadAsync and sleeps until the memory stick is done; on the host
+ * it is a worker thread with stdio, which can be slowed to a memory
+ * stick's seek time and transfer rate for measuring.
+ */
+
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include "sim.h"
+
+/* Level changes and the reads behind them */
+typedef struct {
+    unsigned int loads;          /* Levels read in the background */
+    unsigned int load_us;        /* Time the last one took, reading included */
+    unsigned int max_load_us;
+    unsigned int takes;          /* preload_take calls: */
+    unsigned int ready;          /* the level was already in the spare */
+    unsigned int waited;         /* it was still loading, or never asked for */
+    unsigned int take_us;        /* Time the last take kept the caller: the */
+    unsigned int max_take_us;    /* level change as the player sees it */
+} PreloadStats;
+
+/* Open a pack and start the loader; returns -1 if it is not a pack or
+ * the thread cannot be started */
+int preload_init(const char* path);
+void preload_shutdown(void);
+
+/* Is the loader running, and the levels its pack numbers */
+int preload_active(void);
+int preload_count(void);
+
+/* Load level number into the spare in the background, in place of what
+ * it holds or is loading; numbers out of range are ignored. Returns at
+ * once. */
+void preload_request(int number);
+
+/* Set up ctx with level number: the spare if it holds it, else after
+ * the loader has read it. Returns -1 if the pack has no such level. */
+int preload_take(GameContext* ctx, int number);
+
+const PreloadStats* preload_stats(void);
+
+#ifdef SF_HOST
+/* Make every read take seek_us plus the time to move its bytes at
+ * kb_per_sec (0 for no limit), as a memory stick would */
+void preload_set_storage(unsigned int seek_us, unsigned int kb_per_sec);
+#endif
+
+#endif /* PRELOAD_H */
@@ -0,0 +1,165 @@
+/*
+ * Split-Field Render Target
+ * Clip-then-fill and clip-then-copy over a plain framebuffer; the word
+ * loops themselves live in kernels.c.
+ * Builds for the PSP and as a host-native target.
+ */
+
+#include "render.h"
+#include "kernels.h"
+#include <string.h>
+
+/* Game colours in 0xAARRGGBB, indexed by ColorIndex */
+static const unsigned int palette_argb[COLOR_COUNT] = {
+    0xFF202020, /* COLOR_BACKGROUND: dark gray */
+    0xFF101010, /* COLOR_EMPTY */
+    0xFF666666, /* COLOR_WALL */
+    0xFF996633, /* COLOR_BOX: brown */
+    0xFF9966FF, /* COLOR_GHOST_BOX: purple */
+    0xFFFF0000, /* COLOR_ENEMY_TILE: red */
+    0xFF00FF00, /* COLOR_GOAL: green */
+    0xFFFFFF00, /* COLOR_BARRIER: yellow */
+    0xFF000000, /* COLOR_BORDER */
+    0xFFFF8844, /* COLOR_BOX_P1: orange */
+    0xFF4488FF, /* COLOR_BOX_P2: blue */
+    0xFFFF0000, /* COLOR_ENEMY */
+    0xFF880000, /* COLOR_ENEMY_BORDER */
+    0xFFFF4444, /* COLOR_PLAYER1 */
+    0xFF4444FF, /* COLOR_PLAYER2 */
+    0xFFFFFFFF  /* COLOR_HINT: white */
+};
+
+unsigned int render_convert_color(unsigned int argb, int format)
+{
+    unsigned int a = (argb >> 24) & 0xFF;
+    unsigned int r = (argb >> 16) & 0xFF;
+    unsigned int g = (argb >> 8) & 0xFF;
+    unsigned int b = argb & 0xFF;
+
+    if (format == RENDER_FORMAT_8888) {
+        /* Little-endian ABGR */
+        return (a << 24) | (b << 16) | (g << 8) | r;
+    }
+
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+void render_palette_init(RenderPalette* pal, int format)
+{
+    pal->format = format;
+    for (int i = 0; i < COLOR_COUNT; i++)
+        pal->pixel[i] = render_convert_color(palette_argb[i], format);
+}
+
+int render_bytes_per_pixel(int format)
+{
+    return (format == RENDER_FORMAT_8888) ? 4 : 2;
+}
+
+int render_target_init(RenderTarget* rt, void* base, int stride, int format,
+                       int width, int height)
+{
+    memset(rt, 0, sizeof(RenderTarget));
+
+    if (!base || stride <= 0 || width <= 0 || height <= 0)
+        return -1;
+
+    rt->base = base;
+    rt->stride = stride;
+    rt->format = format;
+    rt->width = (width < stride) ? width : stride;
+    rt->height = height;
+    return 0;
+}
+
+void render_fill_span32(unsigned int* dst, int n, unsigned int pixel)
+{
+    kernel_fill32(dst, n, pixel);
+}
+
+void render_fill_span16(unsigned short* dst, int n, unsigned short pixel)
+{
+    if (n <= 0)
+        return;
+
+    /* Align to 4 bytes, then fill pixel pairs as 32-bit words */
+    if ((unsigned long)dst & 2) {
+        *dst++ = pixel;
+        n--;
+    }
+
+    kernel_fill32((unsigned int*)dst, n >> 1, ((unsigned int)pixel << 16) | pixel);
+
+    if (n & 1)
+        dst[n - 1] = pixel;
+}
+
+void render_fill_rect(const RenderTarget* rt, int x, int y, int w, int h, unsigned int pixel)
+{
+    /* Clip once against the target */
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > rt->width) w = rt->width - x;
+    if (y + h > rt->height) h = rt->height - y;
+    if (w <= 0 || h <= 0)
+        return;
+
+    if (rt->stats)
+        rt->stats->pixels_written += w * h;
+
+    if (rt->format == RENDER_FORMAT_8888) {
+        unsigned int* row = (unsigned int*)rt->base + y * rt->stride + x;
+        for (int dy = 0; dy < h; dy++) {
+            render_fill_span32(row, w, pixel);
+            row += rt->stride;
+        }
+    } else {
+        unsigned short* row = (unsigned short*)rt->base + y * rt->stride + x;
+        for (int dy = 0; dy < h; dy++) {
+            render_fill_span16(row, w, (unsigned short)pixel);
+            row += rt->stride;
+        }
+    }
+}
+
+void render_blit(const RenderTarget* rt, int x, int y, int w, int h,
+                 const void* src, int src_stride)
+{
+    int bpp = render_bytes_per_pixel(rt->format);
+    const unsigned char* src_row = (const unsigned char*)src;
+
+    /* Clip once against the target, skipping source pixels to match */
+    if (x < 0) { src_row -= x * bpp; w += x; x = 0; }
+    if (y < 0) { src_row -= y * src_stride * bpp; h += y; y = 0; }
+    if (x + w > rt->width) w = rt->width - x;
+    if (y + h > rt->height) h = rt->height - y;
+    if (w <= 0 || h <= 0)
+        return;
+
+    if (rt->stats)
+        rt->stats->pixels_written += w * h;
+
+    unsigned char* dst_row = (unsigned char*)rt->base + (y * rt->stride + x) * bpp;
+    int row_bytes = w * bpp;
+
+    /* Word kernels when every row starts and ends on a word boundary */
+    int words = ((row_bytes | (unsigned long)dst_row | (unsigned long)src_row |
+                  (rt->stride * bpp) | (src_stride * bpp)) & 3) == 0;
+
+    for (int dy = 0; dy < h; dy++) {
+        if (words)
+            kernel_copy32((unsigned int*)dst_row, (const unsigned int*)src_row, row_bytes / 4);
+        else
+            memcpy(dst_row, src_row, row_bytes);
+        dst_row += rt->stride * bpp;
+        src_row += src_stride * bpp;
+    }
+}
+
+void render_rect_outline(const RenderTarget* rt, int x, int y, int size, unsigned int pixel)
+{
+    render_fill_rect(rt, x, y, size, 1, pixel);            /* Top */
+    render_fill_rect(rt, x, y + size - 1, size, 1, pixel); /* Bottom */
+    render_fill_rect(rt, x, y, 1, size, pixel);            /* Left */
+    render_fill_rect(rt, x + size - 1, y, 1, size, pixel); /* Right */
+}
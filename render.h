@@ -0,0 +1,77 @@
+/*
+ * Split-Field Render Target
+ * Platform-free framebuffer access, colour palette and span fills
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+/* Pixel formats (values match PSP_DISPLAY_PIXEL_FORMAT_*) */
+#define RENDER_FORMAT_565  0
+#define RENDER_FORMAT_8888 3
+
+/* Per-frame counters, accumulated by the fill kernels */
+typedef struct {
+    unsigned int pixels_written;
+    unsigned int cells_drawn;
+} RenderStats;
+
+/* Framebuffer handle, fetched once per frame */
+typedef struct {
+    void* base;    /* First pixel of the buffer */
+    int stride;    /* Buffer width in pixels */
+    int format;    /* RENDER_FORMAT_* */
+    int width;     /* Clip width in pixels */
+    int height;    /* Clip height in pixels */
+    RenderStats* stats;  /* Optional, NULL to skip counting */
+} RenderTarget;
+
+/* Palette entries used by the game */
+typedef enum {
+    COLOR_BACKGROUND = 0,
+    COLOR_EMPTY,
+    COLOR_WALL,
+    COLOR_BOX,
+    COLOR_GHOST_BOX,
+    COLOR_ENEMY_TILE,
+    COLOR_GOAL,
+    COLOR_BARRIER,
+    COLOR_BORDER,
+    COLOR_BOX_P1,
+    COLOR_BOX_P2,
+    COLOR_ENEMY,
+    COLOR_ENEMY_BORDER,
+    COLOR_PLAYER1,
+    COLOR_PLAYER2,
+    COLOR_HINT,
+    COLOR_COUNT
+} ColorIndex;
+
+/* Palette converted once to the native pixel format */
+typedef struct {
+    int format;
+    unsigned int pixel[COLOR_COUNT];
+} RenderPalette;
+
+/* Convert 0xAARRGGBB to a native pixel value */
+unsigned int render_convert_color(unsigned int argb, int format);
+void render_palette_init(RenderPalette* pal, int format);
+
+/* Returns 0 on success, -1 if the buffer is unusable */
+int render_target_init(RenderTarget* rt, void* base, int stride, int format,
+                       int width, int height);
+int render_bytes_per_pixel(int format);
+
+/* Clip-then-fill; pixel is a native value from the palette */
+void render_fill_rect(const RenderTarget* rt, int x, int y, int w, int h, unsigned int pixel);
+void render_rect_outline(const RenderTarget* rt, int x, int y, int size, unsigned int pixel);
+
+/* Clip-then-copy w x h pixels; src_stride is in pixels, same format as rt */
+void render_blit(const RenderTarget* rt, int x, int y, int w, int h,
+                 const void* src, int src_stride);
+
+/* Span kernels: fill n pixels starting at dst */
+void render_fill_span32(unsigned int* dst, int n, unsigned int pixel);
+void render_fill_span16(unsigned short* dst, int n, unsigned short pixel);
+
+#endif /* RENDER_H */
@@ -0,0 +1,169 @@
+/*
+ * Split-Field GE Renderer
+ * Instead of filling pixels on the Allegrex, every rectangle of the frame
+ * is queued as a 2D sprite quad and the whole batch is drawn by the GE
+ * with a single sceGuDrawArray call from one display list per frame.
+ * Block copies go into the same list, after the quads queued before them.
+ */
+
+#include "render_gu.h"
+#include "display.h"
+
+#ifdef SF_HOST
+/* No GE on the host: init fails and callers fall back to the CPU path */
+int gu_backend_init(void) { return -1; }
+void gu_begin_frame(const RenderTarget* rt, int clear) { (void)rt; (void)clear; }
+void gu_set_scissor(int x, int y, int w, int h) { (void)x; (void)y; (void)w; (void)h; }
+void gu_fill_rect(int x, int y, int w, int h, unsigned int color) { (void)x; (void)y; (void)w; (void)h; (void)color; }
+void gu_copy_rect(const RenderTarget* src, int sx, int sy, int w, int h, int dx, int dy)
+{
+    (void)src; (void)sx; (void)sy; (void)w; (void)h; (void)dx; (void)dy;
+}
+void gu_end_frame(void) {}
+#else
+#include <pspkernel.h>
+#include <pspgu.h>
+
+/* Full redraw of the stock field is about 1,500 quads */
+#define GU_MAX_SPRITES 2048
+#define GU_LIST_SIZE (64 * 1024)
+
+/* Uncached alias, so the GE sees commands and vertices without flushes */
+#define UNCACHED(p) ((void*)(((unsigned int)(p)) | 0x40000000))
+
+/* Sprite vertex: colour then 16-bit screen position (padded to 12 bytes) */
+typedef struct {
+    unsigned int color;
+    short x, y, z;
+    short pad;
+} GuVertex;
+
+static unsigned int __attribute__((aligned(16))) gu_list[GU_LIST_SIZE / 4];
+static GuVertex __attribute__((aligned(16))) gu_vertices[GU_MAX_SPRITES * 2];
+
+static GuVertex* batch;
+static int sprite_count;
+static int batch_start;  /* First quad not yet in the list */
+static int gu_ready = 0;
+static void* draw_buffer;
+static int draw_format;
+
+/* VRAM offset of a framebuffer pointer, as sceGuDrawBufferList expects */
+static void* vram_offset(void* p)
+{
+    return (void*)(((unsigned int)p) & 0x001FFFFF);
+}
+
+static void start_list(void)
+{
+    sceGuStart(GU_DIRECT, UNCACHED(gu_list));
+    sceGuDrawBufferList(draw_format, vram_offset(draw_buffer), DISPLAY_STRIDE);
+}
+
+int gu_backend_init(void)
+{
+    if (gu_ready)
+        return 0;
+
+    sceGuInit();
+    sceGuStart(GU_DIRECT, UNCACHED(gu_list));
+    sceGuOffset(2048 - (DISPLAY_WIDTH / 2), 2048 - (DISPLAY_HEIGHT / 2));
+    sceGuViewport(2048, 2048, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    sceGuScissor(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    sceGuEnable(GU_SCISSOR_TEST);
+    sceGuDisable(GU_DEPTH_TEST);
+    sceGuDisable(GU_TEXTURE_2D);
+    sceGuDisable(GU_BLEND);
+    sceGuShadeModel(GU_FLAT);
+    sceGuFinish();
+    sceGuSync(0, 0);
+
+    batch = (GuVertex*)UNCACHED(gu_vertices);
+    gu_ready = 1;
+    return 0;
+}
+
+void gu_begin_frame(const RenderTarget* rt, int clear)
+{
+    draw_buffer = rt->base;
+    draw_format = (rt->format == RENDER_FORMAT_8888) ? GU_PSM_8888 : GU_PSM_5650;
+    sprite_count = 0;
+    batch_start = 0;
+
+    start_list();
+    sceGuScissor(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    if (clear) {
+        /* Same black the debug screen clears to */
+        sceGuClearColor(0);
+        sceGuClear(GU_COLOR_BUFFER_BIT);
+    }
+}
+
+/* Put the quads queued since the last draw into the list */
+static void draw_pending(void)
+{
+    if (sprite_count > batch_start) {
+        sceGuDrawArray(GU_SPRITES, GU_COLOR_8888 | GU_VERTEX_16BIT | GU_TRANSFORM_2D,
+                       (sprite_count - batch_start) * 2, 0, &batch[batch_start * 2]);
+    }
+    batch_start = sprite_count;
+}
+
+void gu_set_scissor(int x, int y, int w, int h)
+{
+    /* Quads queued earlier keep the old clip */
+    draw_pending();
+    sceGuScissor(x, y, x + w, y + h);
+}
+
+/* Draw everything queued so far, then wait so the batch can be reused */
+static void flush_batch(int restart)
+{
+    draw_pending();
+    sceGuFinish();
+    sceGuSync(0, 0);
+    sprite_count = 0;
+    batch_start = 0;
+
+    if (restart)
+        start_list();
+}
+
+void gu_fill_rect(int x, int y, int w, int h, unsigned int color)
+{
+    if (w <= 0 || h <= 0)
+        return;
+
+    if (sprite_count >= GU_MAX_SPRITES)
+        flush_batch(1);
+
+    GuVertex* v = &batch[sprite_count * 2];
+    v[0].color = color;
+    v[0].x = x;
+    v[0].y = y;
+    v[0].z = 0;
+    v[1].color = color;
+    v[1].x = x + w;
+    v[1].y = y + h;
+    v[1].z = 0;
+    sprite_count++;
+}
+
+void gu_copy_rect(const RenderTarget* src, int sx, int sy, int w, int h, int dx, int dy)
+{
+    if (w <= 0 || h <= 0)
+        return;
+
+    /* Quads queued earlier must land first */
+    draw_pending();
+    sceGuCopyImage(draw_format, sx, sy, w, h, src->stride, src->base,
+                   dx, dy, DISPLAY_STRIDE, draw_buffer);
+    sceGuTexSync();
+}
+
+void gu_end_frame(void)
+{
+    flush_batch(0);
+}
+#endif /* SF_HOST */
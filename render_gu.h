@@ -0,0 +1,29 @@
+/*
+ * Split-Field GE Renderer
+ * Batched sprite-quad backend built as one sceGu display list per frame
+ */
+
+#ifndef RENDER_GU_H
+#define RENDER_GU_H
+
+#include "render.h"
+
+int gu_backend_init(void);
+
+/* Start the frame's display list targeting rt; clear wipes the buffer */
+void gu_begin_frame(const RenderTarget* rt, int clear);
+
+/* Clip the rest of the frame's drawing to a screen rectangle */
+void gu_set_scissor(int x, int y, int w, int h);
+
+/* Queue a solid quad; color is 0xAABBGGRR as the GE expects */
+void gu_fill_rect(int x, int y, int w, int h, unsigned int color);
+
+/* Queue a GE copy of the w x h block at (sx, sy) in src to (dx, dy); src
+ * must share the frame's pixel format and be written back from the cache */
+void gu_copy_rect(const RenderTarget* src, int sx, int sy, int w, int h, int dx, int dy);
+
+/* Submit the batch and wait for the GE, so CPU drawing can follow */
+void gu_end_frame(void);
+
+#endif /* RENDER_GU_H */
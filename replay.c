@@ -0,0 +1,251 @@
+/*
+ * Split-Field Replay
+ * Recording, encoding and playback of input recordings
+ */
+
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned char replay_magic[4] = { 'S', 'F', 'R', 'P' };
+
+void replay_init(Replay* replay, int level)
+{
+    memset(replay, 0, sizeof(Replay));
+    replay->level = level;
+    replay->hash = SIM_HASH_SEED;
+}
+
+void replay_free(Replay* replay)
+{
+    free(replay->runs);
+    free(replay->hashes);
+    replay->runs = NULL;
+    replay->hashes = NULL;
+    replay->run_count = replay->run_capacity = 0;
+    replay->hash_count = replay->hash_capacity = 0;
+}
+
+/* Room for one more element in a growing array */
+static int reserve(void** items, int* capacity, int count, int size)
+{
+    if (count < *capacity)
+        return 0;
+
+    int grown = *capacity ? *capacity * 2 : 256;
+    void* p = realloc(*items, (size_t)grown * size);
+    if (!p)
+        return -1;
+    *items = p;
+    *capacity = grown;
+    return 0;
+}
+
+int replay_record(Replay* replay, SimInput input, const GameContext* ctx)
+{
+    ReplayRun* last = replay->run_count ? &replay->runs[replay->run_count - 1] : NULL;
+    int new_run = !last || last->input != input || last->ticks == 0xFFFF;
+    int checkpoint = (replay->ticks + 1) % REPLAY_HASH_INTERVAL == 0;
+
+    /* Make room first so a failure changes nothing */
+    if (new_run && reserve((void**)&replay->runs, &replay->run_capacity,
+                           replay->run_count, sizeof(ReplayRun)) < 0)
+        return -1;
+    if (checkpoint && reserve((void**)&replay->hashes, &replay->hash_capacity,
+                              replay->hash_count, sizeof(unsigned int)) < 0)
+        return -1;
+
+    if (new_run) {
+        last = &replay->runs[replay->run_count++];
+        last->input = input;
+        last->ticks = 0;
+    }
+    last->ticks++;
+
+    replay->ticks++;
+    replay->hash = sim_hash(ctx, replay->hash);
+    if (checkpoint)
+        replay->hashes[replay->hash_count++] = replay->hash;
+    return 0;
+}
+
+static void put_u16(unsigned char* p, unsigned int v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put_u32(unsigned char* p, unsigned int v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static unsigned int get_u16(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get_u32(const unsigned char* p)
+{
+    return get_u16(p) | (get_u16(p + 2) << 16);
+}
+
+int replay_encoded_size(const Replay* replay)
+{
+    return REPLAY_HEADER_SIZE + replay->run_count * 4 + replay->hash_count * 4;
+}
+
+void replay_encode(const Replay* replay, unsigned char* out)
+{
+    memcpy(out, replay_magic, 4);
+    put_u16(out + 4, REPLAY_VERSION);
+    put_u16(out + 6, replay->level);
+    put_u32(out + 8, replay->ticks);
+    put_u32(out + 12, replay->run_count);
+    put_u32(out + 16, REPLAY_HASH_INTERVAL);
+    put_u32(out + 20, replay->hash_count);
+    put_u32(out + 24, replay->hash);
+    put_u32(out + 28, replay->flags);
+    out += REPLAY_HEADER_SIZE;
+
+    for (int i = 0; i < replay->run_count; i++, out += 4) {
+        put_u16(out, replay->runs[i].input);
+        put_u16(out + 2, replay->runs[i].ticks);
+    }
+    for (int i = 0; i < replay->hash_count; i++, out += 4)
+        put_u32(out, replay->hashes[i]);
+}
+
+int replay_decode(Replay* replay, const unsigned char* data, int size)
+{
+    replay_init(replay, 0);
+
+    if (size < REPLAY_HEADER_SIZE || memcmp(data, replay_magic, 4) != 0 ||
+        get_u16(data + 4) != REPLAY_VERSION || get_u32(data + 16) != REPLAY_HASH_INTERVAL)
+        return -1;
+
+    unsigned int run_count = get_u32(data + 12);
+    unsigned int hash_count = get_u32(data + 20);
+    unsigned int records = (unsigned int)(size - REPLAY_HEADER_SIZE) / 4;
+    if (run_count > records || hash_count != records - run_count ||
+        (size - REPLAY_HEADER_SIZE) % 4 != 0)
+        return -1;
+
+    replay->level = get_u16(data + 6);
+    replay->hash = get_u32(data + 24);
+    replay->flags = get_u32(data + 28);
+    if (replay->flags & ~REPLAY_NO_ENEMIES)
+        return -1;
+    replay->runs = (ReplayRun*)malloc((run_count ? run_count : 1) * sizeof(ReplayRun));
+    replay->hashes = (unsigned int*)malloc((hash_count ? hash_count : 1) * sizeof(unsigned int));
+    if (!replay->runs || !replay->hashes) {
+        replay_free(replay);
+        return -1;
+    }
+    replay->run_capacity = run_count;
+    replay->hash_capacity = hash_count;
+
+    /* The tick count must agree with the runs, and the hashes with both */
+    const unsigned char* p = data + REPLAY_HEADER_SIZE;
+    unsigned int ticks = 0;
+    for (unsigned int i = 0; i < run_count; i++, p += 4) {
+        replay->runs[i].input = get_u16(p);
+        replay->runs[i].ticks = get_u16(p + 2);
+        ticks += replay->runs[i].ticks;
+    }
+    for (unsigned int i = 0; i < hash_count; i++, p += 4)
+        replay->hashes[i] = get_u32(p);
+    replay->run_count = run_count;
+    replay->hash_count = hash_count;
+    replay->ticks = ticks;
+
+    if (ticks != get_u32(data + 8) || hash_count != ticks / REPLAY_HASH_INTERVAL) {
+        replay_free(replay);
+        return -1;
+    }
+    return 0;
+}
+
+int replay_save(const Replay* replay, const char* path)
+{
+    int size = replay_encoded_size(replay);
+    unsigned char* data = (unsigned char*)malloc(size);
+    if (!data)
+        return -1;
+    replay_encode(replay, data);
+
+    FILE* f = fopen(path, "wb");
+    int ok = f && fwrite(data, 1, size, f) == (size_t)size;
+    if (f && fclose(f) != 0)
+        ok = 0;
+    free(data);
+    return ok ? 0 : -1;
+}
+
+int replay_load(Replay* replay, const char* path)
+{
+    replay_init(replay, 0);
+
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return -1;
+
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    unsigned char* data = (size > 0 && fseek(f, 0, SEEK_SET) == 0) ? (unsigned char*)malloc(size) : NULL;
+    int ok = data && fread(data, 1, size, f) == (size_t)size;
+    fclose(f);
+
+    int result = ok ? replay_decode(replay, data, (int)size) : -1;
+    free(data);
+    return result;
+}
+
+void replay_player_init(ReplayPlayer* player, const Replay* replay)
+{
+    memset(player, 0, sizeof(ReplayPlayer));
+    player->replay = replay;
+    player->hash = SIM_HASH_SEED;
+    player->diverged = -1;
+}
+
+int replay_player_step(ReplayPlayer* player, GameContext* ctx)
+{
+    const Replay* replay = player->replay;
+
+    if (player->tick >= replay->ticks)
+        return 0;
+
+    if (player->tick == 0 && (replay->flags & REPLAY_NO_ENEMIES)) {
+        ctx->sim.enemy_active = 0;
+        sim_rebuild_occupancy(ctx);
+    }
+
+    /* Runs are never empty once recorded, but a decoded file may have some */
+    while (player->used >= replay->runs[player->run].ticks) {
+        player->run++;
+        player->used = 0;
+    }
+
+    sim_step(ctx, replay->runs[player->run].input);
+    player->used++;
+    player->tick++;
+    player->hash = sim_hash(ctx, player->hash);
+
+    if (player->diverged < 0) {
+        if (player->tick % REPLAY_HASH_INTERVAL == 0 &&
+            replay->hashes[player->tick / REPLAY_HASH_INTERVAL - 1] != player->hash)
+            player->diverged = player->tick;
+        else if (player->tick == replay->ticks && replay->hash != player->hash)
+            player->diverged = player->tick;
+    }
+    return 1;
+}
+
+int replay_player_matched(const ReplayPlayer* player)
+{
+    return player->diverged < 0 && player->tick == player->replay->ticks;
+}
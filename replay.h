@@ -0,0 +1,94 @@
+/*
+ * Split-Field Replay
+ * Input recordings: the SimInput of every update, run-length encoded,
+ * with a rolling state hash every REPLAY_HASH_INTERVAL updates so a
+ * replay that drifts from the recorded game is caught near where it went
+ * wrong. Platform-free; files go through stdio, which reaches the memory
+ * stick on the PSP.
+ *
+ * File layout, all fields little-endian:
+ *   "SFRP", u16 version, u16 level, u32 ticks, u32 run count,
+ *   u32 hash interval, u32 hash count, u32 final hash, u32 flags,
+ *   runs as (u16 input, u16 ticks), then the hashes as u32
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "sim.h"
+
+/* 2: each player has its own move delay; 3: flags */
+#define REPLAY_VERSION 3
+#define REPLAY_HEADER_SIZE 32
+
+/* Flags: how the game was set up before its first update */
+#define REPLAY_NO_ENEMIES 1    /* Every enemy taken off the field */
+
+/* Updates between stored hashes: a second of play */
+#define REPLAY_HASH_INTERVAL 60
+
+/* The same input held for ticks updates, 1 to 65535 */
+typedef struct {
+    SimInput input;
+    unsigned short ticks;
+} ReplayRun;
+
+/* A recorded game from its first update to its last */
+typedef struct {
+    int level;              /* ctx->level the game started on */
+    unsigned int flags;     /* REPLAY_NO_ENEMIES or 0 */
+    unsigned int ticks;     /* Updates recorded */
+    unsigned int hash;      /* Rolling hash after the last one */
+    ReplayRun* runs;
+    int run_count;
+    int run_capacity;
+    unsigned int* hashes;   /* Rolling hash after every REPLAY_HASH_INTERVAL
+                             * updates: hashes[i] follows update (i + 1) * interval */
+    int hash_count;
+    int hash_capacity;
+} Replay;
+
+/* Playback position in a replay */
+typedef struct {
+    const Replay* replay;
+    int run;                /* Current run, and ticks of it used */
+    unsigned int used;
+    unsigned int tick;      /* Updates fed so far */
+    unsigned int hash;      /* Rolling hash of the game being fed */
+    int diverged;           /* First stored hash (by update count) the game
+                             * failed to match, or -1: it went wrong within
+                             * the REPLAY_HASH_INTERVAL updates before */
+} ReplayPlayer;
+
+/* Empty recording of a game starting on level */
+void replay_init(Replay* replay, int level);
+void replay_free(Replay* replay);
+
+/* Append one update: the input just given to sim_step and the context it
+ * left. Returns -1 if memory runs out, leaving the recording as it was. */
+int replay_record(Replay* replay, SimInput input, const GameContext* ctx);
+
+/* Bytes replay_encode writes */
+int replay_encoded_size(const Replay* replay);
+void replay_encode(const Replay* replay, unsigned char* out);
+
+/* Read an encoded replay into an empty one; returns -1 if the data is
+ * not a replay of this version, is cut short or memory runs out */
+int replay_decode(Replay* replay, const unsigned char* data, int size);
+
+/* Whole files; both return -1 on failure */
+int replay_save(const Replay* replay, const char* path);
+int replay_load(Replay* replay, const char* path);
+
+/* Feed a replay into a game already set up on its level; the replay's
+ * flags are applied to it before the first update */
+void replay_player_init(ReplayPlayer* player, const Replay* replay);
+
+/* Run sim_step on the next recorded input and check the hash where the
+ * recording has one. Returns 0, doing nothing, once the replay is over. */
+int replay_player_step(ReplayPlayer* player, GameContext* ctx);
+
+/* After the last step: 1 if the game matched the recording to the end */
+int replay_player_matched(const ReplayPlayer* player);
+
+#endif /* REPLAY_H */
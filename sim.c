@@ -0,0 +1,638 @@
+/*
+ * Split-Field Simulation
+ * The game rules, free of any platform code: levels, moves, mirror boxes,
+ * enemies and win/lose, advanced one update at a time from input bits
+ */
+
+#include "sim.h"
+#include <string.h>
+#include <stdlib.h>
+#ifdef GAME_DEBUG
+#include <assert.h>
+#endif
+
+/* Change game state; the whole screen is repainted afterwards */
+static void set_state(GameContext* ctx, GameState state)
+{
+    ctx->sim.state = state;
+    ctx->full_redraw = 1;
+}
+
+int sim_alloc_field(GameContext* ctx, int width, int height)
+{
+    memset(ctx, 0, sizeof(GameContext));
+    
+    if (width < 3 || width > FIELD_MAX_WIDTH || height < 3 || height > FIELD_MAX_HEIGHT)
+        return -1;
+    
+    /* One block: the flow fields and their queue, then the tiles with the
+     * grid straight after them */
+    int cells = width * height;
+    ctx->flow = (unsigned short*)malloc(5 * cells * sizeof(unsigned short) + cells + cells * sizeof(Occupant));
+    if (!ctx->flow)
+        return -1;
+    ctx->field = (unsigned char*)(ctx->flow + 5 * cells);
+    ctx->occupancy = (Occupant*)(ctx->field + cells);
+    memset(ctx->occupancy, 0, cells * sizeof(Occupant));
+    
+    ctx->field_width = width;
+    ctx->field_height = height;
+    ctx->sim.state = GAME_RUNNING;
+    ctx->level = 1;
+    ctx->ai_budget = AI_DEFAULT_BUDGET;
+    ctx->field_changed = 1;
+    ctx->full_redraw = 1;
+    return 0;
+}
+
+/* Allocate the level's field and lay out its border and barrier */
+int sim_init_field(GameContext* ctx, int width, int height)
+{
+    if (sim_alloc_field(ctx, width, height) < 0)
+        return -1;
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            /* Create walls around the border */
+            if (x == 0 || x == width - 1 || y == 0 || y == height - 1) {
+                FIELD_TILE(ctx, x, y) = TILE_WALL;
+            } else {
+                FIELD_TILE(ctx, x, y) = TILE_EMPTY;
+            }
+        }
+    }
+    
+    /* Add vertical barrier in the middle */
+    for (int y = 1; y < height - 1; y++) {
+        FIELD_TILE(ctx, width / 2, y) = TILE_BARRIER;
+    }
+    return 0;
+}
+
+/* Does this slot stand on the field: boxes and players always, enemies
+ * while active */
+static int entity_present(const GameContext* ctx, int slot)
+{
+    if (slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1)
+        return ENEMY_ACTIVE(ctx, slot - ENTITY_ENEMY0);
+    return 1;
+}
+
+/* Index every entity's cell and count the boxes on goals; call after
+ * placing entities directly. Later slots win a shared cell, so an enemy
+ * on a player's cell is recorded. */
+void sim_rebuild_occupancy(GameContext* ctx)
+{
+    static const int order[ENTITY_COUNT] = {
+        ENTITY_BOX0, ENTITY_BOX0 + 1, ENTITY_BOX0 + 2, ENTITY_BOX0 + 3,
+        ENTITY_PLAYER1, ENTITY_PLAYER2,
+        ENTITY_ENEMY0, ENTITY_ENEMY0 + 1, ENTITY_ENEMY0 + 2, ENTITY_ENEMY0 + 3
+    };
+    
+    memset(ctx->occupancy, 0, ctx->field_width * ctx->field_height * sizeof(Occupant));
+    
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        int slot = order[i];
+        if (entity_present(ctx, slot))
+            OCCUPANT_AT(ctx, ctx->sim.x[slot], ctx->sim.y[slot]) = OCCUPANT(slot);
+    }
+    
+    ctx->sim.boxes_in_goal = 0;
+    for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
+        if (FIELD_TILE(ctx, ctx->sim.x[ENTITY_BOX0 + i], ctx->sim.y[ENTITY_BOX0 + i]) == TILE_GOAL)
+            ctx->sim.boxes_in_goal++;
+    }
+}
+
+/* Compare the grid with a scan of every entity. Each entity's cell must
+ * name it, except a player's cell may name the enemy that caught it, and
+ * every other cell must be empty. Returns the number of bad cells, plus
+ * one if the count of boxes on goals is off. */
+int sim_check_occupancy(const GameContext* ctx)
+{
+    int bad = 0;
+    int on_goal = 0;
+    
+    for (int i = 0; i < MAX_MIRROR_BOXES; i++) {
+        if (FIELD_TILE(ctx, ctx->sim.x[ENTITY_BOX0 + i], ctx->sim.y[ENTITY_BOX0 + i]) == TILE_GOAL)
+            on_goal++;
+    }
+    if (on_goal != ctx->sim.boxes_in_goal)
+        bad++;
+    
+    for (int y = 0; y < ctx->field_height; y++) {
+        for (int x = 0; x < ctx->field_width; x++) {
+            Occupant expect = OCCUPANT_NONE;
+            
+            for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+                if (!entity_present(ctx, slot) || ctx->sim.x[slot] != x || ctx->sim.y[slot] != y)
+                    continue;
+                /* Enemies win over players, players over boxes */
+                if (!OCCUPANT_IS_ENEMY(expect))
+                    expect = OCCUPANT(slot);
+            }
+            
+            if (OCCUPANT_AT(ctx, x, y) != expect)
+                bad++;
+        }
+    }
+    return bad;
+}
+
+/* Move an entity to (x, y), in its slot and in the grid */
+static void move_entity(GameContext* ctx, int slot, int x, int y)
+{
+    OCCUPANT_AT(ctx, ctx->sim.x[slot], ctx->sim.y[slot]) = OCCUPANT_NONE;
+    OCCUPANT_AT(ctx, x, y) = OCCUPANT(slot);
+    ctx->sim.x[slot] = x;
+    ctx->sim.y[slot] = y;
+}
+
+/* Move a box, keeping the count of boxes on goals in step */
+static void move_box(GameContext* ctx, int slot, int x, int y)
+{
+    if (FIELD_TILE(ctx, ctx->sim.x[slot], ctx->sim.y[slot]) == TILE_GOAL)
+        ctx->sim.boxes_in_goal--;
+    if (FIELD_TILE(ctx, x, y) == TILE_GOAL)
+        ctx->sim.boxes_in_goal++;
+    move_entity(ctx, slot, x, y);
+}
+
+/* Check if position is valid for player movement */
+static int can_move_to(GameContext* ctx, int x, int y)
+{
+    if (x < 0 || x >= ctx->field_width || y < 0 || y >= ctx->field_height)
+        return 0;
+    
+    int tile = FIELD_TILE(ctx, x, y);
+    
+    /* Can't move into walls, barriers, or static enemies */
+    if (tile == TILE_WALL || tile == TILE_BARRIER || tile == TILE_ENEMY)
+        return 0;
+    
+    /* Moving enemies and mirror boxes block; players are checked by the caller */
+    Occupant occupant = OCCUPANT_AT(ctx, x, y);
+    return !OCCUPANT_IS_ENEMY(occupant) && !OCCUPANT_IS_BOX(occupant);
+}
+
+/* Boxes only slide onto free floor or goals */
+static int box_can_enter(GameContext* ctx, int x, int y)
+{
+    if (x < 0 || x >= ctx->field_width || y < 0 || y >= ctx->field_height)
+        return 0;
+    
+    int tile = FIELD_TILE(ctx, x, y);
+    if (tile != TILE_EMPTY && tile != TILE_GOAL)
+        return 0;
+    
+    return OCCUPANT_AT(ctx, x, y) == OCCUPANT_NONE;
+}
+
+/* Try to push a mirror box */
+static int try_push_mirror_box(GameContext* ctx, int player_num, int from_x, int from_y, int to_x, int to_y)
+{
+    /* Calculate push direction */
+    int dx = to_x - from_x;
+    int dy = to_y - from_y;
+    
+    /* Find which mirror box is at the push location */
+    Occupant occupant = OCCUPANT_AT(ctx, to_x, to_y);
+    if (!OCCUPANT_IS_BOX(occupant))
+        return 0;
+    
+    /* Check if this player can move this box */
+    int box_idx = OCCUPANT_SLOT(occupant) - ENTITY_BOX0;
+    if (ctx->box_owner[box_idx] != player_num)
+        return 0; /* Can't move opponent's box */
+    
+    /* Check destination for box */
+    int box_dest_x = to_x + dx;
+    int box_dest_y = to_y + dy;
+    
+    if (!box_can_enter(ctx, box_dest_x, box_dest_y))
+        return 0;
+    
+    /* Move the box and its mirror */
+    move_box(ctx, ENTITY_BOX0 + box_idx, box_dest_x, box_dest_y);
+    
+    /* Mirror movement: find the paired box and move it the same way */
+    /* Player 1's boxes 0,1 mirror to each other */
+    /* Player 2's boxes 2,3 mirror to each other */
+    int mirror_idx = -1;
+    if (player_num == 1) {
+        mirror_idx = (box_idx == 0) ? 1 : 0;
+    } else {
+        mirror_idx = (box_idx == 2) ? 3 : 2;
+    }
+    
+    /* Move mirror box in same direction, if its destination is free */
+    int mirror = ENTITY_BOX0 + mirror_idx;
+    int mirror_dest_x = ctx->sim.x[mirror] + dx;
+    int mirror_dest_y = ctx->sim.y[mirror] + dy;
+    
+    if (box_can_enter(ctx, mirror_dest_x, mirror_dest_y))
+        move_box(ctx, mirror, mirror_dest_x, mirror_dest_y);
+    
+    return 1;
+}
+
+/* Tiles enemies walk on */
+static int enemy_walkable(int tile)
+{
+    return tile == TILE_EMPTY || tile == TILE_GOAL;
+}
+
+/* Back-field cells emptied for one cell of AI budget: a store each,
+ * against an expansion's four neighbour checks */
+#define FLOW_CLEAR_CELLS 16
+
+/* Queue a cell the search has not reached yet, if enemies can walk it */
+static int flow_visit(unsigned short* dist, const unsigned char* field, unsigned short* queue,
+                      int tail, int cell, int code, int next_dist)
+{
+    if (dist[cell] == FLOW_UNREACHED && enemy_walkable(field[cell])) {
+        dist[cell] = next_dist;
+        queue[tail++] = code;
+    }
+    return tail;
+}
+
+/* Start a breadth-first search from a player into its back field. Boxes
+ * and other enemies are left out: they move, and an enemy steps around
+ * them when it picks its next cell. Queue entries pack a cell as
+ * y << 8 | x (fields are at most 256 on a side), so no division finds
+ * the column; the first entry is the player's cell. The back field is
+ * emptied as the search runs, under the budget, not here. */
+static void flow_search_start(GameContext* ctx, int player_num)
+{
+    unsigned short* queue = ctx->flow + 4 * ctx->field_width * ctx->field_height;
+    int player = ENTITY_PLAYER(player_num);
+    int x = ctx->sim.x[player];
+    int y = ctx->sim.y[player];
+    
+    queue[0] = y << 8 | x;
+    
+    ctx->flow_search = player_num;
+    ctx->flow_cleared = 0;
+    ctx->flow_last = player_num;
+    ctx->flow_head = 0;
+    ctx->flow_tail = 1;
+    ctx->flow_stale &= ~(1 << (player_num - 1));
+}
+
+/* Spend up to budget on the search in progress (any amount for
+ * AI_BUDGET_UNLIMITED): emptying the back field, FLOW_CLEAR_CELLS cells
+ * for each unit, then a unit per cell expanded. A finished field becomes
+ * the front one. Returns the budget spent. */
+static int flow_search_run(GameContext* ctx, int budget)
+{
+    int num = ctx->flow_search;
+    int width = ctx->field_width;
+    int height = ctx->field_height;
+    const unsigned char* field = ctx->field;
+    int back = !((ctx->flow_front >> (num - 1)) & 1);
+    unsigned short* dist = FLOW_FIELD(ctx, num, back);
+    unsigned short* queue = ctx->flow + 4 * width * height;
+    int cells = width * height;
+    int spent = 0;
+    
+    if (ctx->flow_cleared < cells) {
+        int count = cells - ctx->flow_cleared;
+        if (budget != AI_BUDGET_UNLIMITED && count > budget * FLOW_CLEAR_CELLS)
+            count = budget * FLOW_CLEAR_CELLS;
+        memset(dist + ctx->flow_cleared, 0xFF, count * sizeof(unsigned short));
+        ctx->flow_cleared += count;
+        spent = (count + FLOW_CLEAR_CELLS - 1) / FLOW_CLEAR_CELLS;
+        ctx->ai_stats.budget_spent += spent;
+        if (ctx->flow_cleared < cells)
+            return spent;
+        
+        dist[(queue[0] >> 8) * width + (queue[0] & 0xFF)] = 0;
+        if (budget != AI_BUDGET_UNLIMITED) {
+            budget -= spent;
+            if (budget <= 0)
+                return spent;
+        }
+    }
+    
+    int head = ctx->flow_head;
+    int tail = ctx->flow_tail;
+    int end = (budget == AI_BUDGET_UNLIMITED) ? cells : head + budget;
+    
+    while (head < tail && head < end) {
+        int code = queue[head++];
+        int x = code & 0xFF;
+        int y = code >> 8;
+        int cell = y * width + x;
+        int next_dist = dist[cell] + 1;
+        
+        if (x > 0)
+            tail = flow_visit(dist, field, queue, tail, cell - 1, code - 1, next_dist);
+        if (x < width - 1)
+            tail = flow_visit(dist, field, queue, tail, cell + 1, code + 1, next_dist);
+        if (y > 0)
+            tail = flow_visit(dist, field, queue, tail, cell - width, code - 256, next_dist);
+        if (y < height - 1)
+            tail = flow_visit(dist, field, queue, tail, cell + width, code + 256, next_dist);
+    }
+    
+    int expanded = head - ctx->flow_head;
+    ctx->flow_head = head;
+    ctx->flow_tail = tail;
+    ctx->ai_stats.cells_searched += expanded;
+    ctx->ai_stats.budget_spent += expanded;
+    
+    if (head == tail) {
+        int bit = 1 << (num - 1);
+        ctx->flow_front ^= bit;
+        ctx->flow_ready |= bit;
+        ctx->flow_from_x[num - 1] = queue[0] & 0xFF;
+        ctx->flow_from_y[num - 1] = queue[0] >> 8;
+        ctx->flow_search = 0;
+        ctx->ai_stats.searches_done++;
+    }
+    return spent + expanded;
+}
+
+int sim_build_flow(GameContext* ctx, int player_num)
+{
+    /* The queue is shared, so a search in progress is finished first */
+    if (ctx->flow_search && ctx->flow_search != player_num)
+        flow_search_run(ctx, AI_BUDGET_UNLIMITED);
+    if (!ctx->flow_search)
+        flow_search_start(ctx, player_num);
+    flow_search_run(ctx, AI_BUDGET_UNLIMITED);
+    return ctx->flow_tail;
+}
+
+void sim_set_ai_budget(GameContext* ctx, int cells)
+{
+    ctx->ai_budget = cells;
+}
+
+/* Does a player need a new search: never searched, marked stale, or moved
+ * since its front field was built. Players no active enemy chases don't. */
+static int flow_wanted(const GameContext* ctx, int player_num)
+{
+    int player = ENTITY_PLAYER(player_num);
+    int bit = 1 << (player_num - 1);
+    int chased = 0;
+    
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        if (ENEMY_ACTIVE(ctx, i) && ctx->enemy_target[i] == player_num)
+            chased = 1;
+    }
+    if (!chased)
+        return 0;
+    
+    return !(ctx->flow_ready & bit) || (ctx->flow_stale & bit) ||
+           ctx->flow_from_x[player_num - 1] != ctx->sim.x[player] ||
+           ctx->flow_from_y[player_num - 1] != ctx->sim.y[player];
+}
+
+void sim_start_flow(GameContext* ctx)
+{
+    for (int num = 1; num <= 2; num++) {
+        if (flow_wanted(ctx, num))
+            sim_build_flow(ctx, num);
+    }
+}
+
+/* Spend this update's budget on flow searches. A search runs to the end
+ * before the next starts, even if its player moves meanwhile, so a player
+ * on the move still gets fresh fields; the players take turns. A first
+ * field is searched under the budget too, if the loader did not build it. */
+static void schedule_flow(GameContext* ctx)
+{
+    int budget = ctx->ai_budget;
+    
+    for (;;) {
+        if (!ctx->flow_search) {
+            int first = (ctx->flow_last == 1) ? 2 : 1;
+            int num = flow_wanted(ctx, first) ? first : (flow_wanted(ctx, 3 - first) ? 3 - first : 0);
+            if (!num)
+                return;
+            flow_search_start(ctx, num);
+        }
+        
+        int used = flow_search_run(ctx, budget);
+        if (budget != AI_BUDGET_UNLIMITED) {
+            budget -= used;
+            if (budget <= 0)
+                return;
+        }
+    }
+}
+
+/* Enemies walk onto floor and goals not held by another enemy or a box;
+ * stepping onto a player catches it */
+static int enemy_can_enter(GameContext* ctx, int x, int y)
+{
+    if (!enemy_walkable(FIELD_TILE(ctx, x, y)))
+        return 0;
+    
+    Occupant occupant = OCCUPANT_AT(ctx, x, y);
+    return !OCCUPANT_IS_ENEMY(occupant) && !OCCUPANT_IS_BOX(occupant);
+}
+
+/* One step down the target's front flow field: to the free neighbour
+ * closest to the player, sideways first on a tie */
+static void step_enemy(GameContext* ctx, int i)
+{
+    static const int step_x[4] = { -1, 1, 0, 0 };
+    static const int step_y[4] = { 0, 0, -1, 1 };
+    
+    int enemy = ENTITY_ENEMY0 + i;
+    int target_num = ctx->enemy_target[i];
+    int x = ctx->sim.x[enemy];
+    int y = ctx->sim.y[enemy];
+    int best = FLOW_DIST(ctx, target_num, x, y);
+    int best_x = -1, best_y = -1;
+    
+    for (int d = 0; d < 4; d++) {
+        int new_x = x + step_x[d];
+        int new_y = y + step_y[d];
+        
+        if (new_x < 0 || new_x >= ctx->field_width || new_y < 0 || new_y >= ctx->field_height)
+            continue;
+        
+        int dist = FLOW_DIST(ctx, target_num, new_x, new_y);
+        if (dist < best && enemy_can_enter(ctx, new_x, new_y)) {
+            best = dist;
+            best_x = new_x;
+            best_y = new_y;
+        }
+    }
+    
+    if (best_x >= 0) {
+        move_entity(ctx, enemy, best_x, best_y);
+        ctx->ai_stats.enemies_moved++;
+    }
+}
+
+/* Advance the flow searches, then step the enemies whose phase this is.
+ * Each still steps once per ENEMY_MOVE_PERIOD updates (slow movement). */
+static void update_enemies(GameContext* ctx)
+{
+    ctx->sim.enemy_move_counter++;
+    if (ctx->sim.enemy_move_counter >= ENEMY_MOVE_PERIOD)
+        ctx->sim.enemy_move_counter = 0;
+    
+    schedule_flow(ctx);
+    
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        if (!ENEMY_ACTIVE(ctx, i) || ctx->sim.enemy_move_counter != ENEMY_PHASE(i))
+            continue;
+        
+        if (ctx->flow_ready & (1 << (ctx->enemy_target[i] - 1)))
+            step_enemy(ctx, i);
+        else
+            ctx->ai_stats.enemies_waiting++;
+    }
+}
+
+/* Move a player one step, pushing a mirror box if one is in the way */
+static void move_player(GameContext* ctx, int player_num, int dx, int dy)
+{
+    int player = ENTITY_PLAYER(player_num);
+    int new_x = ctx->sim.x[player] + dx;
+    int new_y = ctx->sim.y[player] + dy;
+    
+    if (new_x < 0 || new_x >= ctx->field_width || new_y < 0 || new_y >= ctx->field_height)
+        return;
+    
+    Occupant occupant = OCCUPANT_AT(ctx, new_x, new_y);
+    
+    /* Check if moving into moving enemy - instant death */
+    if (OCCUPANT_IS_ENEMY(occupant)) {
+        set_state(ctx, GAME_LOSE);
+        return;
+    }
+    
+    /* Check for mirror box push */
+    if (OCCUPANT_IS_BOX(occupant)) {
+        if (try_push_mirror_box(ctx, player_num, ctx->sim.x[player], ctx->sim.y[player], new_x, new_y)) {
+            move_entity(ctx, player, new_x, new_y);
+            ctx->sim.move_delay[player_num - 1] = PLAYER_MOVE_DELAY;
+        }
+        return;
+    }
+    
+    /* The other player blocks the way */
+    if (can_move_to(ctx, new_x, new_y) && !OCCUPANT_IS_PLAYER(occupant)) {
+        move_entity(ctx, player, new_x, new_y);
+        ctx->sim.move_delay[player_num - 1] = PLAYER_MOVE_DELAY;
+    }
+}
+
+/* An enemy standing on a player's cell has caught it */
+static int player_caught(const GameContext* ctx, int player)
+{
+    return OCCUPANT_IS_ENEMY(OCCUPANT_AT(ctx, ctx->sim.x[player], ctx->sim.y[player]));
+}
+
+/* Advance the rules by one update */
+void sim_step(GameContext* ctx, SimInput input)
+{
+    memset(&ctx->ai_stats, 0, sizeof(ctx->ai_stats));
+    
+    if (ctx->sim.state != GAME_RUNNING)
+        return;
+    
+    /* Moves happen on presses, not holds */
+    SimInput pressed = input & ~ctx->sim.held;
+    ctx->sim.held = input;
+    
+    /* Each player waits out its own delay after a move; its presses
+     * meanwhile are ignored, and the other player and the enemies go on */
+    SimInput waiting = 0;
+    if (ctx->sim.move_delay[0] > 0) {
+        ctx->sim.move_delay[0]--;
+        waiting |= INPUT_P1_MOVES;
+    }
+    if (ctx->sim.move_delay[1] > 0) {
+        ctx->sim.move_delay[1]--;
+        waiting |= INPUT_P2_MOVES;
+    }
+    pressed &= ~waiting;
+    
+    int p1_dx = 0, p1_dy = 0;
+    int p2_dx = 0, p2_dy = 0;
+    
+    if (pressed & INPUT_P1_UP)
+        p1_dy = -1;
+    if (pressed & INPUT_P1_DOWN)
+        p1_dy = 1;
+    if (pressed & INPUT_P1_LEFT)
+        p1_dx = -1;
+    if (pressed & INPUT_P1_RIGHT)
+        p1_dx = 1;
+    
+    if (pressed & INPUT_P2_UP)
+        p2_dy = -1;
+    if (pressed & INPUT_P2_DOWN)
+        p2_dy = 1;
+    if (pressed & INPUT_P2_LEFT)
+        p2_dx = -1;
+    if (pressed & INPUT_P2_RIGHT)
+        p2_dx = 1;
+    
+    /* Move Player 1 */
+    if (p1_dx != 0 || p1_dy != 0) {
+        move_player(ctx, 1, p1_dx, p1_dy);
+        if (ctx->sim.state != GAME_RUNNING)
+            return;
+    }
+    
+    /* Move Player 2 */
+    if (p2_dx != 0 || p2_dy != 0) {
+        move_player(ctx, 2, p2_dx, p2_dy);
+        if (ctx->sim.state != GAME_RUNNING)
+            return;
+    }
+    
+    /* Only pushes change the count, so the level ends on the push that
+     * places the last box */
+    if (ctx->total_boxes > 0 && ctx->sim.boxes_in_goal >= ctx->total_boxes) {
+        set_state(ctx, GAME_WIN);
+        return;
+    }
+    
+    /* Update enemy positions */
+    update_enemies(ctx);
+    
+    /* Check if player collides with enemy after enemy movement */
+    if (player_caught(ctx, ENTITY_PLAYER1) || player_caught(ctx, ENTITY_PLAYER2)) {
+        set_state(ctx, GAME_LOSE);
+        return;
+    }
+    
+    if (pressed & INPUT_QUIT)
+        set_state(ctx, GAME_QUIT);
+    
+#ifdef GAME_DEBUG
+    assert(sim_check_occupancy(ctx) == 0);
+#endif
+}
+
+/* The state block has no padding, so equal games hash equal */
+unsigned int sim_hash(const GameContext* ctx, unsigned int hash)
+{
+    const unsigned char* bytes = (const unsigned char*)&ctx->sim;
+    
+    for (int i = 0; i < (int)sizeof(SimState); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Free what the level owns: the field, its occupancy grid and flow
+ * fields, all in the block flow points to */
+void sim_cleanup(GameContext* ctx)
+{
+    free(ctx->flow);
+    ctx->field = NULL;
+    ctx->occupancy = NULL;
+    ctx->flow = NULL;
+}
@@ -0,0 +1,216 @@
+/*
+ * Split-Field Simulation
+ * Platform-free game rules: everything a game in progress is, and one
+ * update of it from abstract input bits. Builds with any C99 compiler.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+/* Field size in tiles: the stock level, and the largest a level may be */
+#define DEFAULT_FIELD_WIDTH 20
+#define DEFAULT_FIELD_HEIGHT 14
+#define FIELD_MAX_WIDTH 256
+#define FIELD_MAX_HEIGHT 256
+
+/* Game states */
+typedef enum {
+    GAME_RUNNING,
+    GAME_WIN,
+    GAME_LOSE,
+    GAME_QUIT
+} GameState;
+
+/* Entity types */
+typedef enum {
+    TILE_EMPTY = 0,
+    TILE_WALL,
+    TILE_BOX,
+    TILE_GHOST_BOX,  /* Box that only one player can move */
+    TILE_ENEMY,
+    TILE_GOAL,
+    TILE_BARRIER     /* Vertical barrier in middle */
+} TileType;
+
+#define MAX_ENEMIES 4
+#define MAX_MIRROR_BOXES 4
+
+/* Entity slots: boxes, then enemies, then the players, the order their
+ * sprites are drawn in */
+#define ENTITY_BOX0 0
+#define ENTITY_ENEMY0 (ENTITY_BOX0 + MAX_MIRROR_BOXES)
+#define ENTITY_PLAYER1 (ENTITY_ENEMY0 + MAX_ENEMIES)
+#define ENTITY_PLAYER2 (ENTITY_PLAYER1 + 1)
+#define ENTITY_COUNT (ENTITY_PLAYER2 + 1)
+
+/* Slot of player 1 or 2 */
+#define ENTITY_PLAYER(num) (ENTITY_PLAYER1 + (num) - 1)
+
+/* What stands on a cell: the entity's slot + 1, or 0 for nobody */
+typedef unsigned char Occupant;
+
+#define OCCUPANT_NONE 0
+#define OCCUPANT(slot) ((Occupant)((slot) + 1))
+#define OCCUPANT_SLOT(o) ((o) - 1)
+#define OCCUPANT_IS_BOX(o) ((o) >= OCCUPANT(ENTITY_BOX0) && (o) < OCCUPANT(ENTITY_ENEMY0))
+#define OCCUPANT_IS_ENEMY(o) ((o) >= OCCUPANT(ENTITY_ENEMY0) && (o) < OCCUPANT(ENTITY_PLAYER1))
+#define OCCUPANT_IS_PLAYER(o) ((o) >= OCCUPANT(ENTITY_PLAYER1))
+
+/* Everything sim_step changes, as one flat block with no pointers or
+ * padding (28 bytes): copying, hashing or snapshotting a game in progress
+ * touches a single cache line */
+typedef struct {
+    unsigned char x[ENTITY_COUNT];     /* Entity cells, by slot; a field is */
+    unsigned char y[ENTITY_COUNT];     /* at most 256 tiles on a side */
+    unsigned char enemy_active;        /* Bit i set: enemy i is on the field */
+    unsigned char state;               /* GameState */
+    unsigned char enemy_move_counter;  /* For slow enemy movement */
+    unsigned char boxes_in_goal;       /* Changed only by box moves */
+    unsigned char move_delay[2];       /* Updates until player 1 or 2 may move again */
+    unsigned short held;               /* SimInput held on the last update */
+} SimState;
+
+/* Enemies step once every ENEMY_MOVE_PERIOD updates, each on its own
+ * phase of the period so their work is spread over the frames */
+#define ENEMY_MOVE_PERIOD 15
+#define ENEMY_PHASE(i) ((i) * ENEMY_MOVE_PERIOD / MAX_ENEMIES)
+
+/* Flow-field cells the AI may search per update; AI_BUDGET_UNLIMITED
+ * finishes every search on the update it starts */
+#define AI_DEFAULT_BUDGET 2048
+#define AI_BUDGET_UNLIMITED 0
+
+/* AI work done by the last sim_step */
+typedef struct {
+    int cells_searched;   /* Flow-field cells expanded */
+    int budget_spent;     /* AI budget used, emptying back fields included */
+    int searches_done;    /* Flow fields finished and swapped in */
+    int enemies_moved;
+    int enemies_waiting;  /* Due to step before their first flow field was ready */
+} AiStats;
+
+/* Game context. The hot part (sim and the per-level entity attributes)
+ * comes first, in the first 32 bytes. */
+typedef struct {
+    SimState sim;
+    unsigned char box_owner[MAX_MIRROR_BOXES];  /* 1 or 2 - which player controls it */
+    unsigned char enemy_target[MAX_ENEMIES];    /* 1 or 2 */
+    unsigned char total_boxes;
+    unsigned char field_changed;  /* Set on level load: static layer is re-baked */
+    unsigned char full_redraw;    /* Set on level load and state change: the
+                                   * front end repaints everything */
+    unsigned char flow_stale;     /* Bit per player: search again even if it has
+                                   * not moved; set this after editing tiles */
+    unsigned char flow_ready;     /* Bit per player: its front flow field is done */
+    unsigned char flow_front;     /* Bit per player: which of its two fields is front */
+    unsigned char flow_search;    /* Player being searched for, 0 when idle */
+    unsigned char flow_last;      /* Player searched for last, to take turns */
+    unsigned char flow_from_x[2]; /* Player cell each front field was built from */
+    unsigned char flow_from_y[2];
+    int flow_head;           /* Search queue of the search in progress */
+    int flow_tail;
+    int flow_cleared;        /* Back-field cells it has emptied so far */
+    int ai_budget;           /* Cells per update, or AI_BUDGET_UNLIMITED */
+    int level;
+    int field_width;
+    int field_height;
+    unsigned char* field;    /* TileType per cell, row-major */
+    Occupant* occupancy;     /* Same layout, kept in step with every move;
+                              * it follows the last tile in memory */
+    unsigned short* flow;    /* Enemy steps to each player by cell: a front and
+                              * a back field per player, then the search queue.
+                              * The level's one allocation, field and occupancy
+                              * included */
+    const unsigned short* box_dist;  /* Box steps from each cell to the nearest
+                              * goal, if compiled with the level; else NULL */
+    AiStats ai_stats;
+} GameContext;
+
+/* Tile and occupant at (x, y); the caller checks the bounds */
+#define FIELD_TILE(ctx, x, y) ((ctx)->field[(y) * (ctx)->field_width + (x)])
+#define OCCUPANT_AT(ctx, x, y) ((ctx)->occupancy[(y) * (ctx)->field_width + (x)])
+
+/* One of player 1 or 2's flow fields, buffer 0 or 1 */
+#define FLOW_FIELD(ctx, num, buf) \
+    ((ctx)->flow + (((num) - 1) * 2 + (buf)) * (ctx)->field_width * (ctx)->field_height)
+
+/* Steps from (x, y) to player 1 or 2 for an enemy, FLOW_UNREACHED if
+ * walls cut it off; read from the front field, valid once its flow_ready
+ * bit is set */
+#define FLOW_UNREACHED 0xFFFF
+#define FLOW_DIST(ctx, num, x, y) \
+    (FLOW_FIELD(ctx, num, ((ctx)->flow_front >> ((num) - 1)) & 1)[(y) * (ctx)->field_width + (x)])
+
+/* Is enemy i on the field */
+#define ENEMY_ACTIVE(ctx, i) (((ctx)->sim.enemy_active >> (i)) & 1)
+
+/* One update's input: the buttons held, as bits. Moves and quitting
+ * happen on the update a bit is first set. */
+typedef unsigned short SimInput;
+
+enum {
+    INPUT_P1_UP    = 1 << 0,
+    INPUT_P1_DOWN  = 1 << 1,
+    INPUT_P1_LEFT  = 1 << 2,
+    INPUT_P1_RIGHT = 1 << 3,
+    INPUT_P2_UP    = 1 << 4,
+    INPUT_P2_DOWN  = 1 << 5,
+    INPUT_P2_LEFT  = 1 << 6,
+    INPUT_P2_RIGHT = 1 << 7,
+    INPUT_QUIT     = 1 << 8,
+    
+    /* All of player 1 or 2's directions */
+    INPUT_P1_MOVES = INPUT_P1_UP | INPUT_P1_DOWN | INPUT_P1_LEFT | INPUT_P1_RIGHT,
+    INPUT_P2_MOVES = INPUT_P2_UP | INPUT_P2_DOWN | INPUT_P2_LEFT | INPUT_P2_RIGHT
+};
+
+/* Updates a player waits after moving before its next press counts; the
+ * other player's presses count meanwhile */
+#define PLAYER_MOVE_DELAY 5
+
+/* Level of width x height tiles and no entities, its tiles left unset
+ * for a loader that fills every one, in a single allocation. Returns -1
+ * if the size is out of range or memory runs out. */
+int sim_alloc_field(GameContext* ctx, int width, int height);
+
+/* Empty level of width x height tiles: border walls, middle barrier and
+ * no entities. Returns -1 if the size is out of range or memory runs out */
+int sim_init_field(GameContext* ctx, int width, int height);
+
+/* Index every entity's cell and count the boxes already on goals; call
+ * after placing entities directly */
+void sim_rebuild_occupancy(GameContext* ctx);
+
+/* Cells where the grid disagrees with a scan of every entity, plus one if
+ * the count of boxes on goals does; builds with GAME_DEBUG check this
+ * after each update */
+int sim_check_occupancy(const GameContext* ctx);
+
+/* Breadth-first search from player 1 or 2 over the tiles enemies walk on,
+ * run to the end now and swapped in as its front field. sim_step does the
+ * same work in budgeted slices when the player has moved. Returns the
+ * number of cells reached. */
+int sim_build_flow(GameContext* ctx, int player_num);
+
+/* Build every chased player's first flow field whole. Level loaders call
+ * this once the entities are placed, so it runs at load time and not in
+ * the first updates; an enemy whose player has no field yet waits for
+ * the budgeted search. */
+void sim_start_flow(GameContext* ctx);
+
+/* Cells of flow search each later sim_step may do */
+void sim_set_ai_budget(GameContext* ctx, int cells);
+
+/* Advance the game by one update */
+void sim_step(GameContext* ctx, SimInput input);
+
+/* Fold the state block into hash (FNV-1a) and return the result. Chained
+ * from SIM_HASH_SEED once per update, it sums up the whole game so far:
+ * two runs that ever differ keep different hashes from then on. */
+#define SIM_HASH_SEED 2166136261u
+unsigned int sim_hash(const GameContext* ctx, unsigned int hash);
+
+/* Free the level's field and the grids built over it */
+void sim_cleanup(GameContext* ctx);
+
+#endif /* SIM_H */
@@ -0,0 +1,665 @@
+/*
+ * Split-Field Solver
+ * A* over players and boxes, with the moves worked out exactly as
+ * move_player and try_push_mirror_box make them
+ */
+
+#include "solver.h"
+#include <string.h>
+
+#define SOLVER_FAR 0xFFFF
+
+static const int solver_dx[4] = { 0, 0, -1, 1 };
+static const int solver_dy[4] = { -1, 1, 0, 0 };
+
+/* Regions of the block, each rounded up to 8 bytes */
+#define SOLVER_ALIGN(n) (((n) + 7) & ~7)
+
+int solver_fixed_size(int width, int height)
+{
+    int cells = width * height;
+
+    return SOLVER_ALIGN(cells * 2) +                       /* box_dist */
+           SOLVER_ALIGN(SOLVER_ENTITIES * cells * 4) +     /* zobrist */
+           SOLVER_ALIGN(cells * 3);                        /* set-up scratch */
+}
+
+/* solver_prepare gives the table a fifth of the rest, rounded down to a
+ * power of two slots, and fills it at most 3/4 full: slots * 8 bytes
+ * need 40 per slot */
+int solver_block_size(int width, int height, int states)
+{
+    int slots = 16;
+
+    while (slots / 4 * 3 < states)
+        slots *= 2;
+    return solver_fixed_size(width, height) + 5 * slots * (int)sizeof(SolverSlot);
+}
+
+void solver_board(SolverBoard* board, const GameContext* ctx)
+{
+    board->field = ctx->field;
+    board->width = ctx->field_width;
+    board->height = ctx->field_height;
+    memcpy(board->box_owner, ctx->box_owner, sizeof(board->box_owner));
+}
+
+int solver_box_enterable(int tile)
+{
+    return tile == TILE_EMPTY || tile == TILE_GOAL;
+}
+
+int solver_player_enterable(int tile)
+{
+    return tile != TILE_WALL && tile != TILE_BARRIER && tile != TILE_ENEMY;
+}
+
+/* Breadth-first distance from every goal over tiles a box can slide on.
+ * Any box can slide when it is a mirror, so this is a lower bound on its
+ * moves whoever pushes it. queue holds cells entries. */
+static void build_box_dist(Solver* solver, unsigned short* dist, unsigned short* queue)
+{
+    int cells = solver->board.width * solver->board.height;
+    int head = 0, tail = 0;
+
+    for (int c = 0; c < cells; c++) {
+        dist[c] = SOLVER_FAR;
+        if (solver->board.field[c] == TILE_GOAL) {
+            dist[c] = 0;
+            queue[tail++] = c;
+        }
+    }
+
+    while (head < tail) {
+        int c = queue[head++];
+        int x = c % solver->board.width, y = c / solver->board.width;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + solver_dx[d], ny = y + solver_dy[d];
+            if (nx < 0 || nx >= solver->board.width || ny < 0 || ny >= solver->board.height)
+                continue;
+            int n = ny * solver->board.width + nx;
+            if (dist[n] == SOLVER_FAR && solver_box_enterable(solver->board.field[n])) {
+                dist[n] = dist[c] + 1;
+                queue[tail++] = n;
+            }
+        }
+    }
+}
+
+/* Label the cells reachable from start on foot with label */
+static void flood_region(const Solver* solver, unsigned char* region, unsigned short* queue,
+                         int start, int label)
+{
+    int head = 0, tail = 0;
+
+    region[start] = label;
+    queue[tail++] = start;
+    while (head < tail) {
+        int c = queue[head++];
+        int x = c % solver->board.width, y = c / solver->board.width;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + solver_dx[d], ny = y + solver_dy[d];
+            if (nx < 0 || nx >= solver->board.width || ny < 0 || ny >= solver->board.height)
+                continue;
+            int n = ny * solver->board.width + nx;
+            if (!region[n] && solver_player_enterable(solver->board.field[n])) {
+                region[n] = label;
+                queue[tail++] = n;
+            }
+        }
+    }
+}
+
+int solver_mirror_of(int player, int box)
+{
+    if (player == 1)
+        return (box == 0) ? 1 : 0;
+    return (box == 2) ? 3 : 2;
+}
+
+/* Boxes player may move: its own, and what they drag along */
+static int boxes_moved_by(const Solver* solver, int player)
+{
+    int mask = 0;
+
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        if (solver->board.box_owner[b] == player)
+            mask |= (1 << b) | (1 << solver_mirror_of(player, b));
+    }
+    return mask;
+}
+
+/* The two sides can be searched in turn when every level needs all four
+ * boxes, the players stand in regions walls keep apart, and each moves
+ * only boxes in its own region */
+static int find_split(const Solver* solver, const SolverState* start,
+                      unsigned char* region, unsigned short* queue)
+{
+    int moved1 = boxes_moved_by(solver, 1);
+    int moved2 = boxes_moved_by(solver, 2);
+
+    if (solver->total_boxes != MAX_MIRROR_BOXES || (moved1 & moved2))
+        return 0;
+
+    memset(region, 0, solver->board.width * solver->board.height);
+    flood_region(solver, region, queue, start->cell[SOLVER_PLAYER1], 1);
+    if (region[start->cell[SOLVER_PLAYER2]])
+        return 0;
+    flood_region(solver, region, queue, start->cell[SOLVER_PLAYER2], 2);
+
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        int side = (moved1 >> b) & 1 ? 1 : (moved2 >> b) & 1 ? 2 : 0;
+        if (side && region[start->cell[SOLVER_BOX0 + b]] != side)
+            return 0;
+    }
+    return moved1;
+}
+
+/* A player's two boxes are interchangeable when it owns exactly those two
+ * and each drags the other */
+static void find_swap_pairs(Solver* solver)
+{
+    for (int player = 1; player <= 2; player++) {
+        int first = (player - 1) * 2;
+        int owned = 0;
+        for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+            if (solver->board.box_owner[b] == player)
+                owned |= 1 << b;
+        }
+        if (owned == (3 << first))
+            solver->swap_pairs |= 1 << (player - 1);
+    }
+}
+
+static void canonicalize(const Solver* solver, SolverState* s)
+{
+    for (int player = 1; player <= 2; player++) {
+        if (!(solver->swap_pairs & (1 << (player - 1))))
+            continue;
+        int a = SOLVER_BOX0 + (player - 1) * 2;
+        if (s->cell[a] > s->cell[a + 1]) {
+            unsigned short t = s->cell[a];
+            s->cell[a] = s->cell[a + 1];
+            s->cell[a + 1] = t;
+        }
+    }
+}
+
+static unsigned int state_hash(const Solver* solver, const SolverState* s)
+{
+    int cells = solver->board.width * solver->board.height;
+    unsigned int hash = 0;
+
+    for (int e = 0; e < SOLVER_ENTITIES; e++)
+        hash ^= solver->zobrist[solver->zobrist_table[e] * cells + s->cell[e]];
+    return hash;
+}
+
+/* Steps player must walk before its next push: to beside its nearest box */
+static int walk_to_box(const Solver* solver, const SolverState* s, int player)
+{
+    int cell = s->cell[SOLVER_PLAYER1 + player - 1];
+    int x = cell % solver->board.width, y = cell / solver->board.width;
+    int best = SOLVER_FAR;
+
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        if (solver->board.box_owner[b] != player)
+            continue;
+        int box = s->cell[SOLVER_BOX0 + b];
+        int dx = box % solver->board.width - x, dy = box / solver->board.width - y;
+        int d = (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy) - 1;
+        if (d < best)
+            best = d;
+    }
+    return best;
+}
+
+/* Least player steps left: each step moves at most the two boxes of one
+ * pair, each by one cell, and only a push moves any, so while boxes are
+ * off their goals a player must first walk up to one of its own.
+ * SOLVER_FAR if too few boxes can reach a goal. */
+static int heuristic(const Solver* solver, const SolverState* s)
+{
+    int dist[MAX_MIRROR_BOXES];
+    int reachable = 0;
+
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        dist[b] = solver->box_dist[s->cell[SOLVER_BOX0 + b]];
+        if (dist[b] != SOLVER_FAR)
+            reachable++;
+    }
+    if (reachable < solver->total_boxes)
+        return SOLVER_FAR;
+
+    /* Every box is needed and each player moves its own: count apart */
+    if (solver->split_boxes) {
+        int sum[2] = { 0, 0 };
+        int h = 0;
+        for (int b = 0; b < MAX_MIRROR_BOXES; b++)
+            sum[!((solver->split_boxes >> b) & 1)] += dist[b];
+        for (int player = 1; player <= 2; player++) {
+            if (sum[player - 1])
+                h += walk_to_box(solver, s, player) + (sum[player - 1] + 1) / 2;
+        }
+        return h;
+    }
+
+    /* Otherwise the nearest total_boxes of them, in any pairs */
+    for (int i = 1; i < MAX_MIRROR_BOXES; i++) {
+        for (int j = i; j > 0 && dist[j] < dist[j - 1]; j--) {
+            int t = dist[j];
+            dist[j] = dist[j - 1];
+            dist[j - 1] = t;
+        }
+    }
+    int sum = 0;
+    for (int b = 0; b < solver->total_boxes; b++)
+        sum += dist[b];
+    if (sum == 0)
+        return 0;
+
+    int walk = walk_to_box(solver, s, 1);
+    int walk2 = walk_to_box(solver, s, 2);
+    return (walk < walk2 ? walk : walk2) + (sum + 1) / 2;
+}
+
+static int count_bits(int mask)
+{
+    int count = 0;
+
+    for (; mask; mask &= mask - 1)
+        count++;
+    return count;
+}
+
+static int boxes_on_goals(const Solver* solver, const SolverState* s, int mask)
+{
+    int count = 0;
+
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        if ((mask >> b) & 1 && solver->board.field[s->cell[SOLVER_BOX0 + b]] == TILE_GOAL)
+            count++;
+    }
+    return count;
+}
+
+/* Box standing on cell, or -1 */
+static int box_at(const SolverState* s, int cell)
+{
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        if (s->cell[SOLVER_BOX0 + b] == cell)
+            return b;
+    }
+    return -1;
+}
+
+static int occupied(const SolverState* s, int cell)
+{
+    for (int e = 0; e < SOLVER_ENTITIES; e++) {
+        if (s->cell[e] == cell)
+            return 1;
+    }
+    return 0;
+}
+
+int solver_step_cell(const SolverBoard* board, int cell, int dir)
+{
+    int x = cell % board->width + solver_dx[dir];
+    int y = cell / board->width + solver_dy[dir];
+
+    if (x < 0 || x >= board->width || y < 0 || y >= board->height)
+        return -1;
+    return y * board->width + x;
+}
+
+/* Boxes only slide onto free floor or goals */
+static int box_can_enter(const SolverBoard* board, const SolverState* s, int cell)
+{
+    return cell >= 0 && solver_box_enterable(board->field[cell]) && !occupied(s, cell);
+}
+
+int solver_apply_move(const SolverBoard* board, SolverState* s, int player, int dir)
+{
+    int self = SOLVER_PLAYER1 + player - 1;
+    int to = solver_step_cell(board, s->cell[self], dir);
+    if (to < 0)
+        return 0;
+
+    int box = box_at(s, to);
+    if (box >= 0) {
+        if (board->box_owner[box] != player)
+            return 0;
+        int dest = solver_step_cell(board, to, dir);
+        if (!box_can_enter(board, s, dest))
+            return 0;
+        s->cell[SOLVER_BOX0 + box] = dest;
+
+        int mirror = solver_mirror_of(player, box);
+        int mirror_dest = solver_step_cell(board, s->cell[SOLVER_BOX0 + mirror], dir);
+        int stalled = !box_can_enter(board, s, mirror_dest);
+        if (!stalled)
+            s->cell[SOLVER_BOX0 + mirror] = mirror_dest;
+
+        s->cell[self] = to;
+        return stalled ? 2 : 1;
+    }
+
+    if (!solver_player_enterable(board->field[to]) || s->cell[SOLVER_PLAYER1 + 2 - player] == to)
+        return 0;
+    s->cell[self] = to;
+    return 1;
+}
+
+/* Node holding s, or -1. The slot's copy of the hash spares a look at
+ * nodes that cannot match, which are far apart in memory. */
+static int find_node(const Solver* solver, const SolverState* s, unsigned int hash)
+{
+    for (unsigned int slot = hash & solver->table_mask; ; slot = (slot + 1) & solver->table_mask) {
+        const SolverSlot* entry = &solver->table[slot];
+        if (entry->node < 0)
+            return -1;
+        if (entry->hash == hash && !memcmp(&solver->nodes[entry->node].state, s, sizeof(SolverState)))
+            return entry->node;
+    }
+}
+
+static void insert_node(Solver* solver, int node, unsigned int hash)
+{
+    unsigned int slot = hash & solver->table_mask;
+
+    while (solver->table[slot].node >= 0)
+        slot = (slot + 1) & solver->table_mask;
+    solver->table[slot].hash = hash;
+    solver->table[slot].node = node;
+}
+
+/* Binary heap on key */
+static int push_open(Solver* solver, int node, int f)
+{
+    if (solver->open_count == solver->open_capacity)
+        return -1;
+
+    SolverOpen entry;
+    entry.key = ((unsigned int)f << 16) | (0xFFFF - solver->nodes[node].g);
+    entry.node = node;
+
+    int i = solver->open_count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (solver->open[parent].key <= entry.key)
+            break;
+        solver->open[i] = solver->open[parent];
+        i = parent;
+    }
+    solver->open[i] = entry;
+    return 0;
+}
+
+static SolverOpen pop_open(Solver* solver)
+{
+    SolverOpen top = solver->open[0];
+    SolverOpen last = solver->open[--solver->open_count];
+    int i = 0;
+
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= solver->open_count)
+            break;
+        if (child + 1 < solver->open_count && solver->open[child + 1].key < solver->open[child].key)
+            child++;
+        if (last.key <= solver->open[child].key)
+            break;
+        solver->open[i] = solver->open[child];
+        i = child;
+    }
+    solver->open[i] = last;
+    return top;
+}
+
+/* Record state reached from parent by move at cost g, if it is new or
+ * cheaper than before */
+static int reach(Solver* solver, const SolverState* s, int parent, int move, int g)
+{
+    int h = heuristic(solver, s);
+    if (h == SOLVER_FAR || g + solver->weight * h >= SOLVER_FAR)
+        return 0;
+
+    unsigned int hash = state_hash(solver, s);
+    int node = find_node(solver, s, hash);
+    if (node >= 0) {
+        SolverNode* n = &solver->nodes[node];
+        if (n->closed || n->g <= g)
+            return 0;
+    } else {
+        if (solver->node_count == solver->node_capacity)
+            return -1;
+        node = solver->node_count++;
+        solver->nodes[node].state = *s;
+        solver->nodes[node].closed = 0;
+        insert_node(solver, node, hash);
+    }
+
+    SolverNode* n = &solver->nodes[node];
+    n->parent = parent;
+    n->g = g;
+    n->move = move;
+    if (h < solver->best_h || (h == solver->best_h && g < solver->nodes[solver->best].g)) {
+        solver->best = node;
+        solver->best_h = h;
+    }
+    return push_open(solver, node, g + solver->weight * h);
+}
+
+int solver_prepare(Solver* solver, const GameContext* ctx, void* memory, int size)
+{
+    int cells = ctx->field_width * ctx->field_height;
+    unsigned char* p = (unsigned char*)memory;
+    unsigned char* end = p + size;
+
+    memset(solver, 0, sizeof(Solver));
+    solver_board(&solver->board, ctx);
+    solver->total_boxes = ctx->total_boxes;
+
+    if (size < solver_fixed_size(solver->board.width, solver->board.height))
+        return -1;
+    unsigned short* box_dist = (unsigned short*)p;
+    p += SOLVER_ALIGN(cells * 2);
+    solver->zobrist = (unsigned int*)p;
+    p += SOLVER_ALIGN(SOLVER_ENTITIES * cells * 4);
+
+    /* Scratch for set-up only, then the start of the search's share */
+    unsigned short* queue = (unsigned short*)p;
+    unsigned char* region = p + cells * 2;
+    unsigned char* search = p;
+
+    SolverState start;
+    start.cell[SOLVER_PLAYER1] = ctx->sim.y[ENTITY_PLAYER1] * solver->board.width + ctx->sim.x[ENTITY_PLAYER1];
+    start.cell[SOLVER_PLAYER2] = ctx->sim.y[ENTITY_PLAYER2] * solver->board.width + ctx->sim.x[ENTITY_PLAYER2];
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++)
+        start.cell[SOLVER_BOX0 + b] = ctx->sim.y[ENTITY_BOX0 + b] * solver->board.width + ctx->sim.x[ENTITY_BOX0 + b];
+
+    /* Compiled levels come with the map; others are searched here */
+    if (ctx->box_dist) {
+        solver->box_dist = ctx->box_dist;
+    } else {
+        build_box_dist(solver, box_dist, queue);
+        solver->box_dist = box_dist;
+    }
+    solver->split_boxes = find_split(solver, &start, region, queue);
+    find_swap_pairs(solver);
+
+    for (int e = 0; e < SOLVER_ENTITIES; e++)
+        solver->zobrist_table[e] = e;
+    for (int player = 1; player <= 2; player++) {
+        if (solver->swap_pairs & (1 << (player - 1)))
+            solver->zobrist_table[SOLVER_BOX0 + (player - 1) * 2 + 1] = SOLVER_BOX0 + (player - 1) * 2;
+    }
+
+    /* Same keys every run, so runs are repeatable */
+    unsigned int random = 2463534242u;
+    for (int i = 0; i < SOLVER_ENTITIES * cells; i++) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        solver->zobrist[i] = random;
+    }
+
+    /* A fifth of the rest for the table, kept at most 3/4 full; the
+     * remainder for nodes and twice as many open entries */
+    int rest = (int)(end - search);
+    unsigned int slots = 16;
+    while (slots * 2 * sizeof(SolverSlot) <= (unsigned int)rest / 5)
+        slots *= 2;
+    int capacity = (int)(slots / 4 * 3);
+    int by_bytes = (rest - (int)SOLVER_ALIGN(slots * sizeof(SolverSlot)) - 8) /
+                   (int)(sizeof(SolverNode) + 2 * sizeof(SolverOpen));
+    if (by_bytes < capacity)
+        capacity = by_bytes;
+    if (capacity < 16)
+        return -1;
+
+    solver->table = (SolverSlot*)search;
+    solver->table_mask = slots - 1;
+    solver->nodes = (SolverNode*)(search + SOLVER_ALIGN(slots * sizeof(SolverSlot)));
+    solver->node_capacity = capacity;
+    solver->open = (SolverOpen*)((unsigned char*)solver->nodes + SOLVER_ALIGN(capacity * sizeof(SolverNode)));
+    solver->open_capacity = (int)((end - (unsigned char*)solver->open) / sizeof(SolverOpen));
+    solver->start = start;
+    solver->weight = 1;
+    return 0;
+}
+
+int solver_table_slots(const Solver* solver)
+{
+    return (int)solver->table_mask + 1;
+}
+
+void solver_clear_table(Solver* solver, int first, int count)
+{
+    memset(solver->table + first, 0xFF, count * sizeof(SolverSlot));
+}
+
+void solver_start(Solver* solver)
+{
+    solver->goal = -1;
+    solver->best = 0;
+    solver->best_h = SOLVER_FAR;
+    solver->status = SOLVER_SEARCHING;
+    canonicalize(solver, &solver->start);
+    if (solver->total_boxes <= 0 || reach(solver, &solver->start, -1, 0, 0) != 0 || solver->node_count == 0)
+        solver->status = SOLVER_UNSOLVABLE;
+}
+
+int solver_init(Solver* solver, const GameContext* ctx, void* memory, int size)
+{
+    if (solver_prepare(solver, ctx, memory, size) < 0)
+        return -1;
+    solver_clear_table(solver, 0, solver_table_slots(solver));
+    solver_start(solver);
+    return 0;
+}
+
+void solver_set_weight(Solver* solver, int weight)
+{
+    solver->weight = weight < 1 ? 1 : weight;
+}
+
+SolverStatus solver_run(Solver* solver, int expansions)
+{
+    int all = (1 << MAX_MIRROR_BOXES) - 1;
+
+    for (int n = 0; solver->status == SOLVER_SEARCHING && (expansions == 0 || n < expansions); n++) {
+        if (solver->open_count == 0) {
+            solver->status = SOLVER_UNSOLVABLE;
+            break;
+        }
+
+        SolverOpen top = pop_open(solver);
+        SolverNode* node = &solver->nodes[top.node];
+        if (node->closed || 0xFFFF - (top.key & 0xFFFF) != node->g)
+            continue;   /* Reached again more cheaply since it was queued */
+
+        SolverState s = node->state;
+        if (boxes_on_goals(solver, &s, all) >= solver->total_boxes) {
+            solver->goal = top.node;
+            solver->status = SOLVER_SOLVED;
+            break;
+        }
+        node->closed = 1;
+        solver->expanded++;
+
+        /* Split sides: player 1 moves until its boxes are in, then only 2 */
+        int first = 1, last = 2;
+        if (solver->split_boxes) {
+            int done = boxes_on_goals(solver, &s, solver->split_boxes) == count_bits(solver->split_boxes);
+            first = last = done ? 2 : 1;
+        }
+
+        int g = node->g + 1;
+        for (int player = first; player <= last; player++) {
+            for (int dir = 0; dir < 4; dir++) {
+                SolverState next = s;
+                if (!solver_apply_move(&solver->board, &next, player, dir))
+                    continue;
+                canonicalize(solver, &next);
+                /* Player 1's side is finished: where it stands no longer
+                 * matters, so all such states meet in one */
+                if (solver->split_boxes && player == 1 &&
+                    boxes_on_goals(solver, &next, solver->split_boxes) == count_bits(solver->split_boxes))
+                    next.cell[SOLVER_PLAYER1] = 0;
+                if (reach(solver, &next, top.node, ((player - 1) << 2) | dir, g) < 0) {
+                    solver->status = SOLVER_OUT_OF_MEMORY;
+                    return solver->status;
+                }
+            }
+        }
+    }
+    return solver->status;
+}
+
+int solver_solution_length(const Solver* solver)
+{
+    if (solver->status != SOLVER_SOLVED)
+        return -1;
+    return solver->nodes[solver->goal].g;
+}
+
+int solver_solution(const Solver* solver, SolverMove* moves, int max_moves)
+{
+    int length = solver_solution_length(solver);
+    if (length < 0)
+        return 0;
+
+    int count = length < max_moves ? length : max_moves;
+    int i = length;
+    for (int node = solver->goal; solver->nodes[node].parent >= 0; node = solver->nodes[node].parent) {
+        i--;
+        if (i < count) {
+            moves[i].player = (solver->nodes[node].move >> 2) + 1;
+            moves[i].dir = solver->nodes[node].move & 3;
+        }
+    }
+    return count;
+}
+
+int solver_first_move(const Solver* solver, SolverMove* move)
+{
+    int node = solver->status == SOLVER_SOLVED ? solver->goal : solver->best;
+    if (solver->node_count == 0 || solver->nodes[node].parent < 0)
+        return 0;
+
+    while (solver->nodes[solver->nodes[node].parent].parent >= 0)
+        node = solver->nodes[node].parent;
+    move->player = (solver->nodes[node].move >> 2) + 1;
+    move->dir = solver->nodes[node].move & 3;
+    return 1;
+}
+
+SimInput solver_move_input(SolverMove move)
+{
+    static const SimInput inputs[2][4] = {
+        { INPUT_P1_UP, INPUT_P1_DOWN, INPUT_P1_LEFT, INPUT_P1_RIGHT },
+        { INPUT_P2_UP, INPUT_P2_DOWN, INPUT_P2_LEFT, INPUT_P2_RIGHT }
+    };
+    return inputs[move.player - 1][move.dir & 3];
+}
@@ -0,0 +1,176 @@
+/*
+ * Split-Field Solver
+ * A* over the joint state of both players and the four mirror boxes,
+ * under the game's move and push rules, for the fewest player steps that
+ * put the level's boxes on goals. Moving enemies are left out: they are
+ * timing, not puzzle.
+ *
+ * States are Zobrist-hashed into a transposition table, and a box on a
+ * cell no goal can be reached from prunes the state. Since a mirror box
+ * slides with no player behind it, only walled-off cells are dead here,
+ * not the corners a Sokoban solver would prune. When the two players can
+ * never meet or touch each other's boxes, player 1 finishes its side
+ * before player 2 starts, so the search covers the two halves one after
+ * the other instead of every interleaving of them.
+ *
+ * All memory comes from one caller block, and the search runs in slices
+ * of node expansions, so it can share a frame with other work. A weight
+ * above 1 trades the fewest steps for a far smaller search, and the state
+ * nearest the goal so far is kept, so a search cut short still points
+ * somewhere useful.
+ */
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "sim.h"
+
+typedef enum {
+    SOLVER_SEARCHING,      /* More slices needed */
+    SOLVER_SOLVED,
+    SOLVER_UNSOLVABLE,     /* Every reachable state was searched */
+    SOLVER_OUT_OF_MEMORY   /* The block filled before an answer */
+} SolverStatus;
+
+/* Players and boxes, by the field cell (y * width + x) each stands on */
+#define SOLVER_PLAYER1 0
+#define SOLVER_PLAYER2 1
+#define SOLVER_BOX0 2
+#define SOLVER_ENTITIES (SOLVER_BOX0 + MAX_MIRROR_BOXES)
+
+typedef struct {
+    unsigned short cell[SOLVER_ENTITIES];
+} SolverState;
+
+/* One player step: player 1 or 2, and SOLVER_UP, DOWN, LEFT or RIGHT */
+enum { SOLVER_UP, SOLVER_DOWN, SOLVER_LEFT, SOLVER_RIGHT };
+
+typedef struct {
+    unsigned char player;
+    unsigned char dir;
+} SolverMove;
+
+/* The level as the move rules see it */
+typedef struct {
+    const unsigned char* field;
+    int width;
+    int height;
+    unsigned char box_owner[MAX_MIRROR_BOXES];
+} SolverBoard;
+
+/* A state reached: where it came from and at what cost */
+typedef struct {
+    SolverState state;
+    int parent;              /* Node index, -1 for the start */
+    unsigned short g;        /* Player steps from the start */
+    unsigned char move;      /* (player - 1) << 2 | dir that led here */
+    unsigned char closed;    /* Expanded; its g is final */
+} SolverNode;
+
+/* Transposition table entry: a node and its state's hash */
+typedef struct {
+    unsigned int hash;
+    int node;                /* -1 for an empty slot */
+} SolverSlot;
+
+/* Open node, ordered by key: f, then deeper first */
+typedef struct {
+    unsigned int key;
+    int node;
+} SolverOpen;
+
+typedef struct {
+    /* The level */
+    SolverBoard board;
+    int total_boxes;
+
+    /* Derived from it */
+    const unsigned short* box_dist;  /* Box steps from each cell to the nearest
+                                   * goal, 0xFFFF where none is reachable:
+                                   * the level's compiled map if it has one */
+    unsigned int* zobrist;        /* Key per entity table and cell */
+    unsigned char zobrist_table[SOLVER_ENTITIES];  /* Boxes a player moves
+                                   * alike share a table */
+    unsigned char swap_pairs;     /* Bit per player whose two boxes are
+                                   * interchangeable: kept in cell order */
+    unsigned char split_boxes;    /* Boxes player 1 moves, when the two sides
+                                   * are apart and searched in turn; else 0 */
+
+    /* Search */
+    SolverState start;            /* Searched from, once solver_start queues it */
+    SolverNode* nodes;
+    int node_count;
+    int node_capacity;
+    SolverSlot* table;
+    unsigned int table_mask;
+    SolverOpen* open;
+    int open_count;
+    int open_capacity;
+    int weight;                   /* f = g + weight * h; 1 unless set */
+    SolverStatus status;
+    int goal;                     /* Node of the solution once solved */
+    int best;                     /* Node of least h reached, fewest steps
+                                   * on a tie */
+    int best_h;
+    long expanded;                /* Nodes expanded so far */
+} Solver;
+
+/* The game's rules over a SolverState, for tools that walk states
+ * without a search. Tiles a box may slide onto and a player may step
+ * onto; the box a push of box moves with it, as try_push_mirror_box
+ * picks it; the cell one step from cell in dir, or -1 off the field. */
+void solver_board(SolverBoard* board, const GameContext* ctx);
+int solver_box_enterable(int tile);
+int solver_player_enterable(int tile);
+int solver_mirror_of(int player, int box);
+int solver_step_cell(const SolverBoard* board, int cell, int dir);
+
+/* Player's step in dir, as move_player makes it with the enemies aside.
+ * Returns 0 if nothing moves, 2 for a push whose mirror box stayed put,
+ * else 1. */
+int solver_apply_move(const SolverBoard* board, SolverState* s, int player, int dir);
+
+/* Bytes of block the solver needs for a width x height level, plus about
+ * 50 per state it may reach */
+int solver_fixed_size(int width, int height);
+
+/* Bytes of block that give the table and nodes room for at least states
+ * states on a width x height level, and no more than solver_prepare
+ * would leave unused */
+int solver_block_size(int width, int height, int states);
+
+/* Set up a search from the game's current state within memory, which
+ * must stay valid while the solver is used. Returns -1 if the block is
+ * too small to hold more than a handful of states. */
+int solver_init(Solver* solver, const GameContext* ctx, void* memory, int size);
+
+/* solver_init in three steps, for callers that spread it over frames:
+ * everything but the table, which can take long on a big level; then the
+ * table emptied, count slots at a time from first; then the start state
+ * queued. solver_prepare returns -1 as solver_init does. */
+int solver_prepare(Solver* solver, const GameContext* ctx, void* memory, int size);
+int solver_table_slots(const Solver* solver);
+void solver_clear_table(Solver* solver, int first, int count);
+void solver_start(Solver* solver);
+
+/* Weight the heuristic by weight (at least 1) from here on. Above 1 the
+ * solution found may take more steps than the fewest. */
+void solver_set_weight(Solver* solver, int weight);
+
+/* Expand up to expansions nodes (0: until done) and return the status */
+SolverStatus solver_run(Solver* solver, int expansions);
+
+/* Player steps in the solution, or -1 if not solved */
+int solver_solution_length(const Solver* solver);
+
+/* Write the solution's first max_moves moves; returns how many */
+int solver_solution(const Solver* solver, SolverMove* moves, int max_moves);
+
+/* The first move toward the solution, or while unsolved toward the best
+ * node so far. Returns 0 if there is none: the start is the best yet. */
+int solver_first_move(const Solver* solver, SolverMove* move);
+
+/* The input bit that makes the move */
+SimInput solver_move_input(SolverMove move);
+
+#endif /* SOLVER_H */
@@ -0,0 +1,131 @@
+/*
+ * Split-Field Bench Levels (host)
+ * Walls first, from the seed, then the entities: at set places around
+ * the middle of each side, or on random free cells
+ */
+
+#include "bench_levels.h"
+#include <string.h>
+
+unsigned int bench_random_start(unsigned int seed)
+{
+    return seed * 2654435761u + 1;
+}
+
+unsigned int bench_random(unsigned int* state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* The field with its border and barrier, and wall_percent of the rest
+ * walled; random carries on from the walls */
+static int build_walls(GameContext* ctx, int width, int height, int wall_percent, unsigned int* random)
+{
+    if (sim_init_field(ctx, width, height) < 0)
+        return -1;
+
+    for (int y = 1; y < height - 1; y++) {
+        for (int x = 1; x < width - 1; x++) {
+            if (FIELD_TILE(ctx, x, y) == TILE_EMPTY && (int)(bench_random(random) % 100) < wall_percent)
+                FIELD_TILE(ctx, x, y) = TILE_WALL;
+        }
+    }
+    return 0;
+}
+
+/* Put an entity on (x, y), clearing any wall there */
+static void place(GameContext* ctx, int slot, int x, int y)
+{
+    FIELD_TILE(ctx, x, y) = TILE_EMPTY;
+    ctx->sim.x[slot] = x;
+    ctx->sim.y[slot] = y;
+}
+
+int bench_level(GameContext* ctx, int width, int height, int wall_percent, unsigned int seed)
+{
+    unsigned int random = bench_random_start(seed);
+
+    if (build_walls(ctx, width, height, wall_percent, &random) < 0)
+        return -1;
+
+    for (int side = 0; side < 2; side++) {
+        int base = side ? width / 2 + 1 : 1;
+        int player_x = base + width / 4;
+        place(ctx, ENTITY_PLAYER1 + side, player_x, height / 2);
+        place(ctx, ENTITY_ENEMY0 + 2 * side, base, 1);
+        place(ctx, ENTITY_ENEMY0 + 2 * side + 1, base, height - 2);
+        for (int i = 0; i < 2; i++) {
+            int x = player_x + (i ? 2 : -2);
+            int y = height / 2 + (i ? 2 : -2);
+            place(ctx, ENTITY_BOX0 + 2 * side + i, x, y);
+            FIELD_TILE(ctx, x, y + (i ? 1 : -1)) = TILE_GOAL;
+            ctx->box_owner[2 * side + i] = side + 1;
+        }
+        ctx->enemy_target[2 * side] = side + 1;
+        ctx->enemy_target[2 * side + 1] = side + 1;
+    }
+    ctx->sim.enemy_active = (1 << MAX_ENEMIES) - 1;
+    ctx->total_boxes = MAX_MIRROR_BOXES;
+    sim_rebuild_occupancy(ctx);
+    return 0;
+}
+
+/* A free interior cell on one side of the barrier */
+static void random_cell(GameContext* ctx, unsigned int* random, int side, int* x, int* y)
+{
+    int half = ctx->field_width / 2;
+
+    for (;;) {
+        *x = side ? half + 1 + bench_random(random) % (ctx->field_width - half - 2)
+                  : 1 + bench_random(random) % (half - 1);
+        *y = 1 + bench_random(random) % (ctx->field_height - 2);
+        if (FIELD_TILE(ctx, *x, *y) != TILE_EMPTY)
+            continue;
+
+        int taken = 0;
+        for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+            if (slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1)
+                continue;
+            if (ctx->sim.x[slot] == *x && ctx->sim.y[slot] == *y)
+                taken = 1;
+        }
+        if (!taken)
+            return;
+    }
+}
+
+int bench_level_scattered(GameContext* ctx, int width, int height, int wall_percent, unsigned int seed)
+{
+    unsigned int random = bench_random_start(seed);
+
+    if (build_walls(ctx, width, height, wall_percent, &random) < 0)
+        return -1;
+
+    /* Entities start off the field so random_cell sees only those placed */
+    memset(ctx->sim.x, 0, sizeof(ctx->sim.x));
+    memset(ctx->sim.y, 0, sizeof(ctx->sim.y));
+    for (int side = 0; side < 2; side++) {
+        int x, y;
+        random_cell(ctx, &random, side, &x, &y);
+        ctx->sim.x[ENTITY_PLAYER1 + side] = x;
+        ctx->sim.y[ENTITY_PLAYER1 + side] = y;
+        for (int i = 0; i < 2; i++) {
+            int box = 2 * side + i;
+            random_cell(ctx, &random, side, &x, &y);
+            ctx->sim.x[ENTITY_BOX0 + box] = x;
+            ctx->sim.y[ENTITY_BOX0 + box] = y;
+            ctx->box_owner[box] = side + 1;
+            random_cell(ctx, &random, side, &x, &y);
+            FIELD_TILE(ctx, x, y) = TILE_GOAL;
+        }
+    }
+    ctx->sim.enemy_active = 0;
+    ctx->total_boxes = MAX_MIRROR_BOXES;
+    sim_rebuild_occupancy(ctx);
+    return 0;
+}
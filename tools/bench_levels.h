@@ -0,0 +1,30 @@
+/*
+ * Split-Field Bench Levels (host)
+ * Seeded random numbers and the random fields the host tools play on, so
+ * every tool builds the same level from the same seed. A tool running
+ * levels on several threads keeps a random state per level or game;
+ * rand() would share one across them.
+ */
+
+#ifndef BENCH_LEVELS_H
+#define BENCH_LEVELS_H
+
+#include "sim.h"
+
+/* First state for seed, and the next number from a state (xorshift) */
+unsigned int bench_random_start(unsigned int seed);
+unsigned int bench_random(unsigned int* state);
+
+/* A width x height field from seed, wall_percent of its interior walls.
+ * Each player stands mid-field on its side of the barrier, its enemies in
+ * the far corners of its half and its two boxes each a step from a goal,
+ * mirrored across the barrier. Enemies start active; the flow fields are
+ * left to the caller. width and height must be at least 8. Returns -1 if
+ * the field cannot be allocated. */
+int bench_level(GameContext* ctx, int width, int height, int wall_percent, unsigned int seed);
+
+/* As bench_level, but each side's player, two boxes and two goals stand on
+ * random free cells of that side, and there are no enemies */
+int bench_level_scattered(GameContext* ctx, int width, int height, int wall_percent, unsigned int seed);
+
+#endif /* BENCH_LEVELS_H */
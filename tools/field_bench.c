@@ -0,0 +1,146 @@
+/*
+ * Split-Field Field-Size Benchmark (host)
+ * Plays the same scripted walk, enemies idle, on fields from the stock
+ * 20x14 up to 256x256 and reports update and render cost per frame,
+ * which should stay flat as the field grows. After each run the sprites
+ * are left to settle and the last frame is checked against a full redraw,
+ * and the occupancy grid against the entities.
+ */
+
+#include "game.h"
+#include "display.h"
+#include "hud.h"
+#include "bench_levels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FRAMES 3000
+#define FIELD_WALL_PERCENT 6
+
+/* One press every 6 frames clears the 5-frame move delay */
+#define PRESS_INTERVAL 6
+
+static unsigned char bench_font[256 * 8];
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The stock level, or bench_level's field with a few walls */
+static int build_level(GameContext* ctx, int width, int height)
+{
+    if (width == DEFAULT_FIELD_WIDTH && height == DEFAULT_FIELD_HEIGHT) {
+        game_init(ctx);
+        return ctx->field ? 0 : -1;
+    }
+    return bench_level(ctx, width, height, FIELD_WALL_PERCENT, width * 7919 + height);
+}
+
+/* Each player holds a random direction for a few moves at a time */
+static SimInput script_input(int frame)
+{
+    static const SimInput p1[4] = { INPUT_P1_UP, INPUT_P1_DOWN, INPUT_P1_LEFT, INPUT_P1_RIGHT };
+    static const SimInput p2[4] = { INPUT_P2_UP, INPUT_P2_DOWN, INPUT_P2_LEFT, INPUT_P2_RIGHT };
+    static int dir1, dir2;
+
+    if (frame % PRESS_INTERVAL)
+        return 0;
+    if (frame % (PRESS_INTERVAL * 8) == 0) {
+        dir1 = rand() % 4;
+        dir2 = rand() % 4;
+    }
+    return p1[dir1] | p2[dir2];
+}
+
+static int bench_field(int width, int height)
+{
+    GameContext ctx;
+    double t_update = 0, t_render = 0;
+    unsigned long long pixels = 0;
+
+    if (build_level(&ctx, width, height) < 0) {
+        printf("field %3dx%-3d  could not allocate\n", width, height);
+        return 1;
+    }
+    srand(1);
+
+    /* Idle enemies, so no run ends early */
+    ctx.sim.enemy_active = 0;
+    sim_rebuild_occupancy(&ctx);
+
+    /* The first frames bake the layer and fill every buffer */
+    for (int i = 0; i < DISPLAY_MAX_BUFFERS; i++) {
+        sim_step(&ctx, 0);
+        game_render(&ctx);
+        display_flip(1);
+    }
+
+    for (int frame = 0; frame < BENCH_FRAMES && ctx.sim.state == GAME_RUNNING; frame++) {
+        SimInput input = script_input(frame);
+
+        double t0 = now_sec();
+        sim_step(&ctx, input);
+        double t1 = now_sec();
+        game_render(&ctx);
+        double t2 = now_sec();
+
+        display_flip(1);
+        t_update += t1 - t0;
+        t_render += t2 - t1;
+        pixels += game_render_stats()->pixels_written;
+    }
+
+    /* Let every buffer catch up, then compare with a full redraw */
+    for (int i = 0; i < 16; i++) {
+        ctx.sim.enemy_move_counter = 0;
+        sim_step(&ctx, 0);
+        game_render(&ctx);
+        display_flip(1);
+    }
+
+    size_t size = (size_t)DISPLAY_STRIDE * DISPLAY_HEIGHT * 4;
+    unsigned char* settled = malloc(size);
+    int exact = 0;
+    if (settled) {
+        memcpy(settled, display_buffer(display_front_index()), size);
+        ctx.full_redraw = 1;
+        game_render(&ctx);
+        display_flip(1);
+        exact = memcmp(settled, display_buffer(display_front_index()), size) == 0;
+        free(settled);
+    }
+
+    int stale = sim_check_occupancy(&ctx);
+
+    printf("field %3dx%-3d  update: %6.2f us/frame  render: %6.2f us/frame  pixels: %6llu/frame  exact: %s  occupancy: %s\n",
+           width, height, t_update / BENCH_FRAMES * 1e6, t_render / BENCH_FRAMES * 1e6,
+           pixels / BENCH_FRAMES, exact ? "yes" : "NO", stale ? "STALE" : "ok");
+
+    game_cleanup(&ctx);
+    return (exact && !stale) ? 0 : 1;
+}
+
+int main(void)
+{
+    static const int sizes[][2] = {
+        { DEFAULT_FIELD_WIDTH, DEFAULT_FIELD_HEIGHT },
+        { 32, 32 }, { 64, 64 }, { 128, 128 }, { 256, 256 }
+    };
+    DisplayConfig config = { 2, RENDER_FORMAT_8888 };
+    int failures = 0;
+
+    if (display_init(&config) < 0)
+        return 1;
+    hud_init(bench_font);
+
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+        failures += bench_field(sizes[i][0], sizes[i][1]);
+
+    display_shutdown();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Render the same frames with the software and GE backends under
+# PPSSPPHeadless and compare the dumped screens byte for byte.
+#
+# Each EBOOT is built with FRAME_DUMP, so it skips the menu, plays a fixed
+# number of frames with no input, writes host0:/frame_<backend>.raw
+# (480x272, 8888) next to the EBOOT and exits.
+#
+# Usage: tools/headless_compare.sh [frames]
+# Environment: PPSSPP_HEADLESS (default PPSSPPHeadless), OUT (default build-headless)
+
+set -e
+
+FRAMES=${1:-120}
+HEADLESS=${PPSSPP_HEADLESS:-PPSSPPHeadless}
+OUT=${OUT:-build-headless}
+
+for backend in software gu; do
+    echo "Building $backend EBOOT ($FRAMES frames)"
+    make clean >/dev/null
+    make RENDER_BACKEND=$backend FRAME_DUMP=$FRAMES >/dev/null
+    mkdir -p "$OUT/$backend"
+    cp build/EBOOT.PBP "$OUT/$backend/"
+    rm -f "$OUT/$backend/frame_$backend.raw"
+    (cd "$OUT/$backend" && "$HEADLESS" --graphics=software --timeout=30 EBOOT.PBP) || true
+done
+
+SW="$OUT/software/frame_software.raw"
+GU="$OUT/gu/frame_gu.raw"
+
+if [ ! -f "$SW" ] || [ ! -f "$GU" ]; then
+    echo "Missing frame dump; check that $HEADLESS mounts host0: on the EBOOT directory"
+    exit 2
+fi
+
+if cmp -s "$SW" "$GU"; then
+    echo "Frames match"
+else
+    echo "Frames differ: $(cmp -l "$SW" "$GU" | wc -l) bytes"
+    exit 1
+fi
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Run the pixel kernel checks on the emulated PSP: builds a KERNEL_BENCH
+# EBOOT, runs it under PPSSPPHeadless and prints host0:/kernels.txt.
+# Fails if any VFPU kernel differs from the scalar reference.
+#
+# Usage: tools/headless_kernels.sh
+# Environment: PPSSPP_HEADLESS (default PPSSPPHeadless), OUT (default build-headless)
+
+set -e
+
+HEADLESS=${PPSSPP_HEADLESS:-PPSSPPHeadless}
+OUT=${OUT:-build-headless}
+
+make clean >/dev/null
+make KERNEL_BENCH=1 >/dev/null
+mkdir -p "$OUT/kernels"
+cp build/EBOOT.PBP "$OUT/kernels/"
+rm -f "$OUT/kernels/kernels.txt"
+(cd "$OUT/kernels" && "$HEADLESS" --timeout=60 EBOOT.PBP) || true
+
+if [ ! -f "$OUT/kernels/kernels.txt" ]; then
+    echo "Missing kernels.txt; check that $HEADLESS mounts host0: on the EBOOT directory"
+    exit 2
+fi
+
+cat "$OUT/kernels/kernels.txt"
+grep -q "mismatches fill32 0  copy32 0  span16 0  clear 0" "$OUT/kernels/kernels.txt"
@@ -0,0 +1,297 @@
+/*
+ * Split-Field Level Compiler (host)
+ * Turns text levels (level.h format) into the const tables of
+ * level_table.h, for the build to compile into the game:
+ *
+ *   level_compile [-o FILE.c] LEVELS...
+ *
+ * Each level is parsed as the game would read it, then written out as
+ * its tiles followed by its occupancy grid, its starting state block and
+ * box count, with the box steps from every cell to the nearest goal
+ * searched here once for the solver and hint search. Malformed or
+ * repeated levels stop the build.
+ */
+
+#include "sim.h"
+#include "level.h"
+#include "level_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Values per line in the tables written, for fields wider than this */
+#define VALUES_PER_LINE 20
+
+/* Boxes slide on floor and goals only */
+static int box_passes(int tile)
+{
+    return tile == TILE_EMPTY || tile == TILE_GOAL;
+}
+
+/* What one level compiles to, beyond the context itself */
+typedef struct {
+    GameContext ctx;
+    int goal_count;
+    unsigned short* box_dist;
+} Compiled;
+
+static void* must_alloc(size_t size)
+{
+    void* p = calloc(size ? size : 1, 1);
+    if (!p) {
+        fprintf(stderr, "level_compile: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* Breadth-first box steps from every goal at once over the tiles boxes
+ * slide on, so each cell gets the nearest goal's */
+static void analyse(Compiled* level)
+{
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    const GameContext* ctx = &level->ctx;
+    int width = ctx->field_width, cells = width * ctx->field_height;
+    unsigned short* queue = (unsigned short*)must_alloc(cells * sizeof(unsigned short));
+    unsigned short* dist = (unsigned short*)must_alloc(cells * sizeof(unsigned short));
+    int head = 0, tail = 0;
+
+    for (int c = 0; c < cells; c++) {
+        dist[c] = LEVEL_FAR;
+        if (ctx->field[c] == TILE_GOAL) {
+            dist[c] = 0;
+            queue[tail++] = c;
+        }
+    }
+    level->goal_count = tail;
+    while (head < tail) {
+        int c = queue[head++];
+        int x = c % width, y = c / width;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dx[d], ny = y + dy[d];
+            if (nx < 0 || nx >= width || ny < 0 || ny >= ctx->field_height)
+                continue;
+            int n = ny * width + nx;
+            if (dist[n] == LEVEL_FAR && box_passes(ctx->field[n])) {
+                dist[n] = dist[c] + 1;
+                queue[tail++] = n;
+            }
+        }
+    }
+    level->box_dist = dist;
+    free(queue);
+}
+
+static void free_compiled(Compiled* level)
+{
+    sim_cleanup(&level->ctx);
+    free(level->box_dist);
+}
+
+/* Line number of byte pos in text, for messages */
+static int line_of(const char* text, int pos)
+{
+    int line = 1;
+
+    for (int i = 0; i < pos; i++)
+        line += text[i] == '\n';
+    return line;
+}
+
+/* Every level in a file, appended to levels; returns -1 on any error */
+static int read_file_levels(const char* path, Compiled** levels, int* count, int* capacity)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "level_compile: cannot read %s\n", path);
+        return -1;
+    }
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    char* text = (size >= 0 && fseek(f, 0, SEEK_SET) == 0) ? (char*)must_alloc(size + 1) : NULL;
+    int ok = text && fread(text, 1, size, f) == (size_t)size;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "level_compile: cannot read %s\n", path);
+        free(text);
+        return -1;
+    }
+
+    int result = 0;
+    for (int pos = 0, used;; pos += used) {
+        GameContext ctx;
+        int status = level_parse(&ctx, text + pos, (int)size - pos, &used);
+        if (status == 1)
+            break;
+        if (status < 0) {
+            /* used ends the level: find its header for the message */
+            int header = pos;
+            while (header < pos + used && strncmp(text + header, "level", 5) != 0)
+                header += strcspn(text + header, "\n") + 1;
+            fprintf(stderr, "%s:%d: malformed level\n", path, line_of(text, header));
+            result = -1;
+            break;
+        }
+        for (int i = 0; i < *count; i++) {
+            if ((*levels)[i].ctx.level == ctx.level) {
+                fprintf(stderr, "%s: level %d given twice\n", path, ctx.level);
+                result = -1;
+            }
+        }
+        if (result < 0) {
+            sim_cleanup(&ctx);
+            break;
+        }
+
+        if (*count == *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 16;
+            *levels = (Compiled*)realloc(*levels, *capacity * sizeof(Compiled));
+            if (!*levels) {
+                fprintf(stderr, "level_compile: out of memory\n");
+                exit(1);
+            }
+        }
+        Compiled* level = &(*levels)[(*count)++];
+        memset(level, 0, sizeof(Compiled));
+        level->ctx = ctx;
+        analyse(level);
+    }
+    free(text);
+    return result;
+}
+
+/* A table of values, VALUES_PER_LINE or a row of the field to a line */
+static void write_values(FILE* out, const char* type, const char* name, int number, const unsigned int* values,
+                         int count, int per_line)
+{
+    fprintf(out, "static const %s level%d_%s[%d] = {", type, number, name, count);
+    for (int i = 0; i < count; i++) {
+        if (i % per_line == 0)
+            fprintf(out, "\n   ");
+        fprintf(out, " %u%s", values[i], i + 1 < count ? "," : "");
+    }
+    fprintf(out, "\n};\n");
+}
+
+static void write_level(FILE* out, const Compiled* level)
+{
+    const GameContext* ctx = &level->ctx;
+    int number = ctx->level, width = ctx->field_width, cells = width * ctx->field_height;
+    unsigned int* values = (unsigned int*)must_alloc(2 * cells * sizeof(unsigned int));
+    int per_line = width <= VALUES_PER_LINE ? width : VALUES_PER_LINE;
+
+    fprintf(out, "/* Level %d: %dx%d, %d goals */\n", number, width, ctx->field_height, level->goal_count);
+    for (int i = 0; i < cells; i++) {
+        values[i] = ctx->field[i];
+        values[cells + i] = ctx->occupancy[i];
+    }
+    write_values(out, "unsigned char", "cells", number, values, 2 * cells, per_line);
+    for (int i = 0; i < cells; i++)
+        values[i] = level->box_dist[i];
+    write_values(out, "unsigned short", "box_dist", number, values, cells, per_line);
+    fprintf(out, "\n");
+    free(values);
+}
+
+static void write_list(FILE* out, const unsigned char* values, int count)
+{
+    fprintf(out, "{");
+    for (int i = 0; i < count; i++)
+        fprintf(out, " %u%s", values[i], i + 1 < count ? "," : " ");
+    fprintf(out, "}");
+}
+
+static void write_entry(FILE* out, const Compiled* level)
+{
+    const GameContext* ctx = &level->ctx;
+    const SimState* s = &ctx->sim;
+    int n = ctx->level;
+
+    fprintf(out, "    {\n        %d, %d, %d, level%d_cells,\n", n, ctx->field_width, ctx->field_height, n);
+    fprintf(out, "        { .x = ");
+    write_list(out, s->x, ENTITY_COUNT);
+    fprintf(out, ",\n          .y = ");
+    write_list(out, s->y, ENTITY_COUNT);
+    fprintf(out, ",\n          .enemy_active = %u, .state = %u, .enemy_move_counter = %u, .boxes_in_goal = %u },\n",
+            s->enemy_active, s->state, s->enemy_move_counter, s->boxes_in_goal);
+    fprintf(out, "        ");
+    write_list(out, ctx->box_owner, MAX_MIRROR_BOXES);
+    fprintf(out, ", ");
+    write_list(out, ctx->enemy_target, MAX_ENEMIES);
+    fprintf(out, ", %d,\n        level%d_box_dist\n    },\n", ctx->total_boxes, n);
+}
+
+static int by_number(const void* a, const void* b)
+{
+    return ((const Compiled*)a)->ctx.level - ((const Compiled*)b)->ctx.level;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: level_compile [-o FILE.c] LEVELS...\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* out_path = NULL;
+    Compiled* levels = NULL;
+    int count = 0, capacity = 0, files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            files++;
+            if (read_file_levels(argv[i], &levels, &count, &capacity) < 0)
+                return 1;
+        }
+    }
+    if (!files) {
+        usage();
+        return 2;
+    }
+    if (!count) {
+        fprintf(stderr, "level_compile: no levels\n");
+        return 1;
+    }
+    qsort(levels, count, sizeof(Compiled), by_number);
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "level_compile: cannot write %s\n", out_path);
+        return 1;
+    }
+    fprintf(out, "/* Written by tools/level_compile from");
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o"))
+            i++;
+        else
+            fprintf(out, " %s", argv[i]);
+    }
+    fprintf(out, "; do not edit */\n\n#include \"level_table.h\"\n\n");
+    for (int i = 0; i < count; i++)
+        write_level(out, &levels[i]);
+
+    fprintf(out, "const LevelTable level_tables[] = {\n");
+    for (int i = 0; i < count; i++)
+        write_entry(out, &levels[i]);
+    fprintf(out, "};\n\nconst int level_table_count = %d;\n", count);
+
+    int failed = ferror(out) != 0;
+    if (out != stdout && fclose(out) != 0)
+        failed = 1;
+    if (failed) {
+        fprintf(stderr, "level_compile: cannot write %s\n", out_path);
+        if (out_path)
+            remove(out_path);
+    }
+    for (int i = 0; i < count; i++)
+        free_compiled(&levels[i]);
+    free(levels);
+    return failed;
+}
@@ -0,0 +1,636 @@
+/*
+ * Split-Field Level Generator (host)
+ * Makes levels that can be won by playing backward from a won one: walls,
+ * goals and the four boxes on their goals first, then many random
+ * reversed player moves, each a step back or a pull of one of the
+ * player's own boxes with its mirror box following or not as the push
+ * rules would have it. Where that ends is the level, and the moves run
+ * forward again are its solution. Every solution is played through
+ * sim_step with the enemies off and must win, so no level leaves here
+ * without proof it can be won.
+ *
+ *   level_gen [-n levels] [-c candidates] [-j workers] [-s seed]
+ *             [-f WIDTHxHEIGHT] [-o FILE] [-x] [-v]
+ *
+ * Candidates are made across all cores by the work pool, each from its
+ * own seed, so the output does not depend on the worker count. Repeats
+ * are dropped, the rest ranked by an estimate of difficulty, and -n
+ * levels taken evenly across that range and written easiest first in the
+ * level.h text format, for the game to load from levels.txt. -x solves
+ * every level written with the solver, ranks them again by its fewest
+ * steps and states searched instead, and fails if any is unsolvable.
+ *
+ * The barrier splits the field down the middle. Each player's boxes are
+ * locked to it, and enemies start on their player's side, away from it.
+ * Half the levels keep each player's mirror pair on its own side, as the
+ * stock level does; the others put one box of each pair across the
+ * barrier, where only its mirror can move it.
+ */
+
+#include "sim.h"
+#include "solver.h"
+#include "level.h"
+#include "work_pool.h"
+#include "bench_levels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_LEVELS 50
+#define DEFAULT_CANDIDATES 20000
+#define DEFAULT_SOLVE_MEGABYTES 256
+
+/* Reversed moves per level, and how much of a side may be wall */
+#define MIN_REVERSE_MOVES 40
+#define MAX_REVERSE_MOVES 400
+#define MIN_WALL_PERCENT 4
+#define MAX_WALL_PERCENT 18
+
+/* Enemies start at least this many steps from their player */
+#define ENEMY_MIN_DISTANCE 6
+
+/* A level made, with what the ranking needs to know about it */
+typedef struct {
+    unsigned char* field;        /* width * height tiles, in the batch's block */
+    SimState sim;
+    unsigned char box_owner[MAX_MIRROR_BOXES];
+    unsigned char enemy_target[MAX_ENEMIES];
+    int ok;                      /* Solution checked to win */
+    unsigned int hash;           /* Of field and start, to drop repeats */
+    int difficulty;
+    int box_distance;            /* Box steps from the start to the goals */
+    int pushes;                  /* Box moves in the solution */
+    int stalls;                  /* Pushes whose mirror box stayed put */
+    int solution;                /* Player steps in the solution */
+    int fewest;                  /* -x: the solver's fewest steps, and the */
+    long searched;               /* states it expanded to find them */
+} Candidate;
+
+typedef struct {
+    Candidate* candidates;
+    int width;
+    int height;
+    unsigned int seed;
+    /* -x */
+    Candidate** chosen;
+    void* solve_memory[64];
+    int solve_size;
+} Batch;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int entity_at(const SolverState* s, int cell)
+{
+    for (int e = 0; e < SOLVER_ENTITIES; e++) {
+        if (s->cell[e] == cell)
+            return e;
+    }
+    return -1;
+}
+
+/* No two on a cell, boxes only on floor and goals, players off walls */
+static int valid_state(const SolverBoard* board, const SolverState* s)
+{
+    for (int e = 0; e < SOLVER_ENTITIES; e++) {
+        int tile = board->field[s->cell[e]];
+        if (e >= SOLVER_BOX0 ? !solver_box_enterable(tile) : !solver_player_enterable(tile))
+            return 0;
+        for (int f = e + 1; f < SOLVER_ENTITIES; f++) {
+            if (s->cell[e] == s->cell[f])
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/* A state from which player stepping in dir reaches s: a plain step back
+ * (pull 0), or a pull of the box ahead with its mirror box moved back too
+ * (pull 1) or left where it is (pull 2). The forward move is played from
+ * it to check, so only states that truly lead to s come back. Returns 0
+ * if there is none of that kind, else what solver_apply_move returned. */
+static int reverse(const SolverBoard* board, const SolverState* s, int player, int dir, int pull, SolverState* from)
+{
+    int self = SOLVER_PLAYER1 + player - 1;
+    int back = solver_step_cell(board, s->cell[self], dir ^ 1);
+    if (back < 0)
+        return 0;
+
+    *from = *s;
+    from->cell[self] = back;
+    if (pull) {
+        int ahead = solver_step_cell(board, s->cell[self], dir);
+        int hit = ahead < 0 ? -1 : entity_at(s, ahead);
+        if (hit < SOLVER_BOX0 || board->box_owner[hit - SOLVER_BOX0] != player)
+            return 0;
+        from->cell[hit] = s->cell[self];
+        if (pull == 1) {
+            int mirror = SOLVER_BOX0 + solver_mirror_of(player, hit - SOLVER_BOX0);
+            int mirror_back = solver_step_cell(board, s->cell[mirror], dir ^ 1);
+            if (mirror_back < 0)
+                return 0;
+            from->cell[mirror] = mirror_back;
+        }
+    }
+    if (!valid_state(board, from))
+        return 0;
+
+    SolverState check = *from;
+    int moved = solver_apply_move(board, &check, player, dir);
+    if (!moved || memcmp(&check, s, sizeof(SolverState)) != 0)
+        return 0;
+    return moved;
+}
+
+/* A random free floor cell in columns [x0, x1); entities not placed yet
+ * stand on cell 0, the corner wall */
+static int random_free_cell(const GameContext* ctx, const SolverState* s, unsigned int* random, int x0, int x1)
+{
+    for (int tries = 0; tries < 1000; tries++) {
+        int x = x0 + bench_random(random) % (x1 - x0);
+        int y = 1 + bench_random(random) % (ctx->field_height - 2);
+        int cell = y * ctx->field_width + x;
+        if (FIELD_TILE(ctx, x, y) != TILE_EMPTY)
+            continue;
+        if (entity_at(s, cell) < 0)
+            return cell;
+    }
+    return -1;
+}
+
+/* Fewest box steps from each cell to a goal, SOLVER-style: 0xFFFF where
+ * none can be reached */
+static void goal_distance(const SolverBoard* board, unsigned short* dist, unsigned short* queue)
+{
+    int cells = board->width * board->height;
+    int head = 0, tail = 0;
+
+    for (int c = 0; c < cells; c++) {
+        dist[c] = 0xFFFF;
+        if (board->field[c] == TILE_GOAL) {
+            dist[c] = 0;
+            queue[tail++] = c;
+        }
+    }
+    while (head < tail) {
+        int c = queue[head++];
+        for (int d = 0; d < 4; d++) {
+            int n = solver_step_cell(board, c, d);
+            if (n >= 0 && dist[n] == 0xFFFF && solver_box_enterable(board->field[n])) {
+                dist[n] = dist[c] + 1;
+                queue[tail++] = n;
+            }
+        }
+    }
+}
+
+/* Play the solution through sim_step, a press each time the move delay
+ * allows, with the enemies off; it must win */
+static int check_solution(const Candidate* c, int width, int height, const SolverMove* moves, int count)
+{
+    GameContext ctx;
+    if (sim_init_field(&ctx, width, height) < 0)
+        return 0;
+    memcpy(ctx.field, c->field, width * height);
+    ctx.sim = c->sim;
+    ctx.sim.enemy_active = 0;
+    memcpy(ctx.box_owner, c->box_owner, sizeof(ctx.box_owner));
+    ctx.total_boxes = MAX_MIRROR_BOXES;
+    sim_rebuild_occupancy(&ctx);
+
+    for (int i = 0; i < count && ctx.sim.state == GAME_RUNNING; i++) {
+        for (int t = 0; t <= PLAYER_MOVE_DELAY; t++)
+            sim_step(&ctx, t == 0 ? solver_move_input(moves[i]) : 0);
+    }
+    int won = ctx.sim.state == GAME_WIN;
+    sim_cleanup(&ctx);
+    return won;
+}
+
+static unsigned int level_hash(const Candidate* c, int cells)
+{
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < cells; i++)
+        hash = (hash ^ c->field[i]) * 16777619u;
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        if (slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1)
+            continue;
+        hash = (hash ^ c->sim.x[slot]) * 16777619u;
+        hash = (hash ^ c->sim.y[slot]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Make candidate index from its own seed */
+static void generate(void* arg, int index, int worker)
+{
+    Batch* batch = (Batch*)arg;
+    Candidate* c = &batch->candidates[index];
+    int width = batch->width, height = batch->height, half = width / 2;
+    unsigned int random = bench_random_start(batch->seed + index);
+    GameContext ctx;
+    (void)worker;
+
+    c->ok = 0;
+    if (sim_init_field(&ctx, width, height) < 0)
+        return;
+    for (int i = 0; i < 8; i++)
+        bench_random(&random);
+
+    /* Walls, each side its own */
+    int wall_percent = MIN_WALL_PERCENT + bench_random(&random) % (MAX_WALL_PERCENT - MIN_WALL_PERCENT + 1);
+    for (int y = 1; y < height - 1; y++) {
+        for (int x = 1; x < width - 1; x++) {
+            if (x != half && (int)(bench_random(&random) % 100) < wall_percent)
+                FIELD_TILE(&ctx, x, y) = TILE_WALL;
+        }
+    }
+
+    /* Won: each box on its goal. Box 0 and player 2's box 2 sit on their
+     * owner's side; their mirrors 1 and 3 too, or across the barrier */
+    int across = bench_random(&random) & 1;
+    SolverState s;
+    memset(&s, 0, sizeof(s));
+    ctx.box_owner[0] = ctx.box_owner[1] = 1;
+    ctx.box_owner[2] = ctx.box_owner[3] = 2;
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        int owner_side = ctx.box_owner[b] - 1;
+        int side = (b & 1) && across ? !owner_side : owner_side;
+        int cell = side ? random_free_cell(&ctx, &s, &random, half + 1, width - 1)
+                        : random_free_cell(&ctx, &s, &random, 1, half);
+        if (cell < 0) {
+            sim_cleanup(&ctx);
+            return;
+        }
+        s.cell[SOLVER_BOX0 + b] = cell;
+        ctx.field[cell] = TILE_GOAL;
+    }
+    for (int p = 0; p < 2; p++) {
+        int cell = p ? random_free_cell(&ctx, &s, &random, half + 1, width - 1)
+                     : random_free_cell(&ctx, &s, &random, 1, half);
+        if (cell < 0) {
+            sim_cleanup(&ctx);
+            return;
+        }
+        s.cell[SOLVER_PLAYER1 + p] = cell;
+    }
+    SolverBoard board;
+    solver_board(&board, &ctx);
+
+    /* Play backward, favouring pulls; the moves go on the witness list last
+     * first, so it reads forward from the end */
+    SolverMove witness[MAX_REVERSE_MOVES];
+    int count = 0, stalls = 0, pushes = 0;
+    int target = MIN_REVERSE_MOVES + bench_random(&random) % (MAX_REVERSE_MOVES - MIN_REVERSE_MOVES + 1);
+    for (int tries = 0; count < target && tries < target * 8; tries++) {
+        int player = 1 + (bench_random(&random) & 1);
+        int turn = bench_random(&random);
+        SolverState from;
+        int moved = 0, dir = 0, pull = 0;
+
+        /* Mostly a pull, in any direction one can be made */
+        if (turn % 4 != 0) {
+            for (int k = 0; k < 8 && !moved; k++) {
+                dir = (turn / 4 + k) & 3;
+                pull = 1 + ((turn / 16 + k / 4) & 1);
+                moved = reverse(&board, &s, player, dir, pull, &from);
+            }
+        }
+
+        /* Else a step back, half the time away from the nearest own box,
+         * which in forward play is a step toward it */
+        if (!moved) {
+            pull = 0;
+            dir = (turn >> 8) & 3;
+            if (turn & 0x1000) {
+                int p = s.cell[SOLVER_PLAYER1 + player - 1], best = 1 << 30;
+                for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+                    int box = s.cell[SOLVER_BOX0 + b];
+                    int dx = box % width - p % width, dy = box / width - p / width;
+                    int d = abs(dx) + abs(dy);
+                    if (ctx.box_owner[b] != player || d >= best)
+                        continue;
+                    best = d;
+                    /* Reversed: step back from dir means moving dir ^ 1 */
+                    if (abs(dx) > abs(dy))
+                        dir = dx > 0 ? SOLVER_LEFT : SOLVER_RIGHT;
+                    else
+                        dir = dy > 0 ? SOLVER_UP : SOLVER_DOWN;
+                }
+            }
+            moved = reverse(&board, &s, player, dir, 0, &from);
+        }
+        if (!moved)
+            continue;
+
+        s = from;
+        witness[MAX_REVERSE_MOVES - 1 - count].player = player;
+        witness[MAX_REVERSE_MOVES - 1 - count].dir = dir;
+        count++;
+        pushes += pull != 0;
+        stalls += moved == 2;
+    }
+
+    /* Boxes still on goals make for a dull level */
+    int on_goals = 0;
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++)
+        on_goals += ctx.field[s.cell[SOLVER_BOX0 + b]] == TILE_GOAL;
+
+    /* Enemies on their player's side, ENEMY_MIN_DISTANCE steps or more away */
+    int enemies = 0;
+    memset(c->enemy_target, 0, sizeof(c->enemy_target));
+    ctx.sim.enemy_active = 0;
+    for (int side = 0; side < 2; side++) {
+        int wanted = 1 + bench_random(&random) % 2;
+        int player_cell = s.cell[SOLVER_PLAYER1 + side];
+        for (int tries = 0; tries < 50 && wanted > 0; tries++) {
+            int cell = side ? random_free_cell(&ctx, &s, &random, half + 1, width - 1)
+                            : random_free_cell(&ctx, &s, &random, 1, half);
+            if (cell < 0)
+                break;
+            int dx = abs(cell % width - player_cell % width), dy = abs(cell / width - player_cell / width);
+            int clash = 0;
+            for (int e = 0; e < enemies; e++)
+                clash |= ctx.sim.y[ENTITY_ENEMY0 + e] * width + ctx.sim.x[ENTITY_ENEMY0 + e] == cell;
+            if (dx + dy < ENEMY_MIN_DISTANCE || clash)
+                continue;
+            ctx.sim.x[ENTITY_ENEMY0 + enemies] = cell % width;
+            ctx.sim.y[ENTITY_ENEMY0 + enemies] = cell / width;
+            c->enemy_target[enemies] = side + 1;
+            ctx.sim.enemy_active |= 1 << enemies;
+            enemies++;
+            wanted--;
+        }
+    }
+
+    ctx.sim.x[ENTITY_PLAYER1] = s.cell[SOLVER_PLAYER1] % width;
+    ctx.sim.y[ENTITY_PLAYER1] = s.cell[SOLVER_PLAYER1] / width;
+    ctx.sim.x[ENTITY_PLAYER2] = s.cell[SOLVER_PLAYER1 + 1] % width;
+    ctx.sim.y[ENTITY_PLAYER2] = s.cell[SOLVER_PLAYER1 + 1] / width;
+    for (int b = 0; b < MAX_MIRROR_BOXES; b++) {
+        ctx.sim.x[ENTITY_BOX0 + b] = s.cell[SOLVER_BOX0 + b] % width;
+        ctx.sim.y[ENTITY_BOX0 + b] = s.cell[SOLVER_BOX0 + b] / width;
+    }
+    memcpy(c->field, ctx.field, width * height);
+    c->sim = ctx.sim;
+    memcpy(c->box_owner, ctx.box_owner, sizeof(c->box_owner));
+
+    /* Box steps still to go, a lower bound on the pushes */
+    unsigned short* dist = (unsigned short*)malloc(width * height * 2 * sizeof(unsigned short));
+    c->box_distance = 0;
+    if (dist) {
+        goal_distance(&board, dist, dist + width * height);
+        for (int b = 0; b < MAX_MIRROR_BOXES; b++)
+            c->box_distance += dist[s.cell[SOLVER_BOX0 + b]];
+        free(dist);
+    }
+    sim_cleanup(&ctx);
+
+    c->pushes = pushes;
+    c->stalls = stalls;
+    c->solution = count;
+    c->difficulty = 2 * c->box_distance + 3 * stalls + pushes / 2;
+    c->hash = level_hash(c, width * height);
+    c->fewest = -1;
+    c->searched = 0;
+    c->ok = on_goals <= 1 && c->box_distance > 0 &&
+            check_solution(c, width, height, witness + MAX_REVERSE_MOVES - count, count);
+}
+
+/* -x: the fewest steps and the states the search took */
+static void solve(void* arg, int index, int worker)
+{
+    Batch* batch = (Batch*)arg;
+    Candidate* c = batch->chosen[index];
+    GameContext ctx;
+    Solver solver;
+
+    if (sim_init_field(&ctx, batch->width, batch->height) < 0)
+        return;
+    memcpy(ctx.field, c->field, batch->width * batch->height);
+    ctx.sim = c->sim;
+    memcpy(ctx.box_owner, c->box_owner, sizeof(ctx.box_owner));
+    ctx.total_boxes = MAX_MIRROR_BOXES;
+    sim_rebuild_occupancy(&ctx);
+
+    c->fewest = -2;
+    if (solver_init(&solver, &ctx, batch->solve_memory[worker], batch->solve_size) == 0) {
+        SolverStatus status = solver_run(&solver, 0);
+        c->searched = solver.expanded;
+        if (status == SOLVER_SOLVED)
+            c->fewest = solver_solution_length(&solver);
+        else if (status == SOLVER_UNSOLVABLE)
+            c->fewest = -1;
+    }
+    sim_cleanup(&ctx);
+}
+
+static int by_hash(const void* a, const void* b)
+{
+    const Candidate* x = (const Candidate*)a;
+    const Candidate* y = (const Candidate*)b;
+    if (x->ok != y->ok)
+        return y->ok - x->ok;
+    return (x->hash > y->hash) - (x->hash < y->hash);
+}
+
+static int by_difficulty(const void* a, const void* b)
+{
+    const Candidate* x = *(const Candidate* const*)a;
+    const Candidate* y = *(const Candidate* const*)b;
+    if (x->difficulty != y->difficulty)
+        return x->difficulty - y->difficulty;
+    return (x->hash > y->hash) - (x->hash < y->hash);
+}
+
+/* -x ranking: fewest steps, then the search it took; levels too big for
+ * the solver's memory last, by the estimate */
+static int by_solution(const void* a, const void* b)
+{
+    const Candidate* x = *(const Candidate* const*)a;
+    const Candidate* y = *(const Candidate* const*)b;
+    if ((x->fewest < 0) != (y->fewest < 0))
+        return x->fewest < 0 ? 1 : -1;
+    if (x->fewest < 0)
+        return by_difficulty(a, b);
+    if (x->fewest != y->fewest)
+        return x->fewest - y->fewest;
+    return (x->searched > y->searched) - (x->searched < y->searched);
+}
+
+static int write_levels(const char* path, Candidate** chosen, int count, int width, int height, int exact)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+        return -1;
+
+    GameContext ctx;
+    if (sim_init_field(&ctx, width, height) < 0) {
+        fclose(f);
+        return -1;
+    }
+    char* text = (char*)malloc(level_format_size(&ctx));
+
+    fprintf(f, "; Split-Field levels from level_gen, easiest first\n");
+    for (int i = 0; text && i < count; i++) {
+        const Candidate* c = chosen[i];
+        memcpy(ctx.field, c->field, width * height);
+        ctx.sim = c->sim;
+        memcpy(ctx.box_owner, c->box_owner, sizeof(ctx.box_owner));
+        memcpy(ctx.enemy_target, c->enemy_target, sizeof(ctx.enemy_target));
+        ctx.level = i + 1;
+
+        fprintf(f, "\n; difficulty %d: box distance %d, pushes %d, mirror stalls %d, solution %d steps",
+                c->difficulty, c->box_distance, c->pushes, c->stalls, c->solution);
+        if (exact)
+            fprintf(f, "; fewest %d steps, %ld states searched", c->fewest, c->searched);
+        fprintf(f, "\n");
+        fwrite(text, 1, level_format(&ctx, text, level_format_size(&ctx)), f);
+    }
+
+    int ok = text != NULL;
+    free(text);
+    sim_cleanup(&ctx);
+    if (fclose(f) != 0)
+        ok = 0;
+    return ok ? 0 : -1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: level_gen [-n levels] [-c candidates] [-j workers] [-s seed]\n"
+                    "                 [-f WIDTHxHEIGHT] [-o FILE] [-x] [-v]\n");
+}
+
+int main(int argc, char** argv)
+{
+    int levels = DEFAULT_LEVELS, candidates = DEFAULT_CANDIDATES;
+    int workers = pool_cpu_count(), exact = 0, verbose = 0;
+    int width = DEFAULT_FIELD_WIDTH, height = DEFAULT_FIELD_HEIGHT;
+    unsigned int seed = 1;
+    const char* out = "levels.txt";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            levels = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+            candidates = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2)
+            i++;
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            out = argv[++i];
+        else if (!strcmp(argv[i], "-x"))
+            exact = 1;
+        else if (!strcmp(argv[i], "-v"))
+            verbose = 1;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (levels < 1 || candidates < levels || workers < 1 || workers > 64 ||
+        width < 8 || width > FIELD_MAX_WIDTH || height < 5 || height > FIELD_MAX_HEIGHT) {
+        usage();
+        return 2;
+    }
+
+    Batch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.width = width;
+    batch.height = height;
+    batch.seed = seed;
+    batch.candidates = (Candidate*)calloc(candidates, sizeof(Candidate));
+    unsigned char* fields = (unsigned char*)malloc((size_t)candidates * width * height);
+    Candidate** chosen = (Candidate**)malloc(candidates * sizeof(Candidate*));
+    if (!batch.candidates || !fields || !chosen) {
+        fprintf(stderr, "level_gen: out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < candidates; i++)
+        batch.candidates[i].field = fields + (size_t)i * width * height;
+
+    double t0 = now_sec();
+    if (pool_run(workers, candidates, generate, &batch, NULL) < 0) {
+        fprintf(stderr, "level_gen: out of memory\n");
+        return 1;
+    }
+    double elapsed = now_sec() - t0;
+
+    /* Valid ones first, repeats side by side */
+    qsort(batch.candidates, candidates, sizeof(Candidate), by_hash);
+    int valid = 0, distinct = 0;
+    for (int i = 0; i < candidates && batch.candidates[i].ok; i++) {
+        valid++;
+        if (i == 0 || batch.candidates[i].hash != batch.candidates[i - 1].hash)
+            chosen[distinct++] = &batch.candidates[i];
+    }
+    printf("%d candidates in %.2f s on %d workers: %.0f levels/sec, %d won by their solution, %d distinct\n",
+           candidates, elapsed, workers, candidates / elapsed, valid, distinct);
+    if (distinct < levels) {
+        fprintf(stderr, "level_gen: only %d distinct levels, wanted %d\n", distinct, levels);
+        return 1;
+    }
+
+    /* levels of them, evenly across the difficulty range */
+    qsort(chosen, distinct, sizeof(Candidate*), by_difficulty);
+    for (int i = 0; i < levels; i++)
+        chosen[i] = chosen[levels > 1 ? (long)i * (distinct - 1) / (levels - 1) : distinct - 1];
+
+    int failures = 0;
+    if (exact) {
+        batch.chosen = chosen;
+        batch.solve_size = DEFAULT_SOLVE_MEGABYTES / workers * 1024 * 1024;
+        for (int w = 0; w < workers; w++) {
+            batch.solve_memory[w] = malloc(batch.solve_size);
+            if (!batch.solve_memory[w]) {
+                fprintf(stderr, "level_gen: out of memory\n");
+                return 1;
+            }
+        }
+        t0 = now_sec();
+        pool_run(workers, levels, solve, &batch, NULL);
+        printf("solved %d levels in %.2f s\n", levels, now_sec() - t0);
+        for (int w = 0; w < workers; w++)
+            free(batch.solve_memory[w]);
+
+        for (int i = 0; i < levels; i++) {
+            if (chosen[i]->fewest == -1) {
+                printf("level %d: the solver finds no solution\n", i + 1);
+                failures++;
+            } else if (chosen[i]->fewest < 0) {
+                printf("level %d: the solver ran out of memory\n", i + 1);
+            }
+        }
+        qsort(chosen, levels, sizeof(Candidate*), by_solution);
+    }
+
+    for (int i = 0; verbose && i < levels; i++) {
+        const Candidate* c = chosen[i];
+        printf("level %3d: difficulty %3d  box distance %3d  pushes %3d  stalls %3d  solution %3d",
+               i + 1, c->difficulty, c->box_distance, c->pushes, c->stalls, c->solution);
+        if (exact)
+            printf("  fewest %3d  searched %ld", c->fewest, c->searched);
+        printf("\n");
+    }
+
+    if (write_levels(out, chosen, levels, width, height, exact) < 0) {
+        fprintf(stderr, "level_gen: cannot write %s\n", out);
+        return 1;
+    }
+    printf("%s: %d levels, difficulty %d to %d\n", out, levels, chosen[0]->difficulty, chosen[levels - 1]->difficulty);
+
+    free(chosen);
+    free(fields);
+    free(batch.candidates);
+    return failures ? 1 : 0;
+}
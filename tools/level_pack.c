@@ -0,0 +1,531 @@
+/*
+ * Split-Field Level Pack Tool (host)
+ * Builds, checks and times binary level packs:
+ *   level_pack build LEVELS PACK [-r]
+ *     pack every level of a text file (level.h format), tiles
+ *     LZ-compressed where that helps; -r stores them raw
+ *   level_pack verify LEVELS PACK
+ *     load every level of the text file from the pack too and check the
+ *     two agree tile for tile and entity for entity
+ *   level_pack bench LEVELS [-n levels]
+ *     repeat the text file's levels into packs of that many levels, raw
+ *     and compressed, and a text file of them, then load every level in a
+ *     random order from each and report the time per level
+ *   level_pack preload PACK [-t changes] [-p ms] [-s seek_us] [-k kb_per_sec]
+ *     play through the pack's levels on storage slowed to a memory stick's
+ *     speed, each for -p milliseconds of 60 Hz updates, and time every
+ *     change of level: first loading each level only when it is wanted,
+ *     then taking it from the background loader, asked for at the start
+ *     of the level before
+ */
+
+#include "sim.h"
+#include "level.h"
+#include "pack.h"
+#include "preload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_BENCH_LEVELS 10000
+
+/* preload: level changes timed, play between them, and a memory stick's
+ * seek time and transfer rate */
+#define DEFAULT_CHANGES 20
+#define DEFAULT_PLAY_MS 250
+#define DEFAULT_SEEK_US 2000
+#define DEFAULT_KB_PER_SEC 2048
+#define UPDATE_US 16683
+
+/* level_load reads the whole file each time: sample this many */
+#define TEXT_BENCH_LOADS 100
+
+/* Scratch files for bench, removed after */
+#define BENCH_RAW_PATH "level_pack_bench_raw.sfl"
+#define BENCH_LZ_PATH "level_pack_bench_lz.sfl"
+#define BENCH_TEXT_PATH "level_pack_bench.txt"
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Every well-formed level in a text file, in file order */
+static GameContext* read_levels(const char* path, int* count)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    char* text = (size >= 0 && fseek(f, 0, SEEK_SET) == 0) ? (char*)malloc(size + 1) : NULL;
+    int ok = text && fread(text, 1, size, f) == (size_t)size;
+    fclose(f);
+    if (!ok) {
+        free(text);
+        return NULL;
+    }
+
+    GameContext* levels = NULL;
+    int n = 0, capacity = 0;
+    for (int pos = 0, used;; pos += used) {
+        GameContext ctx;
+        int status = level_parse(&ctx, text + pos, (int)size - pos, &used);
+        if (status == 1)
+            break;
+        if (status < 0)
+            continue;
+        if (n == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            levels = (GameContext*)realloc(levels, capacity * sizeof(GameContext));
+            if (!levels) {
+                fprintf(stderr, "level_pack: out of memory\n");
+                exit(1);
+            }
+        }
+        levels[n++] = ctx;
+    }
+    free(text);
+
+    *count = n;
+    return levels;
+}
+
+static void free_levels(GameContext* levels, int count)
+{
+    for (int i = 0; i < count; i++)
+        sim_cleanup(&levels[i]);
+    free(levels);
+}
+
+/* Does a loaded level match the one it was packed from */
+static int same_level(const GameContext* a, const GameContext* b)
+{
+    if (a->field_width != b->field_width || a->field_height != b->field_height ||
+        a->sim.enemy_active != b->sim.enemy_active ||
+        memcmp(a->box_owner, b->box_owner, MAX_MIRROR_BOXES) != 0 ||
+        memcmp(a->field, b->field, a->field_width * a->field_height) != 0)
+        return 0;
+
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        int enemy = slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1;
+        int i = slot - ENTITY_ENEMY0;
+        if (enemy && !ENEMY_ACTIVE(a, i))
+            continue;
+        if (a->sim.x[slot] != b->sim.x[slot] || a->sim.y[slot] != b->sim.y[slot])
+            return 0;
+        if (enemy && a->enemy_target[i] != b->enemy_target[i])
+            return 0;
+    }
+    return 1;
+}
+
+static int highest_number(const GameContext* levels, int count)
+{
+    int last = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (levels[i].level > last)
+            last = levels[i].level;
+    }
+    return last;
+}
+
+static int build(const char* text_path, const char* pack_path, int compress)
+{
+    int count;
+    GameContext* levels = read_levels(text_path, &count);
+    if (!levels || count == 0) {
+        fprintf(stderr, "level_pack: no levels in %s\n", text_path);
+        free(levels);
+        return 1;
+    }
+
+    PackWriter writer;
+    int failed = pack_writer_open(&writer, pack_path, highest_number(levels, count)) < 0;
+    for (int i = 0; !failed && i < count; i++) {
+        if (pack_writer_add(&writer, &levels[i], compress) < 0) {
+            fprintf(stderr, "level_pack: cannot add level %d (repeated?)\n", levels[i].level);
+            failed = 1;
+        }
+    }
+    long raw = writer.raw_bytes, stored = writer.stored_bytes, size = writer.offset;
+    if (writer.file && pack_writer_close(&writer) < 0)
+        failed = 1;
+
+    if (failed)
+        fprintf(stderr, "level_pack: cannot write %s\n", pack_path);
+    else
+        printf("%s: %d levels, %ld bytes; tiles %ld bytes, %ld as stored\n", pack_path, count, size, raw,
+               stored);
+    free_levels(levels, count);
+    return failed;
+}
+
+static int verify(const char* text_path, const char* pack_path)
+{
+    int count;
+    GameContext* levels = read_levels(text_path, &count);
+    LevelPack pack;
+
+    if (!levels) {
+        fprintf(stderr, "level_pack: cannot read %s\n", text_path);
+        return 1;
+    }
+    if (pack_open(&pack, pack_path) < 0) {
+        printf("%s: not a level pack\n", pack_path);
+        free_levels(levels, count);
+        return 1;
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        GameContext ctx;
+        int loaded = pack_load(&pack, &ctx, levels[i].level) == 0;
+        if (!loaded || !same_level(&ctx, &levels[i])) {
+            printf("level %d: %s\n", levels[i].level, loaded ? "DIFFERS" : "cannot be loaded");
+            mismatches++;
+        }
+        if (loaded)
+            sim_cleanup(&ctx);
+    }
+    printf("%s: %d of %d levels match\n", pack_path, count - mismatches, count);
+
+    pack_close(&pack);
+    free_levels(levels, count);
+    return mismatches ? 1 : 0;
+}
+
+/* Level numbers 1 to count in a random order */
+static int* shuffled(int count)
+{
+    int* order = (int*)malloc(count * sizeof(int));
+    unsigned int random = 1;
+
+    if (!order)
+        return NULL;
+    for (int i = 0; i < count; i++)
+        order[i] = i + 1;
+    for (int i = count - 1; i > 0; i--) {
+        random = random * 1103515245u + 12345u;
+        int j = (random >> 8) % (i + 1);
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    return order;
+}
+
+static int write_pack(const char* path, GameContext* levels, int count, int total, int compress)
+{
+    PackWriter writer;
+
+    if (pack_writer_open(&writer, path, total) < 0)
+        return -1;
+    int ok = 1;
+    for (int n = 1; ok && n <= total; n++) {
+        GameContext* ctx = &levels[(n - 1) % count];
+        int level = ctx->level;
+        ctx->level = n;
+        ok = pack_writer_add(&writer, ctx, compress) == 0;
+        ctx->level = level;
+    }
+    return pack_writer_close(&writer) == 0 && ok ? 0 : -1;
+}
+
+static int write_text(const char* path, GameContext* levels, int count, int total)
+{
+    FILE* f = fopen(path, "wb");
+    char* buffer = NULL;
+    int ok = f != NULL;
+
+    for (int n = 1; ok && n <= total; n++) {
+        GameContext* ctx = &levels[(n - 1) % count];
+        int size = level_format_size(ctx);
+        char* grown = (char*)realloc(buffer, size);
+        if (!grown) {
+            ok = 0;
+            break;
+        }
+        buffer = grown;
+
+        int level = ctx->level;
+        ctx->level = n;
+        int length = level_format(ctx, buffer, size);
+        ctx->level = level;
+        ok = fwrite(buffer, 1, length, f) == (size_t)length && fputc('\n', f) != EOF;
+    }
+    free(buffer);
+    if (f && fclose(f) != 0)
+        ok = 0;
+    return ok ? 0 : -1;
+}
+
+static long file_size(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    long size = -1;
+
+    if (f && fseek(f, 0, SEEK_END) == 0)
+        size = ftell(f);
+    if (f)
+        fclose(f);
+    return size;
+}
+
+typedef struct {
+    int loads;
+    int mismatches;
+    double total;
+    double max;
+} LoadTimes;
+
+static void timed_load(LoadTimes* times, const GameContext* expected, int status_ok, double t0, GameContext* ctx)
+{
+    double took = now_sec() - t0;
+
+    times->loads++;
+    times->total += took;
+    if (took > times->max)
+        times->max = took;
+    if (!status_ok || !same_level(ctx, expected))
+        times->mismatches++;
+    if (status_ok)
+        sim_cleanup(ctx);
+}
+
+static void print_times(const char* what, const char* path, int total, const LoadTimes* times)
+{
+    long size = file_size(path);
+
+    printf("  %-26s %9ld bytes %6.1f bytes/level  %8.2f us/level mean %8.2f us max\n", what, size,
+           (double)size / total, times->total / times->loads * 1e6, times->max * 1e6);
+}
+
+/* Every level in order from one open pack, then every level opening the
+ * pack afresh as the game does */
+static int bench_pack(const char* what, const char* path, GameContext* levels, int count, const int* order,
+                      int total)
+{
+    LoadTimes held = { 0 }, opened = { 0 };
+    LevelPack pack;
+    GameContext ctx;
+    char label[64];
+
+    if (pack_open(&pack, path) < 0)
+        return 1;
+    for (int i = 0; i < total; i++) {
+        int n = order[i];
+        double t0 = now_sec();
+        int ok = pack_load(&pack, &ctx, n) == 0;
+        timed_load(&held, &levels[(n - 1) % count], ok, t0, &ctx);
+    }
+    pack_close(&pack);
+
+    for (int i = 0; i < total; i++) {
+        int n = order[i];
+        double t0 = now_sec();
+        int ok = pack_load_file(&ctx, path, n) == 0;
+        timed_load(&opened, &levels[(n - 1) % count], ok, t0, &ctx);
+    }
+
+    snprintf(label, sizeof(label), "%s, pack open:", what);
+    print_times(label, path, total, &held);
+    snprintf(label, sizeof(label), "%s, opened each load:", what);
+    print_times(label, path, total, &opened);
+    return held.mismatches + opened.mismatches;
+}
+
+static int bench(const char* text_path, int total)
+{
+    int count;
+    GameContext* levels = read_levels(text_path, &count);
+    if (!levels || count == 0) {
+        fprintf(stderr, "level_pack: no levels in %s\n", text_path);
+        free(levels);
+        return 1;
+    }
+    int* order = shuffled(total);
+    if (!order) {
+        fprintf(stderr, "level_pack: out of memory\n");
+        return 1;
+    }
+
+    if (write_pack(BENCH_RAW_PATH, levels, count, total, 0) < 0 ||
+        write_pack(BENCH_LZ_PATH, levels, count, total, 1) < 0 ||
+        write_text(BENCH_TEXT_PATH, levels, count, total) < 0) {
+        fprintf(stderr, "level_pack: cannot write the bench files\n");
+        return 1;
+    }
+
+    printf("%d levels (%d from %s, repeated), %dx%d first, loaded in a random order:\n", total, count,
+           text_path, levels[0].field_width, levels[0].field_height);
+    int mismatches = bench_pack("raw", BENCH_RAW_PATH, levels, count, order, total);
+    mismatches += bench_pack("LZ", BENCH_LZ_PATH, levels, count, order, total);
+
+    /* The text file is parsed from the top on every load */
+    LoadTimes text = { 0 };
+    int loads = total < TEXT_BENCH_LOADS ? total : TEXT_BENCH_LOADS;
+    for (int i = 0; i < loads; i++) {
+        GameContext ctx;
+        int n = order[i];
+        double t0 = now_sec();
+        int ok = level_load(&ctx, BENCH_TEXT_PATH, n) == 0;
+        timed_load(&text, &levels[(n - 1) % count], ok, t0, &ctx);
+    }
+    mismatches += text.mismatches;
+    print_times("text, level_load:", BENCH_TEXT_PATH, total, &text);
+    printf("mismatches: %d\n", mismatches);
+
+    remove(BENCH_RAW_PATH);
+    remove(BENCH_LZ_PATH);
+    remove(BENCH_TEXT_PATH);
+    free(order);
+    free_levels(levels, count);
+    return mismatches ? 1 : 0;
+}
+
+/* A level played for play_ms: updates with no input, at 60 a second */
+static void play(GameContext* ctx, int play_ms)
+{
+    struct timespec frame = { 0, UPDATE_US * 1000L };
+
+    for (int elapsed = 0; elapsed < play_ms * 1000 && ctx->sim.state == GAME_RUNNING; elapsed += UPDATE_US) {
+        sim_step(ctx, 0);
+        nanosleep(&frame, NULL);
+    }
+}
+
+/* Level changes one way or the other: each level played, then the next
+ * taken from the loader, asked for ahead or not */
+static int changes(int count, int level_count, int play_ms, int ahead, LoadTimes* times)
+{
+    GameContext ctx;
+
+    if (preload_take(&ctx, 1) < 0)
+        return -1;
+    for (int i = 1; i <= count; i++) {
+        int next = i % level_count + 1;
+        if (ahead)
+            preload_request(next);
+        play(&ctx, play_ms);
+
+        double t0 = now_sec();
+        sim_cleanup(&ctx);
+        if (preload_take(&ctx, next) < 0)
+            return -1;
+        double took = now_sec() - t0;
+        times->loads++;
+        times->total += took;
+        if (took > times->max)
+            times->max = took;
+    }
+    sim_cleanup(&ctx);
+    return 0;
+}
+
+static int preload(const char* path, int count, int play_ms, unsigned int seek_us, unsigned int kb_per_sec)
+{
+    LoadTimes blocking = { 0 }, ahead = { 0 };
+
+    preload_set_storage(seek_us, kb_per_sec);
+    if (preload_init(path) < 0) {
+        printf("%s: not a level pack\n", path);
+        return 1;
+    }
+    int level_count = preload_count();
+
+    int failed = changes(count, level_count, play_ms, 0, &blocking) < 0;
+    failed = failed || changes(count, level_count, play_ms, 1, &ahead) < 0;
+    const PreloadStats* stats = preload_stats();
+
+    if (failed) {
+        printf("%s: a level could not be loaded\n", path);
+    } else {
+        printf("%s: %d level changes, %d ms of play each; storage %u us a seek, %u KB/s\n", path, count, play_ms,
+               seek_us, kb_per_sec);
+        printf("  loaded when wanted:  %8.0f us/change mean %8.0f us max\n", blocking.total / count * 1e6,
+               blocking.max * 1e6);
+        printf("  preloaded:           %8.0f us/change mean %8.0f us max  (%u of %d ready in time)\n",
+               ahead.total / count * 1e6, ahead.max * 1e6, stats->ready, count);
+        printf("  background loads:    %8u us the last  %8u us the longest\n", stats->load_us,
+               stats->max_load_us);
+    }
+    preload_shutdown();
+    return failed;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: level_pack build LEVELS PACK [-r]\n"
+                    "       level_pack verify LEVELS PACK\n"
+                    "       level_pack bench LEVELS [-n levels]\n"
+                    "       level_pack preload PACK [-t changes] [-p ms] [-s seek_us] [-k kb_per_sec]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+
+    if (!strcmp(argv[1], "build")) {
+        if (argc == 4)
+            return build(argv[2], argv[3], 1);
+        if (argc == 5 && !strcmp(argv[4], "-r"))
+            return build(argv[2], argv[3], 0);
+        usage();
+        return 2;
+    }
+
+    if (!strcmp(argv[1], "verify") && argc == 4)
+        return verify(argv[2], argv[3]);
+
+    if (!strcmp(argv[1], "bench")) {
+        int levels = DEFAULT_BENCH_LEVELS;
+        if (argc == 5 && !strcmp(argv[3], "-n"))
+            levels = atoi(argv[4]);
+        else if (argc != 3) {
+            usage();
+            return 2;
+        }
+        if (levels < 1) {
+            usage();
+            return 2;
+        }
+        return bench(argv[2], levels);
+    }
+
+    if (!strcmp(argv[1], "preload")) {
+        int count = DEFAULT_CHANGES, play_ms = DEFAULT_PLAY_MS;
+        unsigned int seek_us = DEFAULT_SEEK_US, kb_per_sec = DEFAULT_KB_PER_SEC;
+        for (int i = 3; i < argc; i++) {
+            if (!strcmp(argv[i], "-t") && i + 1 < argc)
+                count = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+                play_ms = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+                seek_us = (unsigned int)strtoul(argv[++i], NULL, 0);
+            else if (!strcmp(argv[i], "-k") && i + 1 < argc)
+                kb_per_sec = (unsigned int)strtoul(argv[++i], NULL, 0);
+            else {
+                usage();
+                return 2;
+            }
+        }
+        if (count < 1 || play_ms < 0) {
+            usage();
+            return 2;
+        }
+        return preload(argv[2], count, play_ms, seek_us, kb_per_sec);
+    }
+
+    usage();
+    return 2;
+}
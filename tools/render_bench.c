@@ -0,0 +1,442 @@
+/*
+ * Split-Field Render Benchmark (host)
+ * Measures fill throughput of the render kernels against a plain memory
+ * framebuffer and checks them pixel-for-pixel against the original
+ * per-pixel draw_rect, checks the word kernels against their scalar
+ * reference, compares atlas tile blits with drawing each tile
+ * as fill plus border, compares cached HUD text with per-character
+ * debug-screen drawing, then checks page-flip ordering against the
+ * memory-backed display.
+ */
+
+#include "render.h"
+#include "display.h"
+#include "atlas.h"
+#include "hud.h"
+#include "kernel_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_WIDTH 480
+#define BENCH_HEIGHT 272
+#define BENCH_STRIDE 512
+#define BENCH_FRAMES 2000
+
+typedef struct {
+    int x, y, w, h;
+    unsigned int argb;
+} RectOp;
+
+#define MAX_OPS 4096
+static RectOp ops[MAX_OPS];
+static int op_count = 0;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Original draw_rect from game.c, retargeted at a memory buffer */
+static void reference_draw_rect(void* vram_base, int buffer_width, int pixel_format,
+                                int x, int y, int w, int h, unsigned int color)
+{
+    if (pixel_format == RENDER_FORMAT_8888) {
+        unsigned int* vram = (unsigned int*)vram_base;
+        for (int dy = 0; dy < h; dy++) {
+            int py = y + dy;
+            if (py < 0 || py >= BENCH_HEIGHT) continue;
+            for (int dx = 0; dx < w; dx++) {
+                int px = x + dx;
+                if (px < 0 || px >= BENCH_WIDTH) continue;
+                unsigned int a = (color >> 24) & 0xFF;
+                unsigned int r = (color >> 16) & 0xFF;
+                unsigned int g = (color >> 8) & 0xFF;
+                unsigned int b = color & 0xFF;
+                vram[py * buffer_width + px] = (a << 24) | (b << 16) | (g << 8) | r;
+            }
+        }
+    } else {
+        unsigned short* vram = (unsigned short*)vram_base;
+        unsigned char r = (color >> 16) & 0xFF;
+        unsigned char g = (color >> 8) & 0xFF;
+        unsigned char b = color & 0xFF;
+        unsigned short rgb565 = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+
+        for (int dy = 0; dy < h; dy++) {
+            int py = y + dy;
+            if (py < 0 || py >= BENCH_HEIGHT) continue;
+            for (int dx = 0; dx < w; dx++) {
+                int px = x + dx;
+                if (px < 0 || px >= BENCH_WIDTH) continue;
+                vram[py * buffer_width + px] = rgb565;
+            }
+        }
+    }
+}
+
+static void add_op(int x, int y, int w, int h, unsigned int argb)
+{
+    if (op_count < MAX_OPS) {
+        RectOp* op = &ops[op_count++];
+        op->x = x;
+        op->y = y;
+        op->w = w;
+        op->h = h;
+        op->argb = argb;
+    }
+}
+
+static void add_outline(int x, int y, int size, unsigned int argb)
+{
+    add_op(x, y, size, 1, argb);
+    add_op(x, y + size - 1, size, 1, argb);
+    add_op(x, y, 1, size, argb);
+    add_op(x + size - 1, y, 1, size, argb);
+}
+
+/* Same draw sequence game_render issues for a full 20x14 field */
+static void build_scene(void)
+{
+    const int tile = 16;
+    const int off_x = (BENCH_WIDTH - 20 * tile) / 2;
+    const int off_y = (BENCH_HEIGHT - 14 * tile) / 2;
+
+    op_count = 0;
+    for (int y = 0; y < 14; y++) {
+        for (int x = 0; x < 20; x++) {
+            int wall = (x == 0 || x == 19 || y == 0 || y == 13 || x == 10);
+            add_op(off_x + x * tile, off_y + y * tile, tile, tile, wall ? 0xFF666666 : 0xFF101010);
+            if (wall)
+                add_outline(off_x + x * tile, off_y + y * tile, tile, 0xFF000000);
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        int sx = off_x + (3 + i * 2) * tile;
+        int sy = off_y + (3 + i) * tile;
+        add_op(sx + 2, sy + 2, tile - 4, tile - 4, 0xFFFF4444);
+        add_outline(sx + 2, sy + 2, tile - 4, 0xFF000000);
+    }
+
+    /* Partially and fully off-screen rectangles exercise the clipper */
+    add_op(-8, -8, 40, 40, 0xFF4488FF);
+    add_op(BENCH_WIDTH - 7, 100, 30, 13, 0xFF996633);
+    add_op(200, BENCH_HEIGHT - 3, 17, 20, 0xFF9966FF);
+    add_op(-50, 10, 20, 20, 0xFFFFFF00);
+    add_op(3, 5, 0, 9, 0xFF00FF00);
+    add_op(BENCH_WIDTH - 1, BENCH_HEIGHT - 1, 1, 1, 0xFF880000);
+}
+
+static long scene_pixels(void)
+{
+    long total = 0;
+    for (int i = 0; i < op_count; i++) {
+        int x0 = ops[i].x < 0 ? 0 : ops[i].x;
+        int y0 = ops[i].y < 0 ? 0 : ops[i].y;
+        int x1 = ops[i].x + ops[i].w > BENCH_WIDTH ? BENCH_WIDTH : ops[i].x + ops[i].w;
+        int y1 = ops[i].y + ops[i].h > BENCH_HEIGHT ? BENCH_HEIGHT : ops[i].y + ops[i].h;
+        if (x1 > x0 && y1 > y0)
+            total += (long)(x1 - x0) * (y1 - y0);
+    }
+    return total;
+}
+
+static void draw_reference(void* buf, int format)
+{
+    for (int i = 0; i < op_count; i++)
+        reference_draw_rect(buf, BENCH_STRIDE, format, ops[i].x, ops[i].y, ops[i].w, ops[i].h, ops[i].argb);
+}
+
+static void draw_kernels(const RenderTarget* rt)
+{
+    /* The palette conversion happens once per colour, not per pixel */
+    for (int i = 0; i < op_count; i++) {
+        unsigned int pixel = render_convert_color(ops[i].argb, rt->format);
+        render_fill_rect(rt, ops[i].x, ops[i].y, ops[i].w, ops[i].h, pixel);
+    }
+}
+
+static int bench_format(int format, const char* name)
+{
+    size_t size = (size_t)BENCH_STRIDE * BENCH_HEIGHT * render_bytes_per_pixel(format);
+    void* ref = malloc(size);
+    void* fast = malloc(size);
+    RenderTarget rt;
+
+    if (!ref || !fast) {
+        free(ref);
+        free(fast);
+        return 1;
+    }
+
+    memset(ref, 0x5A, size);
+    memset(fast, 0x5A, size);
+    render_target_init(&rt, fast, BENCH_STRIDE, format, BENCH_WIDTH, BENCH_HEIGHT);
+
+    draw_reference(ref, format);
+    draw_kernels(&rt);
+    int match = (memcmp(ref, fast, size) == 0);
+
+    long pixels = scene_pixels() * BENCH_FRAMES;
+
+    double t0 = now_sec();
+    for (int f = 0; f < BENCH_FRAMES; f++)
+        draw_reference(ref, format);
+    double t_ref = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int f = 0; f < BENCH_FRAMES; f++)
+        draw_kernels(&rt);
+    double t_fast = now_sec() - t0;
+
+    printf("%-5s  pixel-exact: %-3s  reference: %8.1f Mpix/s  kernels: %8.1f Mpix/s  (x%.1f)\n",
+           name, match ? "yes" : "NO",
+           pixels / t_ref / 1e6, pixels / t_fast / 1e6, t_ref / t_fast);
+
+    free(ref);
+    free(fast);
+    return match ? 0 : 1;
+}
+
+/* Previous per-tile path: one fill plus four outline fills */
+static void draw_look_fills(const RenderTarget* rt, const RenderPalette* pal, TileLook look, int x, int y)
+{
+    const TileLookDesc* desc = atlas_look_desc(look);
+    int size = ATLAS_TILE_SIZE - 2 * desc->inset;
+
+    render_fill_rect(rt, x + desc->inset, y + desc->inset, size, size, pal->pixel[desc->fill]);
+    if (desc->bordered)
+        render_rect_outline(rt, x + desc->inset, y + desc->inset, size, pal->pixel[desc->border]);
+}
+
+/* Full 20x14 field, every look in turn, one tile per cell */
+static void draw_tiles(const RenderTarget* rt, const RenderPalette* pal, const TileAtlas* atlas)
+{
+    const int off_x = (BENCH_WIDTH - 20 * ATLAS_TILE_SIZE) / 2;
+    const int off_y = (BENCH_HEIGHT - 14 * ATLAS_TILE_SIZE) / 2;
+
+    for (int y = 0; y < 14; y++) {
+        for (int x = 0; x < 20; x++) {
+            TileLook look = (TileLook)((y * 20 + x) % LOOK_COUNT);
+            int sx = off_x + x * ATLAS_TILE_SIZE;
+            int sy = off_y + y * ATLAS_TILE_SIZE;
+            if (atlas)
+                atlas_blit(atlas, rt, look, sx, sy);
+            else
+                draw_look_fills(rt, pal, look, sx, sy);
+        }
+    }
+}
+
+static int bench_tiles(int format, const char* name)
+{
+    size_t size = (size_t)BENCH_STRIDE * BENCH_HEIGHT * render_bytes_per_pixel(format);
+    void* fills = calloc(1, size);
+    void* blits = calloc(1, size);
+    static TileAtlas atlas;
+    RenderPalette pal;
+    RenderTarget rt_fills, rt_blits;
+
+    if (!fills || !blits) {
+        free(fills);
+        free(blits);
+        return 1;
+    }
+
+    render_palette_init(&pal, format);
+    atlas_bake(&atlas, format);
+    render_target_init(&rt_fills, fills, BENCH_STRIDE, format, BENCH_WIDTH, BENCH_HEIGHT);
+    render_target_init(&rt_blits, blits, BENCH_STRIDE, format, BENCH_WIDTH, BENCH_HEIGHT);
+
+    draw_tiles(&rt_fills, &pal, NULL);
+    draw_tiles(&rt_blits, &pal, &atlas);
+    int match = (memcmp(fills, blits, size) == 0);
+
+    double tiles = 20.0 * 14 * BENCH_FRAMES;
+
+    double t0 = now_sec();
+    for (int f = 0; f < BENCH_FRAMES; f++)
+        draw_tiles(&rt_fills, &pal, NULL);
+    double t_fills = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int f = 0; f < BENCH_FRAMES; f++)
+        draw_tiles(&rt_blits, &pal, &atlas);
+    double t_blits = now_sec() - t0;
+
+    printf("tiles %-5s  pixel-exact: %-3s  fill+border: %7.2f Mtiles/s  atlas: %7.2f Mtiles/s  (x%.1f)\n",
+           name, match ? "yes" : "NO",
+           tiles / t_fills / 1e6, tiles / t_blits / 1e6, t_fills / t_blits);
+
+    free(fills);
+    free(blits);
+    return match ? 0 : 1;
+}
+
+/* Stand-in for the PSP's msx font: any bit pattern exercises the same paths */
+static unsigned char bench_font[256 * 8];
+
+/* The in-game HUD: title, instructions and a state banner */
+static const struct {
+    int col, row;
+    const char* text;
+} hud_lines[] = {
+    { 15, 0, "SPLIT-FIELD - Level 1" },
+    { 2, 31, "P1(Red) D-PAD | P2(Blue) ABXO | YELLOW=Barrier" },
+    { 2, 32, "Orange boxes=P1 | Blue boxes=P2 | MIRROR MOVES!" },
+    { 2, 33, "Push to GREEN goals | Avoid moving RED enemies | SELECT:Quit" },
+    { 22, 15, "*** GAME OVER! ***" }
+};
+#define HUD_LINES ((int)(sizeof(hud_lines) / sizeof(hud_lines[0])))
+
+/* pspDebugScreenPrintf's per-pixel glyph loop, retargeted at a memory buffer */
+static void reference_print(void* buf, int format, int col, int row, const char* text)
+{
+    unsigned int fg = render_convert_color(0xFFFFFFFF, format);
+    unsigned int bg = render_convert_color(0x00000000, format);
+
+    for (int i = 0; text[i]; i++) {
+        const unsigned char* font = bench_font + (unsigned char)text[i] * 8;
+        int x0 = (col + i) * 7;
+        int y0 = row * 8;
+
+        for (int y = 0; y < 8; y++) {
+            for (int x = 0; x < 8; x++) {
+                unsigned int c = (font[y] & (0x80 >> x)) ? fg : bg;
+                int offset = (y0 + y) * BENCH_STRIDE + x0 + x;
+                if (format == RENDER_FORMAT_8888)
+                    ((unsigned int*)buf)[offset] = c;
+                else
+                    ((unsigned short*)buf)[offset] = (unsigned short)c;
+            }
+        }
+    }
+}
+
+static void draw_hud(const RenderTarget* rt, HudText* texts)
+{
+    for (int i = 0; i < HUD_LINES; i++) {
+        hud_text_set(&texts[i], hud_lines[i].text, rt->format);
+        hud_text_draw(&texts[i], rt, hud_lines[i].col, hud_lines[i].row);
+    }
+}
+
+static int bench_hud(int format, const char* name)
+{
+    size_t size = (size_t)BENCH_STRIDE * BENCH_HEIGHT * render_bytes_per_pixel(format);
+    void* ref = calloc(1, size);
+    void* cached = calloc(1, size);
+    static HudText texts[HUD_LINES];
+    RenderTarget rt;
+
+    if (!ref || !cached) {
+        free(ref);
+        free(cached);
+        return 1;
+    }
+
+    for (int i = 0; i < (int)sizeof(bench_font); i++)
+        bench_font[i] = (unsigned char)(i * 2654435761u >> 13);
+    hud_init(bench_font);
+    render_target_init(&rt, cached, BENCH_STRIDE, format, BENCH_WIDTH, BENCH_HEIGHT);
+
+    for (int i = 0; i < HUD_LINES; i++)
+        reference_print(ref, format, hud_lines[i].col, hud_lines[i].row, hud_lines[i].text);
+    draw_hud(&rt, texts);
+    int match = (memcmp(ref, cached, size) == 0);
+
+    /* Erase must leave the buffer as it was before any text */
+    hud_erase(&rt);
+    void* blank = calloc(1, size);
+    int erased = blank && memcmp(blank, cached, size) == 0;
+    free(blank);
+
+    double t0 = now_sec();
+    for (int f = 0; f < BENCH_FRAMES; f++)
+        for (int i = 0; i < HUD_LINES; i++)
+            reference_print(ref, format, hud_lines[i].col, hud_lines[i].row, hud_lines[i].text);
+    double t_ref = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int f = 0; f < BENCH_FRAMES; f++)
+        draw_hud(&rt, texts);
+    double t_cached = now_sec() - t0;
+
+    const HudStats* stats = hud_stats();
+    printf("hud   %-5s  pixel-exact: %-3s  erased: %-3s  putchar: %7.2f us/frame  cached: %7.2f us/frame  (x%.1f)  renders: %u\n",
+           name, match ? "yes" : "NO", erased ? "yes" : "NO",
+           t_ref / BENCH_FRAMES * 1e6, t_cached / BENCH_FRAMES * 1e6, t_ref / t_cached,
+           stats->text_renders);
+
+    free(ref);
+    free(cached);
+    return (match && erased) ? 0 : 1;
+}
+
+/* The buffer being drawn is never on screen, and the frames that reach
+ * the screen appear in submission order */
+static int bench_flips(int buffers, int pace)
+{
+    DisplayConfig config = { buffers, RENDER_FORMAT_8888 };
+    RenderTarget rt;
+    unsigned int shown = 0;
+    int ok = 1;
+
+    if (display_init(&config) < 0)
+        return 1;
+
+    for (unsigned int frame = 1; frame <= 240; frame++) {
+        if (display_begin_frame(&rt) < 0) {
+            ok = 0;
+            break;
+        }
+        if (buffers > 1 && display_back_index() == display_front_index())
+            ok = 0;
+
+        *(unsigned int*)rt.base = frame;
+        display_flip(pace);
+
+        unsigned int on_screen = *(unsigned int*)display_buffer(display_front_index());
+        if (on_screen < shown || (pace && on_screen != frame))
+            ok = 0;
+        shown = on_screen;
+    }
+
+    const DisplayStats* stats = display_stats();
+    printf("flip: %d buffer(s) %-7s order: %-3s  flips: %u  dropped: %u  waits: %u\n",
+           buffers, pace ? "paced" : "unpaced", ok ? "ok" : "BAD",
+           stats->flips, stats->dropped, stats->vblank_waits);
+
+    display_shutdown();
+    return ok ? 0 : 1;
+}
+
+static void print_line(const char* line)
+{
+    printf("%s\n", line);
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    build_scene();
+    printf("fill: %d rects, %ld pixels per frame, %d frames\n", op_count, scene_pixels(), BENCH_FRAMES);
+    failures += bench_format(RENDER_FORMAT_8888, "8888");
+    failures += bench_format(RENDER_FORMAT_565, "565");
+    failures += kernel_bench_run(print_line);
+    failures += bench_tiles(RENDER_FORMAT_8888, "8888");
+    failures += bench_tiles(RENDER_FORMAT_565, "565");
+    failures += bench_hud(RENDER_FORMAT_8888, "8888");
+    failures += bench_hud(RENDER_FORMAT_565, "565");
+
+    for (int buffers = 1; buffers <= DISPLAY_MAX_BUFFERS; buffers++) {
+        failures += bench_flips(buffers, 1);
+        failures += bench_flips(buffers, 0);
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,499 @@
+/*
+ * Split-Field Batch Simulator (host)
+ * Plays many games at once for level validation and regression sweeps:
+ * every level given against every input script given, spread over all
+ * cores by the work pool. Levels come from text level files and level
+ * packs, every level in each; scripts from input recordings (.sfr), whose
+ * inputs are played as recorded on each level. -g adds the stock level
+ * and a set of generated fields, and -r that many seeded random scripts.
+ * Each level is read once and kept as text, and each game parses its own
+ * context from it, so workers share nothing but read-only jobs and write
+ * only their own results. Reports each level's wins, losses and timeouts
+ * and the ticks per second of the whole batch; -s repeats the batch on 1,
+ * 2, 4... workers to show how it scales and that the outcomes do not
+ * depend on the worker count.
+ */
+
+#include "sim.h"
+#include "level_table.h"
+#include "level.h"
+#include "pack.h"
+#include "replay.h"
+#include "work_pool.h"
+#include "bench_levels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_TICK_LIMIT 3600  /* A minute at 60 updates a second */
+
+/* Presses come every PRESS_INTERVAL ticks, which clears the move delay,
+ * and a player keeps a direction for HOLD_PRESSES of them */
+#define PRESS_INTERVAL 6
+#define HOLD_PRESSES 4
+
+/* How a game ended; OUTCOME_TIMEOUT if it was still running at the limit,
+ * OUTCOME_ERROR if its level could not be set up */
+enum {
+    OUTCOME_WIN,
+    OUTCOME_LOSE,
+    OUTCOME_QUIT,
+    OUTCOME_TIMEOUT,
+    OUTCOME_ERROR,
+    OUTCOME_COUNT
+};
+
+static const char* const outcome_names[OUTCOME_COUNT] = { "win", "lose", "quit", "timeout", "error" };
+
+/* A level of -g: the stock one (size 0), or a square field of size with
+ * scattered walls, built from seed */
+typedef struct {
+    const char* name;
+    int size;
+    int wall_percent;
+    unsigned int seed;
+} LevelSpec;
+
+static const LevelSpec generated[] = {
+    { "stock",   0,   0, 0 },
+    { "open32",  32,  5, 1 },
+    { "walls32", 32,  20, 2 },
+    { "open64",  64,  5, 3 },
+    { "walls128", 128, 20, 4 },
+};
+
+#define GENERATED_COUNT ((int)(sizeof(generated) / sizeof(generated[0])))
+
+/* A level of the batch, as level_format writes it */
+typedef struct {
+    char name[64];
+    char* text;
+    int size;
+} Level;
+
+/* An input script: a recording's inputs, or random presses from seed */
+typedef struct {
+    char name[64];
+    Replay replay;
+    int recorded;
+    unsigned int seed;
+} Script;
+
+/* One game: a level against a script */
+typedef struct {
+    int level;
+    int script;
+    int ticks;
+    int outcome;
+} Run;
+
+typedef struct {
+    const Level* levels;
+    const Script* scripts;
+    Run* runs;
+    int tick_limit;
+} Batch;
+
+/* The levels and scripts read so far */
+static Level* levels;
+static int level_count;
+static Script* scripts;
+static int script_count;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The stock level, or spec's field from bench_level */
+static int generate_level(GameContext* ctx, const LevelSpec* spec)
+{
+    if (spec->size == 0) {
+        sim_init(ctx);
+        return ctx->sim.state == GAME_RUNNING ? 0 : -1;
+    }
+    return bench_level(ctx, spec->size, spec->size, spec->wall_percent, spec->seed);
+}
+
+/* Input of tick from a random script: each player presses a random
+ * direction now and then and keeps to it for a few presses */
+static SimInput random_input(unsigned int* random, int tick, int* dir1, int* dir2)
+{
+    static const SimInput p1[4] = { INPUT_P1_UP, INPUT_P1_DOWN, INPUT_P1_LEFT, INPUT_P1_RIGHT };
+    static const SimInput p2[4] = { INPUT_P2_UP, INPUT_P2_DOWN, INPUT_P2_LEFT, INPUT_P2_RIGHT };
+
+    if (tick % PRESS_INTERVAL)
+        return 0;
+    if (tick % (PRESS_INTERVAL * HOLD_PRESSES) == 0) {
+        unsigned int r = bench_random(random);
+        *dir1 = r & 3;
+        *dir2 = (r >> 2) & 3;
+    }
+    return p1[*dir1] | p2[*dir2];
+}
+
+static void run_game(void* arg, int index, int worker)
+{
+    Batch* batch = (Batch*)arg;
+    Run* run = &batch->runs[index];
+    const Level* level = &batch->levels[run->level];
+    const Script* script = &batch->scripts[run->script];
+    GameContext ctx;
+    unsigned int random = script->seed * 2246822519u + 1;
+    int dir1 = 0, dir2 = 0, tick = 0;
+    int limit = batch->tick_limit;
+    int segment = 0, used = 0;
+
+    (void)worker;
+    if (level_parse(&ctx, level->text, level->size, NULL) != 0) {
+        run->ticks = 0;
+        run->outcome = OUTCOME_ERROR;
+        return;
+    }
+
+    /* A recording plays its inputs to their end, on whatever level, set
+     * up as it was */
+    if (script->recorded && script->replay.ticks < (unsigned int)limit)
+        limit = (int)script->replay.ticks;
+    if (script->recorded && (script->replay.flags & REPLAY_NO_ENEMIES)) {
+        ctx.sim.enemy_active = 0;
+        sim_rebuild_occupancy(&ctx);
+    }
+
+    while (tick < limit && ctx.sim.state == GAME_RUNNING) {
+        SimInput input;
+        if (script->recorded) {
+            const ReplayRun* runs = script->replay.runs;
+            if (used == runs[segment].ticks) {
+                segment++;
+                used = 0;
+            }
+            input = runs[segment].input;
+            used++;
+        } else {
+            input = random_input(&random, tick, &dir1, &dir2);
+        }
+        sim_step(&ctx, input);
+        tick++;
+    }
+
+    run->ticks = tick;
+    switch (ctx.sim.state) {
+    case GAME_WIN:  run->outcome = OUTCOME_WIN; break;
+    case GAME_LOSE: run->outcome = OUTCOME_LOSE; break;
+    case GAME_QUIT: run->outcome = OUTCOME_QUIT; break;
+    default:        run->outcome = OUTCOME_TIMEOUT; break;
+    }
+    sim_cleanup(&ctx);
+}
+
+/* Keep ctx's level as text under name; cleans ctx up */
+static int add_level(GameContext* ctx, const char* name)
+{
+    Level* grown = realloc(levels, (level_count + 1) * sizeof(Level));
+    if (!grown) {
+        fprintf(stderr, "sim_batch: out of memory\n");
+        sim_cleanup(ctx);
+        return -1;
+    }
+    levels = grown;
+
+    Level* level = &levels[level_count];
+    int size = level_format_size(ctx);
+    level->text = malloc(size);
+    level->size = level->text ? level_format(ctx, level->text, size) : -1;
+    sim_cleanup(ctx);
+    if (level->size < 0) {
+        fprintf(stderr, "sim_batch: out of memory\n");
+        free(level->text);
+        return -1;
+    }
+    snprintf(level->name, sizeof(level->name), "%s", name);
+    level_count++;
+    return 0;
+}
+
+static Script* add_script(const char* name)
+{
+    Script* grown = realloc(scripts, (script_count + 1) * sizeof(Script));
+    if (!grown)
+        return NULL;
+    scripts = grown;
+
+    Script* script = &scripts[script_count++];
+    memset(script, 0, sizeof(Script));
+    snprintf(script->name, sizeof(script->name), "%s", name);
+    return script;
+}
+
+/* A recording is a script; a pack or a text level file adds every level
+ * in it */
+static int add_file(const char* path)
+{
+    GameContext ctx;
+    LevelPack pack;
+    char name[64];
+    Replay replay;
+
+    replay_init(&replay, 0);
+    if (replay_load(&replay, path) == 0) {
+        if (replay.run_count == 0) {
+            fprintf(stderr, "sim_batch: %s: no inputs\n", path);
+            replay_free(&replay);
+            return -1;
+        }
+        Script* script = add_script(path);
+        if (!script) {
+            fprintf(stderr, "sim_batch: out of memory\n");
+            replay_free(&replay);
+            return -1;
+        }
+        script->replay = replay;
+        script->recorded = 1;
+        return 0;
+    }
+    replay_free(&replay);
+
+    if (pack_open(&pack, path) == 0) {
+        for (int n = 1; n <= pack.count; n++) {
+            snprintf(name, sizeof(name), "%s:%d", path, n);
+            if (pack_load(&pack, &ctx, n) < 0) {
+                fprintf(stderr, "sim_batch: %s: cannot load the level\n", name);
+                pack_close(&pack);
+                return -1;
+            }
+            if (add_level(&ctx, name) < 0) {
+                pack_close(&pack);
+                return -1;
+            }
+        }
+        pack_close(&pack);
+        return 0;
+    }
+
+    int last = level_file_last(path);
+    if (last == 0) {
+        fprintf(stderr, "sim_batch: %s: not a recording, level pack or level file\n", path);
+        return -1;
+    }
+    for (int n = 1; n <= last; n++) {
+        snprintf(name, sizeof(name), "%s:%d", path, n);
+        if (level_load(&ctx, path, n) < 0) {
+            fprintf(stderr, "sim_batch: %s: cannot load the level\n", name);
+            return -1;
+        }
+        if (add_level(&ctx, name) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int add_generated(void)
+{
+    GameContext ctx;
+
+    for (int i = 0; i < GENERATED_COUNT; i++) {
+        if (generate_level(&ctx, &generated[i]) < 0) {
+            fprintf(stderr, "sim_batch: cannot build %s\n", generated[i].name);
+            return -1;
+        }
+        if (add_level(&ctx, generated[i].name) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int add_random(int count)
+{
+    char name[64];
+
+    for (int i = 1; i <= count; i++) {
+        snprintf(name, sizeof(name), "random %d", i);
+        Script* script = add_script(name);
+        if (!script)
+            return -1;
+        script->seed = i;
+    }
+    return 0;
+}
+
+/* Play every run on workers threads; returns the wall time taken */
+static double run_batch(Batch* batch, int count, int workers, PoolStats* stats)
+{
+    double t0 = now_sec();
+    if (pool_run(workers, count, run_game, batch, stats) < 0)
+        return -1;
+    return now_sec() - t0;
+}
+
+static long long total_ticks(const Run* runs, int count)
+{
+    long long ticks = 0;
+    for (int i = 0; i < count; i++)
+        ticks += runs[i].ticks;
+    return ticks;
+}
+
+/* Returns the games whose level could not be set up */
+static int report_levels(const Run* runs, int count)
+{
+    int errors = 0;
+
+    for (int l = 0; l < level_count; l++) {
+        int outcomes[OUTCOME_COUNT] = { 0 };
+        long long ticks = 0;
+        int games = 0;
+
+        for (int i = 0; i < count; i++) {
+            if (runs[i].level != l)
+                continue;
+            outcomes[runs[i].outcome]++;
+            ticks += runs[i].ticks;
+            games++;
+        }
+        printf("%-20s  games: %5d  win: %5d  lose: %5d  quit: %5d  timeout: %5d  error: %5d  mean ticks: %7.1f\n",
+               levels[l].name, games, outcomes[OUTCOME_WIN], outcomes[OUTCOME_LOSE],
+               outcomes[OUTCOME_QUIT], outcomes[OUTCOME_TIMEOUT], outcomes[OUTCOME_ERROR],
+               games ? (double)ticks / games : 0.0);
+        errors += outcomes[OUTCOME_ERROR];
+    }
+    return errors;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: sim_batch [-j workers] [-t tick limit] [-g] [-r scripts] [-s] [-v] [FILE...]\n"
+                    "  FILE  a recording (.sfr) to play on every level, or a level pack or\n"
+                    "        text level file whose every level is played\n"
+                    "  -g  also the stock level and generated fields up to 128x128\n"
+                    "  -r  also that many seeded random scripts\n"
+                    "  -s  repeat on 1, 2, 4... workers up to -j and compare\n"
+                    "  -v  print every run\n"
+                    "At least one level and one script are needed.\n");
+}
+
+static void free_sets(void)
+{
+    for (int l = 0; l < level_count; l++)
+        free(levels[l].text);
+    for (int i = 0; i < script_count; i++) {
+        if (scripts[i].recorded)
+            replay_free(&scripts[i].replay);
+    }
+    free(levels);
+    free(scripts);
+}
+
+int main(int argc, char** argv)
+{
+    int workers = pool_cpu_count();
+    int random_scripts = 0;
+    int tick_limit = DEFAULT_TICK_LIMIT;
+    int sweep = 0, verbose = 0, with_generated = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            random_scripts = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            tick_limit = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-g"))
+            with_generated = 1;
+        else if (!strcmp(argv[i], "-s"))
+            sweep = 1;
+        else if (!strcmp(argv[i], "-v"))
+            verbose = 1;
+        else if (argv[i][0] != '-') {
+            if (add_file(argv[i]) < 0)
+                return 1;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (with_generated && add_generated() < 0)
+        return 1;
+    if (add_random(random_scripts) < 0) {
+        fprintf(stderr, "sim_batch: out of memory\n");
+        return 1;
+    }
+    if (workers < 1 || random_scripts < 0 || tick_limit < 1 || level_count == 0 || script_count == 0) {
+        usage();
+        return 2;
+    }
+
+    int count = level_count * script_count;
+    Batch batch;
+    Run* reference = malloc(count * sizeof(Run));
+    PoolStats* stats = malloc(workers * sizeof(PoolStats));
+    batch.levels = levels;
+    batch.scripts = scripts;
+    batch.runs = malloc(count * sizeof(Run));
+    batch.tick_limit = tick_limit;
+    if (!reference || !stats || !batch.runs) {
+        fprintf(stderr, "sim_batch: out of memory\n");
+        return 1;
+    }
+
+    /* Level-major, so neighbouring tasks cost about the same and a stolen
+     * half is a fair share */
+    for (int i = 0; i < count; i++) {
+        batch.runs[i].level = i / script_count;
+        batch.runs[i].script = i % script_count;
+    }
+
+    int mismatches = 0;
+    double base_rate = 0;
+    int first = sweep ? 1 : workers;
+    for (int n = first; ; n = (n * 2 < workers) ? n * 2 : workers) {
+        double elapsed = run_batch(&batch, count, n, stats);
+        if (elapsed < 0) {
+            fprintf(stderr, "sim_batch: out of memory\n");
+            return 1;
+        }
+
+        long long ticks = total_ticks(batch.runs, count);
+        double rate = ticks / elapsed;
+        long steals = 0;
+        for (int w = 0; w < n; w++)
+            steals += stats[w].steals;
+
+        if (n == first) {
+            memcpy(reference, batch.runs, count * sizeof(Run));
+            base_rate = rate;
+        } else if (memcmp(reference, batch.runs, count * sizeof(Run)) != 0) {
+            mismatches++;
+        }
+
+        printf("workers: %3d  games: %6d  ticks: %10lld  time: %7.3f s  %6.2f M ticks/sec  steals: %5ld",
+               n, count, ticks, elapsed, rate / 1e6, steals);
+        if (sweep)
+            printf("  speedup: %5.2fx  efficiency: %3.0f%%", rate / base_rate, 100 * rate / base_rate / n);
+        printf("\n");
+
+        if (n >= workers)
+            break;
+    }
+
+    if (verbose) {
+        for (int i = 0; i < count; i++) {
+            printf("%-20s  %-20s  %-7s  %6d ticks\n", levels[reference[i].level].name,
+                   scripts[reference[i].script].name, outcome_names[reference[i].outcome], reference[i].ticks);
+        }
+    }
+    int errors = report_levels(reference, count);
+    if (errors)
+        printf("%d games could not set up their level\n", errors);
+    if (mismatches)
+        printf("outcomes differ between worker counts in %d batches\n", mismatches);
+
+    free(reference);
+    free(stats);
+    free(batch.runs);
+    free_sets();
+    return mismatches || errors ? 1 : 0;
+}
@@ -0,0 +1,382 @@
+/*
+ * Split-Field Simulation Benchmark (host)
+ * Runs sim_step from the simulation library alone, with no renderer or
+ * PSPSDK, on the stock level with random presses for both players and
+ * reports steps per second. A game that ends is started again outside
+ * the timed region. On larger fields with scattered walls it then times
+ * one flow-field search, a level load, and sim_step with every enemy
+ * chasing from that load on, with and without an AI budget, to show how
+ * the budget bounds the AI work per update. Last it records the moves
+ * of whole games for undo, takes each back to its start and forward to
+ * its end again, checking every state on the way, and reports the
+ * history's bytes per thousand moves and the time per undo and redo.
+ * Then both players mash in bursts, sampled three times a frame,
+ * through the input queues, and it checks that every tap becomes a
+ * move.
+ */
+
+#include "sim.h"
+#include "level_table.h"
+#include "undo.h"
+#include "input.h"
+#include "bench_levels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_STEPS 20000000
+#define INPUT_COUNT 4096
+
+#define FLOW_BUILDS 200
+#define FLOW_STEPS 200000
+#define FLOW_WALL_PERCENT 20
+
+#define UNDO_MOVES 200000
+
+#define INPUT_FRAMES 200000
+#define SAMPLES_PER_FRAME 3
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Mostly idle frames with a press now and then, as a player would */
+static void build_inputs(SimInput* inputs)
+{
+    static const SimInput buttons[8] = {
+        INPUT_P1_UP, INPUT_P1_DOWN, INPUT_P1_LEFT, INPUT_P1_RIGHT,
+        INPUT_P2_UP, INPUT_P2_DOWN, INPUT_P2_LEFT, INPUT_P2_RIGHT
+    };
+
+    srand(1);
+    memset(inputs, 0, INPUT_COUNT * sizeof(SimInput));
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        if (rand() % 3 == 0)
+            inputs[i] = buttons[rand() % 8] | buttons[rand() % 8];
+    }
+}
+
+/* Steps per second on the stock level */
+static void bench_stock(SimInput* inputs)
+{
+    GameContext ctx;
+    double elapsed = 0;
+    long games = 1;
+
+    sim_init(&ctx);
+
+    long step = 0;
+    while (step < BENCH_STEPS) {
+        double t0 = now_sec();
+        while (step < BENCH_STEPS && ctx.sim.state == GAME_RUNNING) {
+            sim_step(&ctx, inputs[step % INPUT_COUNT]);
+            step++;
+        }
+        elapsed += now_sec() - t0;
+
+        if (ctx.sim.state != GAME_RUNNING) {
+            sim_cleanup(&ctx);
+            sim_init(&ctx);
+            games++;
+        }
+    }
+    sim_cleanup(&ctx);
+
+    printf("state: %u bytes  context: %u bytes\n",
+           (unsigned)sizeof(SimState), (unsigned)sizeof(GameContext));
+    printf("sim_step: %.2f M steps/sec over %d steps, %ld games\n",
+           BENCH_STEPS / elapsed / 1e6, BENCH_STEPS, games);
+}
+
+/* bench_level's field, one fifth walls, with the first flow fields built
+ * as a level load builds them */
+static int build_level(GameContext* ctx, int size)
+{
+    if (bench_level(ctx, size, size, FLOW_WALL_PERCENT, size) < 0)
+        return -1;
+    sim_start_flow(ctx);
+    return 0;
+}
+
+static int compare_float(const void* a, const void* b)
+{
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+/* One whole search, then updates with every enemy chasing under an AI
+ * budget, each game timed from a fresh level load: mean, 99.9th
+ * percentile and worst update time (the host's scheduler makes the worst
+ * one noisy), and the most AI budget spent in one, emptying back fields
+ * included. The first fields are built by the load, which is timed on
+ * its own. */
+static int bench_flow(SimInput* inputs, int size, int budget)
+{
+    static float times[FLOW_STEPS];
+    GameContext ctx;
+    double elapsed = 0;
+    int reached = 0, max_spent = 0;
+    double t_load = 0;
+    long waiting = 0;
+
+    if (build_level(&ctx, size) < 0) {
+        printf("field %3dx%-3d  could not allocate\n", size, size);
+        return 1;
+    }
+
+    double t0 = now_sec();
+    for (int i = 0; i < FLOW_BUILDS; i++)
+        reached = sim_build_flow(&ctx, 1 + (i & 1));
+    double t_build = (now_sec() - t0) / FLOW_BUILDS;
+
+    /* Start the chase from scratch, as a level load does */
+    sim_cleanup(&ctx);
+    t0 = now_sec();
+    build_level(&ctx, size);
+    t_load += now_sec() - t0;
+    sim_set_ai_budget(&ctx, budget);
+
+    long games = 1;
+    for (long step = 0; step < FLOW_STEPS; step++) {
+        t0 = now_sec();
+        sim_step(&ctx, inputs[step % INPUT_COUNT]);
+        double t = now_sec() - t0;
+
+        elapsed += t;
+        times[step] = (float)t;
+        if (ctx.ai_stats.budget_spent > max_spent)
+            max_spent = ctx.ai_stats.budget_spent;
+        waiting += ctx.ai_stats.enemies_waiting;
+
+        if (ctx.sim.state != GAME_RUNNING) {
+            sim_cleanup(&ctx);
+            t0 = now_sec();
+            build_level(&ctx, size);
+            t_load += now_sec() - t0;
+            sim_set_ai_budget(&ctx, budget);
+            games++;
+        }
+    }
+    sim_cleanup(&ctx);
+    qsort(times, FLOW_STEPS, sizeof(times[0]), compare_float);
+
+    char label[16];
+    if (budget == AI_BUDGET_UNLIMITED)
+        snprintf(label, sizeof(label), "unlimited");
+    else
+        snprintf(label, sizeof(label), "%d", budget);
+
+    printf("field %3dx%-3d  flow search: %7.2f us (%5d cells)  load: %8.2f us  budget %-9s"
+           "  update: %6.3f us mean %7.2f us p99.9 %8.2f us worst  AI: %5d spent max  waits: %ld  games: %ld\n",
+           size, size, t_build * 1e6, reached, t_load / games * 1e6, label, elapsed / FLOW_STEPS * 1e6,
+           times[FLOW_STEPS - FLOW_STEPS / 1000] * 1e6, times[FLOW_STEPS - 1] * 1e6, max_spent, waiting, games);
+    return 0;
+}
+
+/* Is the game in state, but for the buttons held, with the grid to match */
+static int same_state(const GameContext* ctx, const SimState* state)
+{
+    SimState now = ctx->sim;
+    now.held = state->held;
+    return memcmp(&now, state, sizeof(SimState)) == 0 && sim_check_occupancy(ctx) == 0;
+}
+
+/* Games on the stock level until UNDO_MOVES moves have been recorded; each
+ * is undone to as far back as the history reaches and redone to its end */
+static int bench_undo(SimInput* inputs)
+{
+    static UndoHistory history;
+    GameContext ctx;
+    int capacity = 1024, bad = 0;
+    SimState* states = (SimState*)malloc(capacity * sizeof(SimState));
+    long moves = 0, undone = 0;
+    unsigned int bytes = 0, forgotten = 0;
+    double t_back = 0, t_forward = 0;
+    long step = 0;
+
+    while (moves < UNDO_MOVES) {
+        sim_init(&ctx);
+        undo_init(&history, &ctx);
+
+        /* states[k] is the game after k moves */
+        int count = 0;
+        states[count++] = ctx.sim;
+        while (ctx.sim.state == GAME_RUNNING) {
+            sim_step(&ctx, inputs[step++ % INPUT_COUNT]);
+            if (!undo_record(&history, &ctx))
+                continue;
+            if (count == capacity) {
+                capacity *= 2;
+                states = (SimState*)realloc(states, capacity * sizeof(SimState));
+                if (!states) {
+                    printf("undo: out of memory\n");
+                    return 1;
+                }
+            }
+            states[count++] = ctx.sim;
+        }
+
+        /* Timed there and back, then again checking every state */
+        int depth = history.depth;
+        double t0 = now_sec();
+        while (undo_step_back(&history, &ctx))
+            ;
+        t_back += now_sec() - t0;
+        t0 = now_sec();
+        while (undo_step_forward(&history, &ctx))
+            ;
+        t_forward += now_sec() - t0;
+
+        for (int k = count - 2; undo_step_back(&history, &ctx); k--)
+            bad += !same_state(&ctx, &states[k]);
+        for (int k = count - depth; undo_step_forward(&history, &ctx); k++)
+            bad += !same_state(&ctx, &states[k]);
+
+        moves += history.stats.moves;
+        undone += depth;
+        bytes += history.stats.bytes;
+        forgotten += history.stats.forgotten;
+        sim_cleanup(&ctx);
+    }
+    free(states);
+
+    unsigned int per_1000 = (unsigned int)(bytes * 1000ULL / moves);
+    printf("undo: %ld moves  %u bytes per 1000 moves (%u as state blocks)  %u moves in the %u-byte ring"
+           "  %u forgotten\n",
+           moves, per_1000, (unsigned)(sizeof(SimState) * 1000), UNDO_RING_SIZE * 1000 / per_1000,
+           UNDO_RING_SIZE, forgotten);
+    printf("undo: %.3f us per undo  %.3f us per redo  %s\n", t_back / undone * 1e6, t_forward / undone * 1e6,
+           bad ? "MISMATCH" : "every state matches");
+    return bad ? 1 : 0;
+}
+
+/* A player mashing as fast as a thumb goes: bursts of 2 to 8 taps of 1
+ * to 3 samples each, 4 to 16 samples apart (about 15 a second, over the
+ * 10 moves a second a player makes), in random directions, with 60 to 180
+ * samples between bursts */
+typedef struct {
+    int taps;       /* Left in this burst */
+    int down;       /* Samples the tap stays down */
+    int gap;        /* Samples up before the next */
+    SimInput bit;
+} Masher;
+
+static SimInput mash(Masher* m, SimInput moves, long* taps)
+{
+    if (m->down) {
+        m->down--;
+        return m->bit;
+    }
+    if (m->gap) {
+        m->gap--;
+        return 0;
+    }
+
+    if (m->taps == 0)
+        m->taps = 2 + rand() % 7;
+    m->taps--;
+    m->gap = m->taps ? 4 + rand() % 13 : 60 + rand() % 121;
+    m->down = rand() % 3;
+    do
+        m->bit = 1 << (rand() % 8);
+    while (!(m->bit & moves));
+    (*taps)++;
+    return m->bit;
+}
+
+/* Both players mashing on the stock level with the enemies idle: every
+ * sample goes to the input queues and the latch to catch what they miss,
+ * and each update takes their next presses. Fails if any tap does not
+ * become a move. */
+static int bench_input(void)
+{
+    static const SimInput moves[2] = { INPUT_P1_MOVES, INPUT_P2_MOVES };
+    InputQueue queue;
+    GameContext ctx;
+    Masher mashers[2];
+    long taps[2] = { 0, 0 }, per_frame[2] = { 0, 0 };
+    SimInput down = 0, frame_down = 0;
+
+    srand(7);
+    memset(mashers, 0, sizeof(mashers));
+    sim_init(&ctx);
+    ctx.sim.enemy_active = 0;
+    sim_rebuild_occupancy(&ctx);
+    input_init(&queue, 0, INPUT_REPEAT_DELAY, INPUT_REPEAT_PERIOD);
+
+    /* Mash, then let the queues run dry */
+    for (long frame = 0; frame < INPUT_FRAMES || input_pending(&queue, 1) || input_pending(&queue, 2); frame++) {
+        SimInput made = 0;
+
+        /* Now and then a frame's samples are lost, as they are on the PSP
+         * when a frame outlasts the controller's buffer: the latch has to
+         * catch its taps */
+        int stalled = frame % 101 == 100;
+
+        for (int s = 0; s < SAMPLES_PER_FRAME; s++) {
+            SimInput now = 0;
+            for (int p = 0; p < 2; p++) {
+                if (frame < INPUT_FRAMES)
+                    now |= mash(&mashers[p], moves[p], &taps[p]);
+            }
+            made |= now & ~down;
+            down = now;
+            if (!stalled)
+                input_sample(&queue, down);
+        }
+        input_latch(&queue, made);
+
+        /* What reading the newest sample once a frame would have seen */
+        for (int p = 0; p < 2; p++) {
+            if (down & ~frame_down & moves[p])
+                per_frame[p]++;
+        }
+        frame_down = down;
+
+        sim_step(&ctx, input_next(&queue, &ctx));
+        if (ctx.sim.state != GAME_RUNNING) {
+            sim_cleanup(&ctx);
+            sim_init(&ctx);
+            ctx.sim.enemy_active = 0;
+            sim_rebuild_occupancy(&ctx);
+        }
+    }
+    sim_cleanup(&ctx);
+
+    int failures = 0;
+    for (int p = 0; p < 2; p++) {
+        const InputStats* stats = &queue.player[p].stats;
+        int lost = taps[p] != (long)stats->presses || stats->dropped || stats->moves != stats->presses;
+
+        printf("input P%d: %ld taps  %u moves  %u dropped  %u by the latch  latency %.2f frames mean %u max"
+               "  once a frame: %ld seen  %s\n",
+               p + 1, taps[p], stats->moves, stats->dropped, stats->latched,
+               stats->moves ? (double)stats->latency / stats->moves : 0.0, stats->max_latency, per_frame[p],
+               lost ? "LOST" : "none lost");
+        failures += lost;
+    }
+    return failures ? 1 : 0;
+}
+
+int main(void)
+{
+    static SimInput inputs[INPUT_COUNT];
+    static const int sizes[] = { 32, 64, 128, 256 };
+    int failures = 0;
+
+    build_inputs(inputs);
+    bench_stock(inputs);
+
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        failures += bench_flow(inputs, sizes[i], AI_BUDGET_UNLIMITED);
+        failures += bench_flow(inputs, sizes[i], AI_DEFAULT_BUDGET);
+    }
+    failures += bench_undo(inputs);
+    failures += bench_input();
+
+    return failures ? 1 : 0;
+}
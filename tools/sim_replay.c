@@ -0,0 +1,312 @@
+/*
+ * Split-Field Replay Tool (host)
+ * Records, checks and times input recordings:
+ *   sim_replay record FILE [-t ticks] [-s seed]
+ *     play a scripted game on the stock level, both players running from
+ *     the enemies for ticks updates (ten minutes unless given), and save
+ *     its recording; a game that ends sooner is reported
+ *   sim_replay verify FILE...
+ *     replay each recording, made here or on the PSP, and report whether
+ *     the game followed it to the end or where it first drifted
+ *   sim_replay bench FILE [-n ticks]
+ *     replay one recording over and over as a fixed workload and report
+ *     updates per second, checking every pass against its hashes
+ */
+
+#include "sim.h"
+#include "level_table.h"
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_RECORD_TICKS 36000   /* Ten minutes at 60 updates a second */
+#define DEFAULT_BENCH_TICKS 20000000
+
+/* A press every PRESS_INTERVAL ticks clears the move delay */
+#define PRESS_INTERVAL 6
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The game a recording starts from; only the stock level is built in */
+static int start_level(GameContext* ctx, int level)
+{
+    if (level != 1)
+        return -1;
+    sim_init(ctx);
+    return ctx->sim.state == GAME_RUNNING ? 0 : -1;
+}
+
+#define FAR 0xFFFF
+
+/* Cells the search below may hold: fields are at most 256 on a side */
+#define MAX_CELLS (256 * 256)
+
+static int enemy_floor(const GameContext* ctx, int cell)
+{
+    int tile = ctx->field[cell];
+    return (tile == TILE_EMPTY || tile == TILE_GOAL) && !OCCUPANT_IS_BOX(ctx->occupancy[cell]);
+}
+
+static int player_floor(const GameContext* ctx, int cell)
+{
+    return enemy_floor(ctx, cell) && ctx->occupancy[cell] == OCCUPANT_NONE;
+}
+
+/* Breadth-first steps from the cells queued in queue[0..count) over the
+ * cells floor allows */
+static void spread(const GameContext* ctx, unsigned short* dist, int* queue, int count,
+                   int (*floor)(const GameContext*, int))
+{
+    static const int step_x[4] = { 0, 0, -1, 1 };
+    static const int step_y[4] = { -1, 1, 0, 0 };
+    int width = ctx->field_width, height = ctx->field_height;
+
+    for (int head = 0; head < count; head++) {
+        int cell = queue[head];
+        int x = cell % width, y = cell / width;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + step_x[d], ny = y + step_y[d];
+            int next = ny * width + nx;
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height || dist[next] != FAR || !floor(ctx, next))
+                continue;
+            dist[next] = dist[cell] + 1;
+            queue[count++] = next;
+        }
+    }
+}
+
+/* Cells a player starting on cell a step from now reaches before any
+ * enemy can, taking each enemy to be about to step: the room it has to
+ * run in */
+static int room_from(const GameContext* ctx, const unsigned short* enemy_dist, int cell)
+{
+    static unsigned short dist[MAX_CELLS];
+    static int queue[MAX_CELLS];
+    int cells = ctx->field_width * ctx->field_height;
+    int room = 0;
+
+    memset(dist, 0xFF, cells * sizeof(dist[0]));
+    dist[cell] = 0;
+    queue[0] = cell;
+    spread(ctx, dist, queue, 1, player_floor);
+    for (int c = 0; c < cells; c++) {
+        if (dist[c] != FAR && (dist[c] + 1) * PRESS_INTERVAL < (enemy_dist[c] - 1) * ENEMY_MOVE_PERIOD)
+            room++;
+    }
+    return room;
+}
+
+/* The press (or 0 to stay) that takes player num furthest from the
+ * enemies by the paths they walk, then leaves it the most room to run;
+ * ties go to a random one. Enemies step at less than half a player's
+ * pace, so a player that keeps its distance and open ground slips round
+ * them for as long as the recording runs. */
+static SimInput flee_input(const GameContext* ctx, int num, unsigned int* random)
+{
+    static const int step_x[5] = { 0, 0, -1, 1, 0 };
+    static const int step_y[5] = { -1, 1, 0, 0, 0 };
+    static const SimInput presses[2][5] = {
+        { INPUT_P1_UP, INPUT_P1_DOWN, INPUT_P1_LEFT, INPUT_P1_RIGHT, 0 },
+        { INPUT_P2_UP, INPUT_P2_DOWN, INPUT_P2_LEFT, INPUT_P2_RIGHT, 0 }
+    };
+    static unsigned short enemy_dist[MAX_CELLS];
+    static int queue[MAX_CELLS];
+    int width = ctx->field_width;
+    int cells = width * ctx->field_height;
+    int count = 0;
+
+    memset(enemy_dist, 0xFF, cells * sizeof(enemy_dist[0]));
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        if (!ENEMY_ACTIVE(ctx, i))
+            continue;
+        int cell = ctx->sim.y[ENTITY_ENEMY0 + i] * width + ctx->sim.x[ENTITY_ENEMY0 + i];
+        enemy_dist[cell] = 0;
+        queue[count++] = cell;
+    }
+    spread(ctx, enemy_dist, queue, count, enemy_floor);
+
+    int px = ctx->sim.x[ENTITY_PLAYER(num)];
+    int py = ctx->sim.y[ENTITY_PLAYER(num)];
+    int best_room = -1, best_dist = -1, ties = 1;
+    SimInput input = 0;
+
+    for (int d = 0; d < 5; d++) {
+        int x = px + step_x[d], y = py + step_y[d];
+        if (x < 0 || x >= width || y < 0 || y >= ctx->field_height)
+            continue;
+        int cell = y * width + x;
+        if (d < 4 && !player_floor(ctx, cell))
+            continue;
+
+        int room = room_from(ctx, enemy_dist, cell);
+        int dist = enemy_dist[cell];
+        *random = *random * 1103515245u + 12345u;
+        if (dist > best_dist || (dist == best_dist && room > best_room)) {
+            best_room = room;
+            best_dist = dist;
+            input = presses[num - 1][d];
+            ties = 1;
+        } else if (room == best_room && dist == best_dist && (*random >> 16) % ++ties == 0) {
+            input = presses[num - 1][d];
+        }
+    }
+    return input;
+}
+
+static int record(const char* path, int tick_limit, unsigned int seed)
+{
+    GameContext ctx;
+    Replay replay;
+    unsigned int random = seed;
+
+    if (start_level(&ctx, 1) < 0)
+        return 1;
+    replay_init(&replay, ctx.level);
+
+    for (int tick = 0; tick < tick_limit && ctx.sim.state == GAME_RUNNING; tick++) {
+        SimInput input = 0;
+        if (tick % PRESS_INTERVAL == 0)
+            input = flee_input(&ctx, 1, &random) | flee_input(&ctx, 2, &random);
+
+        sim_step(&ctx, input);
+        if (replay_record(&replay, input, &ctx) < 0) {
+            fprintf(stderr, "sim_replay: out of memory\n");
+            return 1;
+        }
+    }
+
+    int failed = replay_save(&replay, path) < 0;
+    if (failed)
+        fprintf(stderr, "sim_replay: cannot write %s\n", path);
+    else
+        printf("%s: %u updates in %d runs, %d bytes, state %d, hash %08x\n", path, replay.ticks,
+               replay.run_count, replay_encoded_size(&replay), ctx.sim.state, replay.hash);
+    if (!failed && replay.ticks < (unsigned int)tick_limit)
+        printf("%s: the game ended %u updates short of the %d asked for\n", path,
+               tick_limit - replay.ticks, tick_limit);
+
+    replay_free(&replay);
+    sim_cleanup(&ctx);
+    return failed;
+}
+
+/* Replay once from the start; returns 1 if it followed the recording */
+static int play(const Replay* replay, ReplayPlayer* player)
+{
+    GameContext ctx;
+
+    replay_player_init(player, replay);
+    if (start_level(&ctx, replay->level) < 0)
+        return 0;
+    while (replay_player_step(player, &ctx))
+        ;
+    sim_cleanup(&ctx);
+    return replay_player_matched(player);
+}
+
+static int verify(const char* path)
+{
+    Replay replay;
+    ReplayPlayer player;
+
+    if (replay_load(&replay, path) < 0) {
+        printf("%s: not a replay\n", path);
+        return 1;
+    }
+
+    int matched = play(&replay, &player);
+    if (matched)
+        printf("%s: matched, %u updates, hash %08x\n", path, player.tick, player.hash);
+    else if (player.diverged >= 0)
+        printf("%s: DIVERGED within the %d updates before update %d\n", path,
+               REPLAY_HASH_INTERVAL, player.diverged);
+    else
+        printf("%s: cannot replay level %d\n", path, replay.level);
+
+    replay_free(&replay);
+    return !matched;
+}
+
+static int bench(const char* path, long tick_target)
+{
+    Replay replay;
+    ReplayPlayer player;
+    long ticks = 0, passes = 0, mismatches = 0;
+
+    if (replay_load(&replay, path) < 0 || replay.ticks == 0) {
+        printf("%s: not a replay\n", path);
+        return 1;
+    }
+
+    double t0 = now_sec();
+    while (ticks < tick_target) {
+        mismatches += !play(&replay, &player);
+        ticks += player.tick;
+        passes++;
+    }
+    double elapsed = now_sec() - t0;
+
+    printf("%s: %ld passes of %u updates  %.2f M updates/sec  mismatches: %ld\n",
+           path, passes, replay.ticks, ticks / elapsed / 1e6, mismatches);
+    replay_free(&replay);
+    return mismatches ? 1 : 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: sim_replay record FILE [-t ticks] [-s seed]\n"
+                    "       sim_replay verify FILE...\n"
+                    "       sim_replay bench FILE [-n ticks]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+
+    if (!strcmp(argv[1], "record")) {
+        int ticks = DEFAULT_RECORD_TICKS;
+        unsigned int seed = 1;
+        for (int i = 3; i < argc; i++) {
+            if (!strcmp(argv[i], "-t") && i + 1 < argc)
+                ticks = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+                seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+            else {
+                usage();
+                return 2;
+            }
+        }
+        return record(argv[2], ticks, seed);
+    }
+
+    if (!strcmp(argv[1], "verify")) {
+        int failures = 0;
+        for (int i = 2; i < argc; i++)
+            failures += verify(argv[i]);
+        return failures ? 1 : 0;
+    }
+
+    if (!strcmp(argv[1], "bench")) {
+        long ticks = DEFAULT_BENCH_TICKS;
+        if (argc == 5 && !strcmp(argv[3], "-n"))
+            ticks = atol(argv[4]);
+        else if (argc != 3) {
+            usage();
+            return 2;
+        }
+        return bench(argv[2], ticks);
+    }
+
+    usage();
+    return 2;
+}
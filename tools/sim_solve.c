@@ -0,0 +1,298 @@
+/*
+ * Split-Field Solver Tool (host)
+ * Solves the stock level and, with -r, that many random 20x14 levels, and
+ * reports whether each is solvable, the fewest player steps, the states
+ * searched and the time taken. Every solution is played through sim_step
+ * with the enemies off and must win, which checks the solver's moves
+ * against the game's own.
+ *
+ *   sim_solve [-r levels] [-m megabytes] [-o FILE] [-b microseconds]
+ *
+ * -b also runs the in-game hint search (hint.h) on every level as the PSP
+ * would, a share of at most that many microseconds a frame, and reports
+ * the frames it takes and the nodes expanded per frame, for tuning the
+ * budget. Host frames are many times faster than the PSP's.
+ *
+ * -o saves the stock level's solution as an input recording (see
+ * sim_replay): a press every update the move delay allows, both players'
+ * moves side by side where their halves never meet. The recording is
+ * flagged REPLAY_NO_ENEMIES, so it replays as it was solved and wins.
+ */
+
+#include "sim.h"
+#include "level_table.h"
+#include "solver.h"
+#include "replay.h"
+#include "hint.h"
+#include "bench_levels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_MEGABYTES 256
+#define MAX_SOLUTION 4096
+#define RANDOM_WALL_PERCENT 12
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Scattered walls, and on each side a player, its two boxes and two
+ * goals, all on random free cells; no enemies */
+static int build_random_level(GameContext* ctx, unsigned int seed)
+{
+    return bench_level_scattered(ctx, DEFAULT_FIELD_WIDTH, DEFAULT_FIELD_HEIGHT, RANDOM_WALL_PERCENT, seed);
+}
+
+/* Play moves through sim_step, one press each time the move delay allows.
+ * With apart set the sides never meet, so each update takes the next move
+ * of both players; otherwise a player 1 move and the player 2 move right
+ * after it share one. Records into replay if not NULL. Returns the
+ * updates played, -1 if the recording runs out of memory. */
+static int play_moves(GameContext* ctx, const SolverMove* moves, int count, int apart, Replay* replay)
+{
+    int next[2] = { 0, 0 };
+    int ticks = 0;
+
+    for (int i = 0; i < count && ctx->sim.state == GAME_RUNNING; ) {
+        SimInput input = 0;
+        if (apart) {
+            for (int p = 0; p < 2; p++) {
+                while (next[p] < count && moves[next[p]].player != p + 1)
+                    next[p]++;
+                if (next[p] < count) {
+                    input |= solver_move_input(moves[next[p]++]);
+                    i++;
+                }
+            }
+        } else {
+            input = solver_move_input(moves[i]);
+            if (moves[i].player == 1 && i + 1 < count && moves[i + 1].player == 2)
+                input |= solver_move_input(moves[++i]);
+            i++;
+        }
+
+        /* The press, then released until the delay runs out */
+        for (int t = 0; t <= PLAYER_MOVE_DELAY && ctx->sim.state == GAME_RUNNING; t++) {
+            SimInput now = t == 0 ? input : 0;
+            sim_step(ctx, now);
+            if (replay && replay_record(replay, now, ctx) < 0)
+                return -1;
+            ticks++;
+        }
+    }
+    return ticks;
+}
+
+/* Solve ctx's level; returns the solution length, -1 unsolvable, -2 out
+ * of memory. moves receives the solution. */
+static int solve(const GameContext* ctx, void* memory, int size, SolverMove* moves,
+                 double* seconds, long* expanded, int* states, int* apart)
+{
+    Solver solver;
+    double t0 = now_sec();
+
+    if (solver_init(&solver, ctx, memory, size) < 0)
+        return -2;
+    SolverStatus status = solver_run(&solver, 0);
+    *seconds = now_sec() - t0;
+    *expanded = solver.expanded;
+    *states = solver.node_count;
+    *apart = solver.split_boxes != 0;
+
+    if (status == SOLVER_OUT_OF_MEMORY)
+        return -2;
+    if (status != SOLVER_SOLVED)
+        return -1;
+    return solver_solution(&solver, moves, MAX_SOLUTION) == solver_solution_length(&solver)
+           ? solver_solution_length(&solver) : -2;
+}
+
+/* Play the solution with the enemies off; it must win */
+static int check_solution(GameContext* ctx, const SolverMove* moves, int length, int apart)
+{
+    ctx->sim.enemy_active = 0;
+    sim_rebuild_occupancy(ctx);
+    play_moves(ctx, moves, length, apart, NULL);
+    return ctx->sim.state == GAME_WIN;
+}
+
+/* Hint search totals over every level it ran on */
+typedef struct {
+    int levels;
+    int ready;
+    int none;
+    long frames;
+    long expanded;
+    unsigned int max_expanded;
+    unsigned int max_us;
+    int overruns;                /* Frames whose share ran past the budget */
+} HintTotals;
+
+/* Run the hint search to its end, a frame's share at a time */
+static void run_hint(Hint* hint, const GameContext* ctx, int budget_us, HintTotals* totals)
+{
+    hint_request(hint, ctx);
+    while (hint->state == HINT_SEARCHING) {
+        hint_step(hint, ctx, hint_clock_us() + budget_us);
+        if (hint->stats.last_us > (unsigned int)budget_us)
+            totals->overruns++;
+    }
+
+    totals->levels++;
+    totals->ready += hint->state == HINT_READY;
+    totals->none += hint->state == HINT_NONE;
+    totals->frames += hint->stats.frames;
+    totals->expanded += hint->stats.expanded;
+    if (hint->stats.max_expanded > totals->max_expanded)
+        totals->max_expanded = hint->stats.max_expanded;
+    if (hint->stats.max_us > totals->max_us)
+        totals->max_us = hint->stats.max_us;
+}
+
+static void print_hint(const char* name, const HintTotals* totals, int budget_us)
+{
+    printf("hint %s: %d levels  hinted: %d  none: %d  frames: %.1f mean  "
+           "nodes/frame: %.0f mean %u max  share: %u us max of %d  overruns: %d\n",
+           name, totals->levels, totals->ready, totals->none, (double)totals->frames / totals->levels,
+           totals->frames ? (double)totals->expanded / totals->frames : 0.0, totals->max_expanded,
+           totals->max_us, budget_us, totals->overruns);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: sim_solve [-r levels] [-m megabytes] [-o FILE] [-b microseconds]\n");
+}
+
+int main(int argc, char** argv)
+{
+    static SolverMove moves[MAX_SOLUTION];
+    static Hint hint;
+    int random_levels = 0, megabytes = DEFAULT_MEGABYTES, budget_us = 0;
+    const char* out = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            random_levels = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+            megabytes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            out = argv[++i];
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            budget_us = atoi(argv[++i]);
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    /* A share shorter than the hint's first guesses never starts */
+    if (budget_us > 0 && budget_us <= HINT_INIT_US) {
+        fprintf(stderr, "sim_solve: -b must be over %d\n", HINT_INIT_US);
+        return 2;
+    }
+
+    int size = megabytes * 1024 * 1024;
+    void* memory = malloc(size);
+    if (megabytes < 1 || !memory) {
+        fprintf(stderr, "sim_solve: cannot allocate %d MB\n", megabytes);
+        return 1;
+    }
+
+    GameContext ctx;
+    HintTotals stock_hint = { 0 }, random_hint = { 0 };
+    double seconds;
+    long expanded;
+    int states, apart, failures = 0;
+
+    sim_init(&ctx);
+    int length = solve(&ctx, memory, size, moves, &seconds, &expanded, &states, &apart);
+    if (length < 0) {
+        printf("stock: %s  states: %d  time: %.2f ms\n", length == -1 ? "UNSOLVABLE" : "out of memory",
+               states, seconds * 1e3);
+        failures++;
+    } else {
+        printf("stock: solved in %d steps  states: %d  expanded: %ld  time: %.2f ms  check: %s\n",
+               length, states, expanded, seconds * 1e3, check_solution(&ctx, moves, length, apart) ? "wins" : "FAILS");
+        printf("  ");
+        for (int i = 0; i < length; i++)
+            printf("%c", "UDLR"[moves[i].dir] + (moves[i].player == 2 ? 'a' - 'A' : 0));
+        printf("  (capitals player 1)\n");
+    }
+    sim_cleanup(&ctx);
+
+    if (budget_us > 0) {
+        hint_init(&hint);
+        sim_init(&ctx);
+        run_hint(&hint, &ctx, budget_us, &stock_hint);
+        print_hint("stock", &stock_hint, budget_us);
+        sim_cleanup(&ctx);
+    }
+
+    if (out && length >= 0) {
+        Replay replay;
+        sim_init(&ctx);
+        replay_init(&replay, ctx.level);
+        replay.flags = REPLAY_NO_ENEMIES;
+        ctx.sim.enemy_active = 0;
+        sim_rebuild_occupancy(&ctx);
+        int ticks = play_moves(&ctx, moves, length, apart, &replay);
+        if (ticks < 0 || replay_save(&replay, out) < 0) {
+            fprintf(stderr, "sim_solve: cannot write %s\n", out);
+            failures++;
+        } else if (ctx.sim.state != GAME_WIN) {
+            fprintf(stderr, "sim_solve: the solution saved to %s does not win\n", out);
+            failures++;
+        } else {
+            printf("%s: %d updates, enemies off, the game is won\n", out, ticks);
+        }
+        replay_free(&replay);
+        sim_cleanup(&ctx);
+    }
+
+    int solved = 0, unsolvable = 0, exhausted = 0;
+    double total = 0, worst = 0;
+    for (int level = 1; level <= random_levels; level++) {
+        if (build_random_level(&ctx, level) < 0)
+            return 1;
+        length = solve(&ctx, memory, size, moves, &seconds, &expanded, &states, &apart);
+        total += seconds;
+        if (seconds > worst)
+            worst = seconds;
+
+        if (length >= 0) {
+            solved++;
+            if (!check_solution(&ctx, moves, length, apart)) {
+                printf("level %d: solution of %d steps does not win\n", level, length);
+                failures++;
+            }
+        } else if (length == -1) {
+            unsolvable++;
+        } else {
+            exhausted++;
+        }
+        if (budget_us > 0) {
+            /* Afresh: check_solution played the level through */
+            sim_cleanup(&ctx);
+            if (build_random_level(&ctx, level) < 0)
+                return 1;
+            run_hint(&hint, &ctx, budget_us, &random_hint);
+        }
+        sim_cleanup(&ctx);
+    }
+    if (random_levels) {
+        printf("random 20x14: %d levels  solved: %d  unsolvable: %d  out of memory: %d  "
+               "time: %.2f ms mean %.2f ms max\n", random_levels, solved, unsolvable, exhausted,
+               total / random_levels * 1e3, worst * 1e3);
+        if (budget_us > 0)
+            print_hint("random 20x14", &random_hint, budget_us);
+    }
+
+    hint_free(&hint);
+    free(memory);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * Split-Field Work Pool (host)
+ * Work stealing over index ranges. A worker takes tasks one at a time from
+ * the front of its own range; a worker with none left takes the back half
+ * of another's. Tasks are whole games or searches, so a lock per range
+ * costs nothing next to the work it hands out.
+ */
+
+#include "work_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define POOL_MAX_WORKERS 256
+
+/* A worker's remaining tasks, next to end - 1, padded to its own cache
+ * line so owners and thieves do not share one */
+typedef struct {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+    char pad[64];
+} PoolRange;
+
+typedef struct {
+    PoolRange* ranges;
+    PoolStats* stats;
+    int workers;
+    PoolTaskFn fn;
+    void* arg;
+} Pool;
+
+typedef struct {
+    Pool* pool;
+    int worker;
+} PoolWorker;
+
+int pool_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        return 1;
+    return n > POOL_MAX_WORKERS ? POOL_MAX_WORKERS : (int)n;
+}
+
+/* Next task from the worker's own range, or -1 */
+static int take_own(PoolRange* range)
+{
+    int index = -1;
+
+    pthread_mutex_lock(&range->lock);
+    if (range->next < range->end)
+        index = range->next++;
+    pthread_mutex_unlock(&range->lock);
+    return index;
+}
+
+/* Move the back half of victim's range (at least one task) into thief's;
+ * returns 0 if victim had nothing left. Both locks are held for the move,
+ * taken in array order so two steals cannot wait on each other, and the
+ * tasks are never in neither range for another worker to miss. */
+static int steal(PoolRange* victim, PoolRange* thief)
+{
+    PoolRange* first = victim < thief ? victim : thief;
+    PoolRange* second = victim < thief ? thief : victim;
+    int from, to;
+
+    pthread_mutex_lock(&first->lock);
+    pthread_mutex_lock(&second->lock);
+    to = victim->end;
+    from = to - (to - victim->next + 1) / 2;
+    if (from < to) {
+        victim->end = from;
+        thief->next = from;
+        thief->end = to;
+    }
+    pthread_mutex_unlock(&second->lock);
+    pthread_mutex_unlock(&first->lock);
+    return from < to;
+}
+
+/* Run tasks until every range is empty. No task adds work, so once a full
+ * pass over the others finds nothing, nothing more will come. */
+static void* worker_main(void* p)
+{
+    PoolWorker* w = (PoolWorker*)p;
+    Pool* pool = w->pool;
+    PoolRange* own = &pool->ranges[w->worker];
+    PoolStats stats = { 0, 0 };
+
+    for (;;) {
+        int index = take_own(own);
+        if (index >= 0) {
+            pool->fn(pool->arg, index, w->worker);
+            stats.tasks++;
+            continue;
+        }
+
+        int stolen = 0;
+        for (int k = 1; k < pool->workers && !stolen; k++)
+            stolen = steal(&pool->ranges[(w->worker + k) % pool->workers], own);
+        if (!stolen)
+            break;
+        stats.steals++;
+    }
+
+    /* Written once at the end, not next to the other workers' on every task */
+    pool->stats[w->worker] = stats;
+    return NULL;
+}
+
+int pool_run(int workers, int count, PoolTaskFn fn, void* arg, PoolStats* stats)
+{
+    pthread_t threads[POOL_MAX_WORKERS];
+    char started[POOL_MAX_WORKERS];
+    PoolWorker args[POOL_MAX_WORKERS];
+    Pool pool;
+
+    if (workers < 1)
+        workers = 1;
+    if (workers > POOL_MAX_WORKERS)
+        workers = POOL_MAX_WORKERS;
+
+    pool.ranges = calloc(workers, sizeof(PoolRange));
+    pool.stats = calloc(workers, sizeof(PoolStats));
+    if (!pool.ranges || !pool.stats) {
+        free(pool.ranges);
+        free(pool.stats);
+        return -1;
+    }
+    pool.workers = workers;
+    pool.fn = fn;
+    pool.arg = arg;
+
+    /* Even contiguous shares to start with */
+    for (int i = 0; i < workers; i++) {
+        pthread_mutex_init(&pool.ranges[i].lock, NULL);
+        pool.ranges[i].next = (int)((long long)count * i / workers);
+        pool.ranges[i].end = (int)((long long)count * (i + 1) / workers);
+    }
+
+    for (int i = 0; i < workers; i++) {
+        args[i].pool = &pool;
+        args[i].worker = i;
+    }
+
+    /* The caller is worker 0; a thread that will not start leaves its
+     * share to be stolen */
+    for (int i = 1; i < workers; i++)
+        started[i] = pthread_create(&threads[i], NULL, worker_main, &args[i]) == 0;
+    worker_main(&args[0]);
+    for (int i = 1; i < workers; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < workers; i++)
+        pthread_mutex_destroy(&pool.ranges[i].lock);
+    if (stats)
+        memcpy(stats, pool.stats, workers * sizeof(PoolStats));
+    free(pool.ranges);
+    free(pool.stats);
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * Split-Field Work Pool (host)
+ * Runs a fixed set of independent tasks across worker threads. Each worker
+ * starts with its own share of the task indices and, once that runs dry,
+ * steals half of what another worker has left, so uneven tasks still keep
+ * every core busy.
+ */
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+/* Work done by one worker over a pool_run call */
+typedef struct {
+    long tasks;     /* Tasks run */
+    long steals;    /* Times it took work from another worker */
+} PoolStats;
+
+/* Runs task index on worker (0 to workers - 1). Tasks run concurrently
+ * and in no set order; each must touch only its own data or the worker's */
+typedef void (*PoolTaskFn)(void* arg, int index, int worker);
+
+/* Cores available to the process, at least 1 */
+int pool_cpu_count(void);
+
+/* Run task 0 to count - 1 on workers threads (the caller's included) and
+ * return once all are done. A thread that fails to start leaves its share
+ * to the others. stats, if not NULL, receives workers entries. Returns -1,
+ * running nothing, if memory runs out. */
+int pool_run(int workers, int count, PoolTaskFn fn, void* arg, PoolStats* stats);
+
+#endif /* WORK_POOL_H */
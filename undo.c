@@ -0,0 +1,168 @@
+/*
+ * Split-Field Undo
+ * Move deltas on a ring, and the state block and grid they are applied to
+ */
+
+#include "undo.h"
+#include <stddef.h>
+#include <string.h>
+
+#define RING_BYTE(history, pos) ((history)->ring[(pos) & (UNDO_RING_SIZE - 1)])
+
+/* Bytes of the state block a delta may name: all but the buttons held */
+static int delta_byte(int i)
+{
+    return i < (int)offsetof(SimState, held) || i >= (int)(offsetof(SimState, held) + sizeof(unsigned short));
+}
+
+static int mask_count(unsigned int mask)
+{
+    int n = 0;
+
+    for (; mask; mask &= mask - 1)
+        n++;
+    return n;
+}
+
+static unsigned int read_mask(const UndoHistory* history, unsigned int pos)
+{
+    return RING_BYTE(history, pos) | RING_BYTE(history, pos + 1) << 8 | RING_BYTE(history, pos + 2) << 16 |
+           (unsigned int)RING_BYTE(history, pos + 3) << 24;
+}
+
+/* XOR the delta at pos into state */
+static void apply_delta(const UndoHistory* history, unsigned int pos, SimState* state)
+{
+    unsigned char* bytes = (unsigned char*)state;
+    unsigned int mask = read_mask(history, pos);
+
+    pos += 4;
+    for (int i = 0; mask; i++, mask >>= 1) {
+        if (mask & 1)
+            bytes[i] ^= RING_BYTE(history, pos++);
+    }
+}
+
+void undo_init(UndoHistory* history, const GameContext* ctx)
+{
+    history->start = history->now = history->end = 0;
+    history->depth = history->ahead = 0;
+    history->mark = ctx->sim;
+    memset(&history->stats, 0, sizeof(history->stats));
+}
+
+int undo_record(UndoHistory* history, const GameContext* ctx)
+{
+    const unsigned char* now = (const unsigned char*)&ctx->sim;
+    const unsigned char* was = (const unsigned char*)&history->mark;
+    unsigned char changes[sizeof(SimState)];
+    unsigned int mask = 0;
+    int n = 0;
+
+    if (ctx->sim.x[ENTITY_PLAYER1] == history->mark.x[ENTITY_PLAYER1] &&
+        ctx->sim.y[ENTITY_PLAYER1] == history->mark.y[ENTITY_PLAYER1] &&
+        ctx->sim.x[ENTITY_PLAYER2] == history->mark.x[ENTITY_PLAYER2] &&
+        ctx->sim.y[ENTITY_PLAYER2] == history->mark.y[ENTITY_PLAYER2])
+        return 0;
+
+    for (int i = 0; i < (int)sizeof(SimState); i++) {
+        if (delta_byte(i) && now[i] != was[i]) {
+            mask |= 1u << i;
+            changes[n++] = now[i] ^ was[i];
+        }
+    }
+
+    /* A new move ends the moves undone; then the oldest make room */
+    int size = n + UNDO_DELTA_OVERHEAD;
+    history->end = history->now;
+    history->ahead = 0;
+    while (history->end + size - history->start > UNDO_RING_SIZE) {
+        history->start += mask_count(read_mask(history, history->start)) + UNDO_DELTA_OVERHEAD;
+        history->depth--;
+        history->stats.forgotten++;
+    }
+
+    unsigned int pos = history->end;
+    for (int i = 0; i < 4; i++)
+        RING_BYTE(history, pos++) = mask >> (i * 8);
+    for (int i = 0; i < n; i++)
+        RING_BYTE(history, pos++) = changes[i];
+    RING_BYTE(history, pos++) = n;
+
+    history->now = history->end = pos;
+    history->depth++;
+    history->mark = ctx->sim;
+    history->stats.moves++;
+    history->stats.bytes += size;
+    return 1;
+}
+
+static int present(const SimState* state, int slot)
+{
+    if (slot >= ENTITY_ENEMY0 && slot < ENTITY_PLAYER1)
+        return (state->enemy_active >> (slot - ENTITY_ENEMY0)) & 1;
+    return 1;
+}
+
+/* Put the game in state, keeping the buttons held: entities that moved or
+ * came and went leave cells that still name them, then every entity marks
+ * its cell in the order sim_rebuild_occupancy uses, enemies last */
+static void set_sim(GameContext* ctx, const SimState* state)
+{
+    static const int order[ENTITY_COUNT] = {
+        ENTITY_BOX0, ENTITY_BOX0 + 1, ENTITY_BOX0 + 2, ENTITY_BOX0 + 3,
+        ENTITY_PLAYER1, ENTITY_PLAYER2,
+        ENTITY_ENEMY0, ENTITY_ENEMY0 + 1, ENTITY_ENEMY0 + 2, ENTITY_ENEMY0 + 3
+    };
+    const SimState* old = &ctx->sim;
+
+    for (int slot = 0; slot < ENTITY_COUNT; slot++) {
+        int moved = old->x[slot] != state->x[slot] || old->y[slot] != state->y[slot] ||
+                    present(old, slot) != present(state, slot);
+        if (moved && present(old, slot) && OCCUPANT_AT(ctx, old->x[slot], old->y[slot]) == OCCUPANT(slot))
+            OCCUPANT_AT(ctx, old->x[slot], old->y[slot]) = OCCUPANT_NONE;
+    }
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        if (present(state, order[i]))
+            OCCUPANT_AT(ctx, state->x[order[i]], state->y[order[i]]) = OCCUPANT(order[i]);
+    }
+
+    unsigned short held = ctx->sim.held;
+    ctx->sim = *state;
+    ctx->sim.held = held;
+}
+
+int undo_step_back(UndoHistory* history, GameContext* ctx)
+{
+    if (history->depth == 0)
+        return 0;
+
+    int n = RING_BYTE(history, history->now - 1);
+    history->now -= n + UNDO_DELTA_OVERHEAD;
+    apply_delta(history, history->now, &history->mark);
+    history->depth--;
+    history->ahead++;
+    set_sim(ctx, &history->mark);
+    return 1;
+}
+
+int undo_step_forward(UndoHistory* history, GameContext* ctx)
+{
+    if (history->ahead == 0)
+        return 0;
+
+    unsigned int pos = history->now;
+    apply_delta(history, pos, &history->mark);
+    history->now += mask_count(read_mask(history, pos)) + UNDO_DELTA_OVERHEAD;
+    history->depth++;
+    history->ahead--;
+    set_sim(ctx, &history->mark);
+    return 1;
+}
+
+unsigned int undo_bytes_per_1000(const UndoHistory* history)
+{
+    if (history->stats.moves == 0)
+        return 0;
+    return (unsigned int)((unsigned long long)history->stats.bytes * 1000 / history->stats.moves);
+}
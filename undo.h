@@ -0,0 +1,61 @@
+/*
+ * Split-Field Undo
+ * Move history for undo and redo. Each move is kept as the bytes of the
+ * state block it changed since the move before, XORed with their old
+ * values: a 4-byte mask naming the bytes, the XORs, and a count byte at
+ * the end so the list walks both ways. The same delta takes the game
+ * back and forward again, so undo and redo are a fixed amount of work a
+ * step however long the history is. The deltas go round one fixed ring;
+ * when it fills, the oldest moves are forgotten, so the depth is bounded
+ * only by the ring's size (about ten bytes a move).
+ *
+ * A move is an update that moves a player. Enemy steps and counters that
+ * changed between moves go in with the next move, so undoing it puts the
+ * enemies back where they were too. The buttons held stay as they are.
+ */
+
+#ifndef UNDO_H
+#define UNDO_H
+
+#include "sim.h"
+
+/* Bytes of delta kept: a power of two */
+#define UNDO_RING_SIZE 0x10000
+
+/* Bytes of a delta besides the changed ones: mask and count */
+#define UNDO_DELTA_OVERHEAD 5
+
+typedef struct {
+    unsigned int moves;       /* Moves recorded, forgotten ones included */
+    unsigned int bytes;       /* Their deltas' bytes */
+    unsigned int forgotten;   /* Moves dropped to make room */
+} UndoStats;
+
+typedef struct {
+    /* Offsets into the ring; they only grow, and wrap with it */
+    unsigned int start;       /* The oldest move kept */
+    unsigned int now;         /* End of the moves made: undo reads back from here */
+    unsigned int end;         /* End of the moves undone: redo reads on to here */
+    int depth;                /* Moves before now */
+    int ahead;                /* Moves after now */
+    SimState mark;            /* The state block as the last move left it */
+    UndoStats stats;
+    unsigned char ring[UNDO_RING_SIZE];
+} UndoHistory;
+
+/* Forget every move; the game as it stands is the start */
+void undo_init(UndoHistory* history, const GameContext* ctx);
+
+/* Call after each update: records it if it moved a player, dropping any
+ * moves undone before it. Returns 1 if it was recorded. */
+int undo_record(UndoHistory* history, const GameContext* ctx);
+
+/* Take the game back to before the last move, or on to the next one
+ * undone; returns 0 when there is none. The occupancy grid follows. */
+int undo_step_back(UndoHistory* history, GameContext* ctx);
+int undo_step_forward(UndoHistory* history, GameContext* ctx);
+
+/* Delta bytes per thousand moves recorded so far */
+unsigned int undo_bytes_per_1000(const UndoHistory* history);
+
+#endif /* UNDO_H */